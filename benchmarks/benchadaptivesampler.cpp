@@ -0,0 +1,157 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QGeoCoordinate>
+#include <qmath.h>
+#include "benchadaptivesampler.h"
+#include "adaptivesampler.h"
+#include "TrackPoints.h"
+
+static const qreal metresPerLatitude = 111319.49;
+
+// Segments of a 1 Hz ride: seconds, speed in m/s, turn in degrees/s
+static const struct {
+    int seconds;
+    qreal speed;
+    qreal turn;
+} segments[] = {{60, 0, 0}, {600, 6, 0}, {30, 6, 6}, {300, 6, 0}, {20, 4, -9},
+                {120, 0, 0}, {900, 8, 0.2}, {45, 5, 4}, {300, 3, 0}};
+
+static TrackPoints ride() {
+    TrackPoints points;
+    qint64 time = Q_INT64_C(1400000000000);
+    qreal east = 0;
+    qreal north = 0;
+    qreal heading = 0;
+    for(unsigned s=0;s<sizeof(segments)/sizeof(segments[0]);s++) {
+        for(int i=0;i<segments[s].seconds;i++) {
+            heading += segments[s].turn;
+            east += segments[s].speed * qSin(heading * M_PI / 180);
+            north += segments[s].speed * qCos(heading * M_PI / 180);
+            TrackPoint point;
+            point.setTimeMs(time);
+            point.setLatitude(61.4981 + north / metresPerLatitude);
+            point.setLongitude(23.7608 + east / (metresPerLatitude * qCos(61.4981 * M_PI / 180)));
+            point.setGroundSpeed(segments[s].speed);
+            if(segments[s].speed > 0) {
+                point.setDirection(fmod(heading + 360, 360));
+            }
+            points.append(point);
+            time += 1000;
+        }
+    }
+    return points;
+}
+
+static qreal distance(const TrackPoints &points) {
+    qreal total = 0;
+    for(int i=1;i<points.size();i++) {
+        QGeoCoordinate a(points.latitude(i-1), points.longitude(i-1));
+        total += a.distanceTo(QGeoCoordinate(points.latitude(i), points.longitude(i)));
+    }
+    return total;
+}
+
+// Plays a 1 Hz track like a position source that honours the requested
+// interval: the next fix delivered is the one interval later
+static TrackPoints sampled(const TrackPoints &track, AdaptiveSampler &sampler) {
+    TrackPoints points;
+    int i = 0;
+    while(i < track.size()) {
+        TrackPoint fix = track.at(i);
+        sampler.update(fix);
+        points.append(fix);
+        i += qMax(1, sampler.interval() / 1000);
+    }
+    if(points.timeMs(points.size() - 1) != track.timeMs(track.size() - 1)) {
+        points.append(track.at(track.size() - 1));
+    }
+    return points;
+}
+
+// Far fewer fixes, practically the same distance
+void BenchAdaptiveSampler::replay() {
+    TrackPoints track = ride();
+    AdaptiveSampler sampler;
+    sampler.setBatteryLevel(80);
+    TrackPoints points = sampled(track, sampler);
+
+    qreal full = distance(track);
+    qreal adaptive = distance(points);
+    qDebug("adaptive sampling: %d of %d fixes, distance %.0f m of %.0f m (%.2f%%), %d decisions",
+           points.size(), track.size(), adaptive, full, 100 * (full - adaptive) / full,
+           sampler.decisions().size());
+    // About a quarter of the fixes, distance within 0.01 %
+    QVERIFY(points.size() < track.size() * 0.3);
+    QVERIFY(qAbs(full - adaptive) < full * 0.0001);
+    QVERIFY(!sampler.decisions().isEmpty());
+}
+
+// A turn after a straight goes back to the base interval on the first fix
+// that sees it
+void BenchAdaptiveSampler::turns() {
+    TrackPoints track = ride();
+    AdaptiveSampler sampler;
+    sampler.setBatteryLevel(80);
+    int turnStart = segments[0].seconds + segments[1].seconds;
+    int i = 0;
+    while(i < turnStart) {
+        sampler.update(track.at(i));
+        i += qMax(1, sampler.interval() / 1000);
+    }
+    QCOMPARE(sampler.mode(), AdaptiveSampler::Steady);
+    QVERIFY(sampler.interval() > sampler.baseInterval());
+    // Three seconds into the turn, 18 degrees off
+    sampler.update(track.at(turnStart + 2));
+    QCOMPARE(sampler.mode(), AdaptiveSampler::Base);
+    QCOMPARE(sampler.interval(), sampler.baseInterval());
+    QVERIFY(sampler.decisions().last().reason.startsWith("turning"));
+}
+
+void BenchAdaptiveSampler::lowBattery() {
+    TrackPoints track = ride();
+    AdaptiveSampler normal;
+    normal.setBatteryLevel(80);
+    AdaptiveSampler low;
+    low.setBatteryLevel(10);
+    for(int i=0;i<segments[0].seconds;i++) {
+        normal.update(track.at(i));
+        low.update(track.at(i));
+    }
+    QCOMPARE(normal.mode(), AdaptiveSampler::Stationary);
+    QCOMPARE(low.interval(), 2 * normal.interval());
+    QCOMPARE(low.decisions().last().battery, 10);
+}
+
+void BenchAdaptiveSampler::update() {
+    TrackPoints track = ride();
+    QVector<TrackPoint> fixes;
+    for(int i=0;i<track.size();i++) {
+        fixes.append(track.at(i));
+    }
+    QBENCHMARK {
+        AdaptiveSampler sampler;
+        sampler.setBatteryLevel(80);
+        for(int i=0;i<fixes.size();i++) {
+            sampler.update(fixes.at(i));
+        }
+    }
+}
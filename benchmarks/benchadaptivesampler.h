@@ -0,0 +1,37 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHADAPTIVESAMPLER_H
+#define BENCHADAPTIVESAMPLER_H
+
+#include <QObject>
+
+class BenchAdaptiveSampler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void replay();
+    void turns();
+    void lowBattery();
+    void update();
+};
+
+#endif // BENCHADAPTIVESAMPLER_H
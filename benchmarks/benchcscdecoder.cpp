@@ -0,0 +1,122 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QVector>
+#include "benchcscdecoder.h"
+#include "../plugins/TrackInfoBTLEBike/CscDecoder.h"
+
+// Notification as read from the L2CAP socket: opcode, handle, measurement
+static QByteArray notification(quint8 flags, quint32 wheelRevs, quint16 wheelTime,
+                               quint16 crankRevs, quint16 crankTime) {
+    QByteArray packet("\x1b\x13\x00", 3);
+    packet.append((char)flags);
+    if(flags & CscDecoder::WheelData) {
+        for(int i=0;i<4;i++) packet.append((char)(wheelRevs >> (8*i)));
+        for(int i=0;i<2;i++) packet.append((char)(wheelTime >> (8*i)));
+    }
+    if(flags & CscDecoder::CrankData) {
+        for(int i=0;i<2;i++) packet.append((char)(crankRevs >> (8*i)));
+        for(int i=0;i<2;i++) packet.append((char)(crankTime >> (8*i)));
+    }
+    return packet;
+}
+
+static bool decodePacket(CscDecoder &decoder, const QByteArray &packet, CscDecoder::Result &result) {
+    return decoder.decodeNotification((const uint8_t *)packet.constData(), packet.size(), result);
+}
+
+// Stream shaped like a speed and cadence sensor at 2 Hz, crossing the
+// 16 bit event time and crank counter rollovers
+void BenchCscDecoder::replay() {
+    CscDecoder decoder(2.096);
+    CscDecoder::Result result;
+
+    QVERIFY(decodePacket(decoder, notification(3, 1000, 64512, 65534, 64000), result));
+    QCOMPARE(result.fields, (unsigned)CscDecoder::Distance);
+    QCOMPARE(result.distance, 0.0);
+
+    // 4 wheel revolutions and 1 crank revolution in 1 s
+    QVERIFY(decodePacket(decoder, notification(3, 1004, 0, 65535, 65024), result));
+    QCOMPARE(result.fields, (unsigned)(CscDecoder::Distance | CscDecoder::Speed | CscDecoder::Cadence));
+    QCOMPARE(result.speed, 4 * 2.096);
+    QCOMPARE(result.distance, 4 * 2.096);
+    QCOMPARE(result.cadence, 60.0);
+
+    // Crank counter wraps to 1, two revolutions in 1.5 s
+    QVERIFY(decodePacket(decoder, notification(3, 1008, 1536, 1, 1024), result));
+    QCOMPARE(result.cadence, 80.0);
+    QCOMPARE(result.distance, 8 * 2.096);
+
+    // Same events repeated: rates unknown until the sensor counts as stopped
+    for(int i=0;i<2;i++) {
+        QVERIFY(decodePacket(decoder, notification(3, 1008, 1536, 1, 1024), result));
+        QCOMPARE(result.fields, (unsigned)CscDecoder::Distance);
+    }
+    QVERIFY(decodePacket(decoder, notification(3, 1008, 1536, 1, 1024), result));
+    QCOMPARE(result.fields, (unsigned)(CscDecoder::Distance | CscDecoder::Speed | CscDecoder::Cadence));
+    QCOMPARE(result.speed, 0.0);
+    QCOMPARE(result.cadence, 0.0);
+
+    // Sensor battery change resets the counters, no jump in distance
+    QVERIFY(decodePacket(decoder, notification(1, 0, 0, 0, 0), result));
+    QCOMPARE(result.distance, 8 * 2.096);
+    QVERIFY(decodePacket(decoder, notification(1, 2, 1024, 0, 0), result));
+    QCOMPARE(result.distance, 10 * 2.096);
+
+    // Crank only packet from a cadence sensor
+    CscDecoder cadence;
+    QVERIFY(decodePacket(cadence, notification(2, 0, 0, 10, 0), result));
+    QVERIFY(decodePacket(cadence, notification(2, 0, 0, 11, 512), result));
+    QCOMPARE(result.fields, (unsigned)CscDecoder::Cadence);
+    QCOMPARE(result.cadence, 120.0);
+}
+
+void BenchCscDecoder::malformed() {
+    CscDecoder decoder(2.096);
+    CscDecoder::Result result;
+    QByteArray packet = notification(3, 1, 2, 3, 4);
+    for(int len=0;len<packet.size();len++) {
+        QVERIFY(!decoder.decodeNotification((const uint8_t *)packet.constData(), len, result));
+    }
+    QByteArray other = packet;
+    other[0] = 0x1d;    // Indication, not a notification
+    QVERIFY(!decodePacket(decoder, other, result));
+    // Reserved flag bits are ignored
+    QVERIFY(decodePacket(decoder, notification(0xfc, 0, 0, 0, 0), result));
+    QCOMPARE(result.fields, 0u);
+}
+
+void BenchCscDecoder::decode() {
+    QVector<QByteArray> packets;
+    for(int i=0;i<4096;i++) {
+        packets.append(notification(3, i * 3, i * 700, i, i * 1100));
+    }
+    CscDecoder decoder(2.096);
+    CscDecoder::Result result;
+    double sum = 0;
+    QBENCHMARK {
+        for(int i=0;i<packets.size();i++) {
+            decodePacket(decoder, packets.at(i), result);
+            sum += result.speed;
+        }
+    }
+    QVERIFY(sum >= 0);
+}
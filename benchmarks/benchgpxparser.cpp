@@ -0,0 +1,97 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QFile>
+#include <QElapsedTimer>
+#include "benchgpxparser.h"
+#include "benchutils.h"
+#include "gpxparser.h"
+
+static const int trackSizes[] = {1000, 10000, 100000};
+
+static QString trackFile(const QTemporaryDir &dir, int points) {
+    return dir.path() + QString("/track-%1.gpx").arg(points);
+}
+
+static void reportRate(const char *path, int points, qint64 nsecs) {
+    qDebug("%s: %d points, %.0f points/s", path, points, points * 1e9 / qMax(nsecs, Q_INT64_C(1)));
+}
+
+void BenchGpxParser::initTestCase() {
+    QVERIFY(m_dir.isValid());
+    for(unsigned i=0;i<sizeof(trackSizes)/sizeof(trackSizes[0]);i++) {
+        QVERIFY(writeSyntheticGpx(trackFile(m_dir, trackSizes[i]), trackSizes[i]));
+    }
+}
+
+void BenchGpxParser::addSizes() {
+    QTest::addColumn<int>("points");
+    for(unsigned i=0;i<sizeof(trackSizes)/sizeof(trackSizes[0]);i++) {
+        QTest::newRow(QByteArray::number(trackSizes[i]).constData()) << trackSizes[i];
+    }
+}
+
+void BenchGpxParser::fastPath_data() {
+    addSizes();
+}
+
+void BenchGpxParser::fastPath() {
+    QFETCH(int, points);
+    QFile file(trackFile(m_dir, points));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const char *data = (const char *)file.map(0, file.size());
+    QVERIFY(data);
+
+    QElapsedTimer timer;
+    timer.start();
+    GpxTrack track;
+    QCOMPARE(GpxParser::parseFast(data, file.size(), track), GpxParser::Ok);
+    reportRate("fast path", points, timer.nsecsElapsed());
+    QCOMPARE(track.points.size(), points);
+
+    QBENCHMARK {
+        GpxTrack track;
+        GpxParser::parseFast(data, file.size(), track);
+    }
+}
+
+void BenchGpxParser::xmlReader_data() {
+    addSizes();
+}
+
+void BenchGpxParser::xmlReader() {
+    QFETCH(int, points);
+    QFile file(trackFile(m_dir, points));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    QElapsedTimer timer;
+    timer.start();
+    GpxTrack track;
+    QCOMPARE(GpxParser::parseXml(&file, track), GpxParser::Ok);
+    reportRate("xml reader", points, timer.nsecsElapsed());
+    QCOMPARE(track.points.size(), points);
+
+    QBENCHMARK {
+        file.seek(0);
+        GpxTrack track;
+        GpxParser::parseXml(&file, track);
+    }
+}
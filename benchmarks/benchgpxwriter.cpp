@@ -0,0 +1,90 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include "benchgpxwriter.h"
+#include "benchutils.h"
+#include "gpxparser.h"
+#include "gpxwriter.h"
+
+static const int trackSizes[] = {1000, 18000, 100000};  // 18000 s is a 5 hour ride
+
+void BenchGpxWriter::initTestCase() {
+    QVERIFY(m_dir.isValid());
+}
+
+// The written file must read back through the fast path unchanged
+void BenchGpxWriter::roundTrip() {
+    TrackPoints points = syntheticTrack(1000);
+    QString filename = m_dir.path() + "/roundtrip.gpx";
+    QSaveFile file(filename);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(GpxWriter(&file).write(points, "Name <&>", "Desc \"quoted\""));
+    QVERIFY(file.commit());
+
+    GpxTrack track;
+    bool fastPath = false;
+    QCOMPARE(GpxParser::parseFile(filename, track, &fastPath), GpxParser::Ok);
+    QVERIFY(fastPath);
+    QCOMPARE(track.name, QString("Name <&>"));
+    QCOMPARE(track.description, QString("Desc \"quoted\""));
+    QCOMPARE(track.points.size(), points.size());
+    for(int i=0;i<points.size();i++) {
+        QCOMPARE(track.points.flags(i), points.flags(i));
+        QCOMPARE(track.points.timeMs(i), points.timeMs(i));
+        for(int field=0;field<TrackPoint::FieldCount;field++) {
+            if(points.has(i, TrackPoint::fieldFlag(field))) {
+                QCOMPARE(track.points.value(i, field), points.value(i, field));
+            }
+        }
+    }
+}
+
+void BenchGpxWriter::write_data() {
+    QTest::addColumn<int>("points");
+    for(unsigned i=0;i<sizeof(trackSizes)/sizeof(trackSizes[0]);i++) {
+        QTest::newRow(QByteArray::number(trackSizes[i]).constData()) << trackSizes[i];
+    }
+}
+
+void BenchGpxWriter::write() {
+    QFETCH(int, points);
+    TrackPoints track = syntheticTrack(points);
+    QString filename = m_dir.path() + QString("/write-%1.gpx").arg(points);
+
+    QElapsedTimer timer;
+    timer.start();
+    QSaveFile file(filename);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(GpxWriter(&file).write(track, "Benchmark", QString()));
+    QVERIFY(file.commit());
+    qint64 nsecs = timer.nsecsElapsed();
+    qDebug("gpx writer: %d points, %.1f ms, %.0f points/s", points, nsecs / 1e6,
+           points * 1e9 / qMax(nsecs, Q_INT64_C(1)));
+
+    QBENCHMARK {
+        QSaveFile file(filename);
+        file.open(QIODevice::WriteOnly);
+        GpxWriter(&file).write(track, "Benchmark", QString());
+        file.commit();
+    }
+}
@@ -0,0 +1,143 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QDateTime>
+#include "benchisotime.h"
+#include "isotime.h"
+
+static const int timestamps = 10000;
+static const qint64 startMs = Q_INT64_C(1400000000000);
+
+// Leap days, midnight, a century that is not a leap year, milliseconds
+static const qint64 samples[] = {
+    Q_INT64_C(0), Q_INT64_C(951782400000), Q_INT64_C(951868799999), Q_INT64_C(1078012800123),
+    Q_INT64_C(1400000000000), Q_INT64_C(1400000000001), Q_INT64_C(1400000000999),
+    Q_INT64_C(1420070399500), Q_INT64_C(4107542400000), Q_INT64_C(4107628800042)
+};
+
+static QString qtFormat(qint64 msecs) {
+    QDateTime time = QDateTime::fromMSecsSinceEpoch(msecs).toUTC();
+    if(msecs % 1000) {
+        return time.toString("yyyy-MM-ddThh:mm:ss.zzzZ");
+    }
+    return time.toString(Qt::ISODate);
+}
+
+void BenchIsoTime::roundTrip() {
+    IsoTime codec;
+    for(unsigned i=0;i<sizeof(samples)/sizeof(samples[0]);i++) {
+        qint64 msecs = 0;
+        QString text = codec.toString(samples[i]);
+        QVERIFY(codec.parse(text, msecs));
+        QCOMPARE(msecs, samples[i]);
+    }
+    // Same day after another, the cached dates must follow
+    for(qint64 ms=startMs;ms<startMs+3*86400000;ms+=3599999) {
+        qint64 msecs = 0;
+        QVERIFY(codec.parse(codec.toString(ms), msecs));
+        QCOMPARE(msecs, ms);
+    }
+}
+
+void BenchIsoTime::matchesQDateTime() {
+    IsoTime codec;
+    for(unsigned i=0;i<sizeof(samples)/sizeof(samples[0]);i++) {
+        QCOMPARE(codec.toString(samples[i]), qtFormat(samples[i]));
+    }
+    const char *zoned[] = {"2014-05-13T16:53:20+03:00", "2014-05-13T16:53:20.250-05:30",
+                           "2014-05-13T23:59:59.5Z"};
+    for(unsigned i=0;i<sizeof(zoned)/sizeof(zoned[0]);i++) {
+        qint64 msecs = 0;
+        QVERIFY(codec.parse(QString(zoned[i]), msecs));
+        QCOMPARE(msecs, QDateTime::fromString(zoned[i], Qt::ISODate).toMSecsSinceEpoch());
+    }
+}
+
+void BenchIsoTime::rejects() {
+    IsoTime codec;
+    const char *invalid[] = {"", "2014-05-13", "2014-05-13T16:53:20", "2014-13-13T16:53:20Z",
+                             "2014-05-13T24:00:00Z", "2014-05-13T16:53:20.Z", "2014-05-13T16:53:20Zx",
+                             "2014-05-13 16:53:20Z", "2014-05-13T16:53:2xZ"};
+    for(unsigned i=0;i<sizeof(invalid)/sizeof(invalid[0]);i++) {
+        qint64 msecs = 0;
+        QVERIFY2(!codec.parse(QString(invalid[i]), msecs), invalid[i]);
+    }
+    qint64 msecs = 0;
+    QVERIFY(!codec.parse(QString::fromUtf8("2014-05-13T16:53:20\xc3\x84"), msecs));
+}
+
+void BenchIsoTime::format_data() {
+    QTest::addColumn<bool>("qt");
+    QTest::newRow("IsoTime") << false;
+    QTest::newRow("QDateTime") << true;
+}
+
+// One fix per second, as written by exportGpx()
+void BenchIsoTime::format() {
+    QFETCH(bool, qt);
+    if(qt) {
+        QBENCHMARK {
+            for(int i=0;i<timestamps;i++) {
+                QDateTime::fromMSecsSinceEpoch(startMs + i * 1000).toUTC().toString(Qt::ISODate);
+            }
+        }
+    } else {
+        char buffer[IsoTime::maxLength];
+        QBENCHMARK {
+            IsoTime codec;
+            for(int i=0;i<timestamps;i++) {
+                codec.format(startMs + i * 1000, buffer);
+            }
+        }
+    }
+}
+
+void BenchIsoTime::parse_data() {
+    format_data();
+}
+
+void BenchIsoTime::parse() {
+    QFETCH(bool, qt);
+    QList<QByteArray> texts;
+    IsoTime writer;
+    for(int i=0;i<timestamps;i++) {
+        texts.append(writer.toString(startMs + i * 1000).toLatin1());
+    }
+    qint64 sum = 0;
+    if(qt) {
+        QBENCHMARK {
+            for(int i=0;i<timestamps;i++) {
+                sum += QDateTime::fromString(QString::fromLatin1(texts.at(i)), Qt::ISODate).toMSecsSinceEpoch();
+            }
+        }
+    } else {
+        QBENCHMARK {
+            IsoTime codec;
+            for(int i=0;i<timestamps;i++) {
+                qint64 msecs;
+                const QByteArray &text = texts.at(i);
+                codec.parse(text.constData(), text.constData() + text.size(), msecs);
+                sum += msecs;
+            }
+        }
+    }
+    QVERIFY(sum != 0);
+}
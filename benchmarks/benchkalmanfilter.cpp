@@ -0,0 +1,220 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include <QGeoCoordinate>
+#include <qmath.h>
+#include "benchkalmanfilter.h"
+#include "gpskalmanfilter.h"
+#include "gpxparser.h"
+#include "gpxwriter.h"
+
+static const qreal noiseSigma = 4;      // Metres per axis
+static const qreal reportedAccuracy = 8;
+static const qreal metresPerLatitude = 111319.49;
+
+// Fixture segments: seconds, speed in m/s. Zero speed is standing still.
+static const struct {
+    int seconds;
+    qreal speed;
+} segments[] = {{120, 0}, {600, 5}, {120, 0}, {300, 3}, {60, 0}};
+
+// Deterministic gaussian noise so failures are reproducible
+class Noise {
+public:
+    Noise() : m_state(12345), m_spare(0), m_haveSpare(false) {}
+    qreal next() {
+        if(m_haveSpare) {
+            m_haveSpare = false;
+            return m_spare;
+        }
+        qreal u = (uniform() + 1) / 4294967297.0;
+        qreal v = uniform() / 4294967296.0;
+        qreal r = qSqrt(-2 * qLn(u));
+        m_spare = r * qSin(2 * M_PI * v);
+        m_haveSpare = true;
+        return r * qCos(2 * M_PI * v);
+    }
+
+private:
+    quint32 uniform() {
+        m_state = m_state * Q_UINT64_C(6364136223846793005) + Q_UINT64_C(1442695040888963407);
+        return (quint32)(m_state >> 32);
+    }
+    quint64 m_state;
+    qreal m_spare;
+    bool m_haveSpare;
+};
+
+static qreal trackDistance(const TrackPoints &points, int from, int to) {
+    qreal distance = 0;
+    for(int i=from+1;i<=to;i++) {
+        QGeoCoordinate a(points.latitude(i-1), points.longitude(i-1));
+        distance += a.distanceTo(QGeoCoordinate(points.latitude(i), points.longitude(i)));
+    }
+    return distance;
+}
+
+static TrackPoints filtered(const TrackPoints &fixes) {
+    GpsKalmanFilter filter;
+    TrackPoints points;
+    points.reserve(fixes.size());
+    for(int i=0;i<fixes.size();i++) {
+        TrackPoint fix = fixes.at(i);
+        filter.filter(fix);
+        points.append(fix);
+    }
+    return points;
+}
+
+// Writes a noisy ride through GpxWriter and reads it back, so the filter
+// sees exactly what an exported and reloaded track holds
+void BenchKalmanFilter::initTestCase() {
+    QVERIFY(m_dir.isValid());
+
+    Noise noise;
+    qint64 time = Q_INT64_C(1400000000000);
+    qreal east = 0;
+    qreal north = 0;
+    qreal heading = 0;
+    TrackPoints recorded;
+    for(unsigned s=0;s<sizeof(segments)/sizeof(segments[0]);s++) {
+        for(int i=0;i<segments[s].seconds;i++) {
+            if(segments[s].speed > 0) {
+                heading += 0.01;    // Gentle curve
+                east += segments[s].speed * qSin(heading);
+                north += segments[s].speed * qCos(heading);
+            }
+            qreal latitude = 61.4981 + north / metresPerLatitude;
+            qreal longitude = 23.7608 + east / (metresPerLatitude * qCos(61.4981 * M_PI / 180));
+            TrackPoint truth;
+            truth.setTimeMs(time);
+            truth.setLatitude(latitude);
+            truth.setLongitude(longitude);
+            m_truth.append(truth);
+
+            TrackPoint fix;
+            fix.setTimeMs(time);
+            fix.setLatitude(latitude + noiseSigma * noise.next() / metresPerLatitude);
+            fix.setLongitude(longitude + noiseSigma * noise.next() / (metresPerLatitude * qCos(latitude * M_PI / 180)));
+            fix.setHorizontalAccuracy(reportedAccuracy);
+            recorded.append(fix);
+            time += 1000;
+        }
+    }
+
+    QString filename = m_dir.path() + "/fixture.gpx";
+    QSaveFile file(filename);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(GpxWriter(&file).write(recorded, "Fixture", QString()));
+    QVERIFY(file.commit());
+    GpxTrack track;
+    QCOMPARE(GpxParser::parseFile(filename, track), GpxParser::Ok);
+    QCOMPARE(track.points.size(), recorded.size());
+    m_fixes = track.points;
+}
+
+// Jitter while standing still must not add distance
+void BenchKalmanFilter::stationary() {
+    TrackPoints points = filtered(m_fixes);
+    int from = 0;
+    for(unsigned s=0;s<sizeof(segments)/sizeof(segments[0]);s++) {
+        int to = from + segments[s].seconds - 1;
+        if(segments[s].speed == 0) {
+            // The first seconds go to noticing the stop
+            int settled = qMin(from + 10, to);
+            qreal raw = trackDistance(m_fixes, settled, to);
+            qreal smooth = trackDistance(points, settled, to);
+            qDebug("stationary %d s: raw %.1f m, filtered %.1f m", segments[s].seconds, raw, smooth);
+            QVERIFY(smooth < 10);
+            QVERIFY(raw > 100);
+        }
+        from = to + 1;
+    }
+}
+
+// Total distance close to the truth and positions closer than raw fixes
+void BenchKalmanFilter::distance() {
+    TrackPoints points = filtered(m_fixes);
+    qreal truth = trackDistance(m_truth, 0, m_truth.size() - 1);
+    qreal raw = trackDistance(m_fixes, 0, m_fixes.size() - 1);
+    qreal smooth = trackDistance(points, 0, points.size() - 1);
+
+    qreal rawError = 0;
+    qreal smoothError = 0;
+    for(int i=0;i<m_truth.size();i++) {
+        QGeoCoordinate truePosition(m_truth.latitude(i), m_truth.longitude(i));
+        qreal r = truePosition.distanceTo(QGeoCoordinate(m_fixes.latitude(i), m_fixes.longitude(i)));
+        qreal s = truePosition.distanceTo(QGeoCoordinate(points.latitude(i), points.longitude(i)));
+        rawError += r * r;
+        smoothError += s * s;
+    }
+    rawError = qSqrt(rawError / m_truth.size());
+    smoothError = qSqrt(smoothError / m_truth.size());
+    qDebug("distance: truth %.0f m, raw %.0f m, filtered %.0f m; rms error raw %.2f m, filtered %.2f m",
+           truth, raw, smooth, rawError, smoothError);
+
+    // Lateral noise left after filtering still adds a few percent
+    QVERIFY(qAbs(smooth - truth) < truth * 0.08);
+    QVERIFY(raw > truth * 1.5);
+    QVERIFY(smoothError < rawError);
+}
+
+// Measured fixes survive export and reload next to the filtered ones,
+// including the first fix of a run
+void BenchKalmanFilter::rawCoordinates() {
+    TrackPoints points = filtered(m_fixes);
+    QString filename = m_dir.path() + "/filtered.gpx";
+    QSaveFile file(filename);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(GpxWriter(&file).write(points, "Filtered", QString()));
+    QVERIFY(file.commit());
+
+    GpxTrack track;
+    bool fastPath = false;
+    QCOMPARE(GpxParser::parseFile(filename, track, &fastPath), GpxParser::Ok);
+    QVERIFY(fastPath);
+    QCOMPARE(track.points.size(), points.size());
+    for(int i=0;i<points.size();i++) {
+        QVERIFY(track.points.has(i, TrackPoint::HasRawLatitude));
+        QVERIFY(track.points.has(i, TrackPoint::HasRawLongitude));
+        QCOMPARE(track.points.value(i, TrackPoint::RawLatitude), m_fixes.latitude(i));
+        QCOMPARE(track.points.value(i, TrackPoint::RawLongitude), m_fixes.longitude(i));
+        QCOMPARE(track.points.latitude(i), points.latitude(i));
+    }
+}
+
+void BenchKalmanFilter::filter() {
+    QElapsedTimer timer;
+    timer.start();
+    TrackPoints points = filtered(m_fixes);
+    qint64 nsecs = timer.nsecsElapsed();
+    qDebug("kalman filter: %d fixes, %.0f ns/fix", points.size(), (qreal)nsecs / points.size());
+
+    QBENCHMARK {
+        GpsKalmanFilter filter;
+        for(int i=0;i<m_fixes.size();i++) {
+            TrackPoint fix = m_fixes.at(i);
+            filter.filter(fix);
+        }
+    }
+}
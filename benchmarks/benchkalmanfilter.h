@@ -0,0 +1,46 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHKALMANFILTER_H
+#define BENCHKALMANFILTER_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+#include "TrackPoints.h"
+
+class BenchKalmanFilter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void stationary();
+    void distance();
+    void rawCoordinates();
+    void filter();
+
+private:
+    QTemporaryDir m_dir;
+    TrackPoints m_truth;    // Noise free positions of the fixture
+    TrackPoints m_fixes;    // Fixture as read back from GPX
+};
+
+#endif // BENCHKALMANFILTER_H
@@ -0,0 +1,98 @@
+# Headless micro-benchmarks for the track hot paths. Builds against plain
+# Qt without sailfishapp:
+#   qmake benchmarks.pro && make && ./rena-benchmarks
+TEMPLATE = app
+TARGET = rena-benchmarks
+CONFIG += console
+CONFIG -= app_bundle
+QT += testlib positioning concurrent network
+QT -= gui
+LIBS += -lz
+
+INCLUDEPATH += ../src
+
+SOURCES += main.cpp \
+    benchutils.cpp \
+    benchgpxparser.cpp \
+    benchgpxwriter.cpp \
+    benchisotime.cpp \
+    benchcscdecoder.cpp \
+    benchsensorconnection.cpp \
+    benchkalmanfilter.cpp \
+    benchadaptivesampler.cpp \
+    benchreplay.cpp \
+    benchtrackpoint.cpp \
+    benchtrackrecorder.cpp \
+    benchtrackloader.cpp \
+    benchtrackstatistics.cpp \
+    benchrunkeeper.cpp \
+    benchuploadqueue.cpp \
+    benchtrackwriter.cpp \
+    ../plugins/SensorConnection.cpp \
+    ../plugins/UploadQueue.cpp \
+    ../plugins/Gzip.cpp \
+    ../plugins/UploadRunKeeper/RunKeeperActivity.cpp \
+    ../src/gpxparser.cpp \
+    ../src/isotime.cpp \
+    ../src/trackwriter.cpp \
+    ../src/gpxwriter.cpp \
+    ../src/tcxwriter.cpp \
+    ../src/geojsonwriter.cpp \
+    ../src/fitwriter.cpp \
+    ../src/gpskalmanfilter.cpp \
+    ../src/adaptivesampler.cpp \
+    ../src/replaypositionsource.cpp \
+    ../src/trackrecorder.cpp \
+    ../src/plugins.cpp \
+    ../src/autosavejournal.cpp \
+    ../src/tracksummarycache.cpp \
+    ../src/pathsimplifier.cpp \
+    ../src/sensorfusion.cpp \
+    ../src/trackloader.cpp \
+    ../src/trackstatistics.cpp \
+    ../src/historymodel.cpp
+
+HEADERS += benchutils.h \
+    benchgpxparser.h \
+    benchgpxwriter.h \
+    benchisotime.h \
+    benchcscdecoder.h \
+    benchsensorconnection.h \
+    benchkalmanfilter.h \
+    benchadaptivesampler.h \
+    benchreplay.h \
+    benchtrackpoint.h \
+    benchtrackrecorder.h \
+    benchtrackloader.h \
+    benchtrackstatistics.h \
+    benchrunkeeper.h \
+    benchuploadqueue.h \
+    benchtrackwriter.h \
+    ../plugins/SensorConnection.h \
+    ../plugins/TrackInfoBTLEBike/CscDecoder.h \
+    ../plugins/UploadQueue.h \
+    ../plugins/Gzip.h \
+    ../plugins/UploadRunKeeper/RunKeeperActivity.h \
+    ../src/gpxparser.h \
+    ../src/isotime.h \
+    ../src/trackwriter.h \
+    ../src/gpxwriter.h \
+    ../src/tcxwriter.h \
+    ../src/geojsonwriter.h \
+    ../src/fitwriter.h \
+    ../src/gpskalmanfilter.h \
+    ../src/adaptivesampler.h \
+    ../src/replaypositionsource.h \
+    ../src/trackrecorder.h \
+    ../src/plugins.h \
+    ../src/autosavejournal.h \
+    ../src/tracksummarycache.h \
+    ../src/pathsimplifier.h \
+    ../src/sensorfusion.h \
+    ../src/trackloader.h \
+    ../src/trackstatistics.h \
+    ../src/historymodel.h \
+    ../src/TrackBounds.h \
+    ../src/TrackPoint.h \
+    ../src/TrackPoints.h \
+    ../src/TrackPointIterator.h
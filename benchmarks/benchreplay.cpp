@@ -0,0 +1,171 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include <QGeoCoordinate>
+#include <qmath.h>
+#include "benchreplay.h"
+#include "benchutils.h"
+#include "replaypositionsource.h"
+#include "trackrecorder.h"
+#include "autosavejournal.h"
+#include "gpxwriter.h"
+
+static const int daySeconds = 24 * 3600;
+static const qreal metresPerLatitude = 111319.49;
+
+// Slowly winding ride at 5 m/s with a cadence, one point per second
+static TrackPoints ride(int seconds) {
+    TrackPoints points;
+    points.reserve(seconds);
+    qint64 time = Q_INT64_C(1400000000000);
+    qreal east = 0;
+    qreal north = 0;
+    for(int i=0;i<seconds;i++) {
+        qreal heading = qSin(i / 600.0) * M_PI;
+        east += 5 * qSin(heading);
+        north += 5 * qCos(heading);
+        TrackPoint point;
+        point.setTimeMs(time + i * Q_INT64_C(1000));
+        point.setLatitude(61.4981 + north / metresPerLatitude);
+        point.setLongitude(23.7608 + east / (metresPerLatitude * qCos(61.4981 * M_PI / 180)));
+        point.setGroundSpeed(5);
+        point.setHorizontalAccuracy(5);
+        point.setCadence(85);
+        points.append(point);
+    }
+    return points;
+}
+
+void BenchReplay::initTestCase() {
+    QVERIFY(m_dir.isValid());
+    // TrackRecorder autosaves under $HOME/Rena
+    QVERIFY(useTemporaryHome(m_dir.path()));
+
+    TrackPoints points = ride(daySeconds);
+    m_dayDistance = 0;
+    for(int i=1;i<points.size();i++) {
+        QGeoCoordinate from(points.latitude(i-1), points.longitude(i-1));
+        m_dayDistance += from.distanceTo(QGeoCoordinate(points.latitude(i), points.longitude(i)));
+    }
+    m_dayTrack = m_dir.path() + "/day.gpx";
+    QSaveFile file(m_dayTrack);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(GpxWriter(&file).write(points, "Day", QString()));
+    QVERIFY(file.commit());
+}
+
+// GPX files and autosave journals both load
+void BenchReplay::load() {
+    ReplayPositionSource source;
+    QVERIFY(source.load(m_dayTrack));
+    QCOMPARE(source.pointCount(), daySeconds);
+
+    QString journalFile = m_dir.path() + "/journal";
+    AutoSaveJournal journal(journalFile);
+    QVERIFY(journal.append(ride(600), 0));
+    QVERIFY(source.load(journalFile));
+    QCOMPARE(source.pointCount(), 600);
+
+    QVERIFY(!source.load(m_dir.path() + "/missing.gpx"));
+}
+
+// Fixes follow the requested update interval
+void BenchReplay::thinning() {
+    ReplayPositionSource source;
+    source.setPoints(ride(100));
+    source.setSpeed(0);
+    source.setUpdateInterval(5000);
+    ReplayCollector collector;
+    connect(&source, SIGNAL(positionUpdated(QGeoPositionInfo)), &collector, SLOT(positionUpdated(QGeoPositionInfo)));
+    QSignalSpy finished(&source, SIGNAL(finished()));
+    source.startUpdates();
+    QVERIFY(finished.wait(10000));
+    QCOMPARE(collector.positions.size(), 20);
+    QCOMPARE(collector.positions.at(0).timestamp().msecsTo(collector.positions.at(1).timestamp()), Q_INT64_C(5000));
+}
+
+// Jittered samples arrive late and out of order, but all of them arrive
+void BenchReplay::jitter() {
+    ReplayPositionSource source;
+    source.setPoints(ride(600));
+    source.setSpeed(0);
+    source.setSensorRate(4);
+    source.setSensorJitter(400);
+    source.setSeed(42);
+    ReplayCollector collector;
+    connect(&source, SIGNAL(sensorSample(TrackPoint)), &collector, SLOT(sensorSample(TrackPoint)));
+    QSignalSpy finished(&source, SIGNAL(finished()));
+    source.startUpdates();
+    QVERIFY(finished.wait(10000));
+
+    const QList<TrackPoint> &samples = collector.samples;
+    QCOMPARE(samples.size(), 599 * 4 + 1);
+    int reordered = 0;
+    qreal lastDistance = 0;
+    qint64 lastTime = 0;
+    for(int i=0;i<samples.size();i++) {
+        const TrackPoint &sample = samples.at(i);
+        QVERIFY(sample.hasDistance());
+        if(sample.getTimeMs() < lastTime) {
+            reordered++;
+        } else {
+            QVERIFY(sample.getDistance() >= lastDistance);
+            lastDistance = sample.getDistance();
+        }
+        lastTime = qMax(lastTime, sample.getTimeMs());
+    }
+    qDebug("replay jitter: %d of %d samples out of order", reordered, samples.size());
+    QVERIFY(reordered > 0);
+}
+
+// A whole day through the recording hot path: fusion, autosave, notifications
+void BenchReplay::recorder() {
+    QObject parent;
+    TrackRecorder *recorder = new TrackRecorder(&parent);
+    recorder->clearTrack();
+    recorder->setApplicationActive(false);
+
+    ReplayPositionSource *source = new ReplayPositionSource();
+    QVERIFY(source->load(m_dayTrack));
+    source->setSpeed(0);
+    source->setSensorRate(2);
+    source->setSensorJitter(300);
+    connect(source, SIGNAL(sensorSample(TrackPoint)), recorder, SLOT(positionUpdated(TrackPoint)));
+    QSignalSpy finished(source, SIGNAL(finished()));
+    recorder->setPositionSource(source);
+
+    QElapsedTimer timer;
+    timer.start();
+    recorder->setIsTracking(true);
+    QVERIFY(finished.wait(600000));
+    recorder->setIsTracking(false);
+    qint64 msecs = timer.elapsed();
+
+    qDebug("replay recorder: %d points, %.0f m of %.0f m in %lld ms, %.0f fixes/s",
+           recorder->points(), recorder->distance(), m_dayDistance, msecs,
+           daySeconds * 1000.0 / qMax(msecs, Q_INT64_C(1)));
+    QCOMPARE(recorder->points(), daySeconds);
+    QVERIFY(qAbs(recorder->distance() - m_dayDistance) < m_dayDistance * 0.01);
+
+    recorder->clearTrack();
+}
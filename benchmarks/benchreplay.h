@@ -0,0 +1,61 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHREPLAY_H
+#define BENCHREPLAY_H
+
+#include <QObject>
+#include <QTemporaryDir>
+#include <QGeoPositionInfo>
+#include <QList>
+
+#include "TrackPoint.h"
+
+// Keeps what a replay source emitted, TrackPoint is not a QVariant type
+class ReplayCollector : public QObject
+{
+    Q_OBJECT
+public:
+    QList<QGeoPositionInfo> positions;
+    QList<TrackPoint> samples;
+
+public slots:
+    void positionUpdated(const QGeoPositionInfo &info) {positions.append(info);}
+    void sensorSample(const TrackPoint &sample) {samples.append(sample);}
+};
+
+class BenchReplay : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void load();
+    void thinning();
+    void jitter();
+    void recorder();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_dayTrack;     // 24 hours at 1 Hz
+    qreal m_dayDistance;
+};
+
+#endif // BENCHREPLAY_H
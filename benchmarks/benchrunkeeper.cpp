@@ -0,0 +1,227 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QBuffer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <math.h>
+#include "benchrunkeeper.h"
+#include "benchutils.h"
+#include "benchuploadqueue.h"
+#include "trackloader.h"
+#include "gpxwriter.h"
+#include "../plugins/UploadRunKeeper/RunKeeperActivity.h"
+#include "../plugins/Gzip.h"
+
+static const int trackPoints = 10000;
+static const char trackName[] = "runkeeper.gpx";
+
+// The payload the plugin used to build before streaming it
+static QByteArray activityTree(TrackLoader &loader) {
+    const TrackPoints &points = loader.points();
+    QJsonArray path;
+    qint64 start = points.timeMs(0);
+    for(int i=0;i<loader.trackPointCount();i++) {
+        int timestamp = (points.timeMs(i) - start) / 1000;
+        QJsonObject point;
+        point["timestamp"] = timestamp;
+        point["altitude"] = points.elevation(i);
+        point["longitude"] = points.longitude(i);
+        point["latitude"] = points.latitude(i);
+        point["type"] = QString("gps");
+        path.append(point);
+    }
+    QJsonObject activity;
+    activity["type"] = QString("Cycling");
+    activity["total_distance"] = loader.distance();
+    activity["duration"] = (int) loader.duration();
+    activity["path"] = path;
+    return QJsonDocument(activity).toJson(QJsonDocument::Compact);
+}
+
+void BenchRunKeeper::initTestCase() {
+    QVERIFY(m_dir.isValid());
+    QVERIFY(useTemporaryHome(m_dir.path()));
+    QVERIFY(writeSyntheticGpx(m_dir.path() + "/Rena/" + trackName, trackPoints));
+}
+
+// Strings are escaped and numbers JSON has no literal for become null
+void BenchRunKeeper::jsonValues() {
+    QString notes = QString::fromUtf8("\"quoted\"\\\n\t\x01 \xc3\xa4");
+    TrackPoints points;
+    for(int i=0;i<3;i++) {
+        TrackPoint point;
+        point.setTimeMs(Q_INT64_C(1400000000000) + i * 1000);
+        point.setLatitude(60.123456789012 + i * 0.1);
+        point.setLongitude(-1e-7);
+        if(i != 1) {
+            point.setElevation(0.1);
+        }
+        points.append(point);
+    }
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QVERIFY(writeRunKeeperActivity(points, notes, &buffer));
+    QJsonParseError error;
+    QJsonObject activity = QJsonDocument::fromJson(buffer.data(), &error).object();
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    QCOMPARE(activity["notes"].toString(), notes);
+    QCOMPARE(activity["duration"].toInt(), 2);
+    QJsonArray path = activity["path"].toArray();
+    QCOMPARE(path.size(), 3);
+    QCOMPARE(path.at(0).toObject()["latitude"].toDouble(), 60.123456789012);
+    QCOMPARE(path.at(0).toObject()["longitude"].toDouble(), -1e-7);
+    QCOMPARE(path.at(0).toObject()["altitude"].toDouble(), 0.1);
+    QVERIFY(path.at(1).toObject()["altitude"].isNull());
+    QCOMPARE(path.at(1).toObject()["type"].toString(), QString("gps"));
+}
+
+void BenchRunKeeper::activity() {
+    QVERIFY(useTemporaryHome(m_dir.path()));
+    TrackLoader loader;
+    loader.setFilename(trackName);
+    QCOMPARE(loader.trackPointCount(), trackPoints);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QVERIFY(writeRunKeeperActivity(loader.points(), loader.description(), &buffer));
+    QJsonParseError error;
+    QJsonObject activity = QJsonDocument::fromJson(buffer.data(), &error).object();
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    QCOMPARE(activity["type"].toString(), QString("Cycling"));
+    QCOMPARE(activity["duration"].toInt(), (int) loader.duration());
+    QCOMPARE(activity["total_distance"].toDouble(), loader.distance());
+
+    const TrackPoints &points = loader.points();
+    QJsonArray path = activity["path"].toArray();
+    QCOMPARE(path.size(), trackPoints);
+    QCOMPARE(path.first().toObject()["type"].toString(), QString("start"));
+    QCOMPARE(path.last().toObject()["type"].toString(), QString("end"));
+    for(int i=0;i<trackPoints;i+=997) {
+        QJsonObject point = path.at(i).toObject();
+        QCOMPARE(point["latitude"].toDouble(), points.latitude(i));
+        QCOMPARE(point["longitude"].toDouble(), points.longitude(i));
+        QCOMPARE(point["altitude"].toDouble(), points.elevation(i));
+        QCOMPARE(point["timestamp"].toInt(), (int) ((points.timeMs(i) - points.timeMs(0)) / 1000));
+    }
+    // Synthetic tracks carry no sensor distance
+    QVERIFY(!activity.contains("distance"));
+}
+
+// Points handed over after a recording give the same upload as the saved file
+void BenchRunKeeper::fromMemory() {
+    QVERIFY(useTemporaryHome(m_dir.path()));
+    TrackPoints recorded = syntheticTrack(2000);
+    QFile file(m_dir.path() + "/Rena/recorded.gpx");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(GpxWriter(&file).write(recorded, "recorded", "Evening ride"));
+    file.close();
+
+    QBuffer memory;
+    QVERIFY(memory.open(QIODevice::WriteOnly));
+    QVERIFY(writeRunKeeperActivity(recorded, "Evening ride", &memory));
+
+    TrackLoader loader;
+    loader.setFilename("recorded.gpx");
+    QCOMPARE(loader.description(), QString("Evening ride"));
+    QBuffer disk;
+    QVERIFY(disk.open(QIODevice::WriteOnly));
+    QVERIFY(writeRunKeeperActivity(loader.points(), loader.description(), &disk));
+    QCOMPARE(memory.data(), disk.data());
+}
+
+void BenchRunKeeper::compressedBody() {
+    QVERIFY(useTemporaryHome(m_dir.path()));
+    TrackLoader loader;
+    loader.setFilename(trackName);
+    QVERIFY(loader.loaded());
+
+    QBuffer json;
+    QVERIFY(json.open(QIODevice::WriteOnly));
+    QVERIFY(writeRunKeeperActivity(loader.points(), loader.description(), &json));
+
+    QNetworkRequest plainRequest;
+    QScopedPointer<QIODevice> plain(createRunKeeperBody(loader.points(), loader.description(), false, plainRequest));
+    QVERIFY(plain);
+    QVERIFY(plainRequest.rawHeader("Content-Encoding").isEmpty());
+    QCOMPARE(plain->readAll(), json.data());
+
+    qint64 jsonSize = 0;
+    QNetworkRequest request(QUrl("http://127.0.0.1/activities"));
+    QScopedPointer<QIODevice> body(createRunKeeperBody(loader.points(), loader.description(), true, request, &jsonSize));
+    QVERIFY(body);
+    QCOMPARE(request.rawHeader("Content-Encoding"), QByteArray("gzip"));
+    QCOMPARE(jsonSize, (qint64) json.data().size());
+    qint64 sent = body->size();
+    qDebug("runkeeper body: %lld bytes of JSON, %lld gzipped", jsonSize, sent);
+    QVERIFY(sent < jsonSize / 2);
+
+    // What a server sees must inflate back to the same document
+    HttpStub server;
+    server.rejectGzip = true;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    request.setUrl(QUrl(QString("http://127.0.0.1:%1/activities").arg(server.serverPort())));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    QNetworkAccessManager nam;
+    QNetworkReply *reply = nam.post(request, body.data());
+    QTRY_VERIFY(reply->isFinished());
+    QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 415);
+    delete reply;
+    QVERIFY(server.lastHeaders.toLower().contains("content-encoding: gzip"));
+    QCOMPARE((qint64) server.lastBody.size(), sent);
+    QBuffer received(&server.lastBody);
+    QVERIFY(received.open(QIODevice::ReadOnly));
+    QBuffer inflated;
+    QVERIFY(inflated.open(QIODevice::WriteOnly));
+    QVERIFY(gzipDecompress(&received, &inflated));
+    QCOMPARE(inflated.data(), json.data());
+}
+
+void BenchRunKeeper::write_data() {
+    QTest::addColumn<bool>("tree");
+    QTest::newRow("RunKeeperWriter") << false;
+    QTest::newRow("QJsonDocument") << true;
+}
+
+void BenchRunKeeper::write() {
+    QFETCH(bool, tree);
+    QVERIFY(useTemporaryHome(m_dir.path()));
+    TrackLoader loader;
+    loader.setFilename(trackName);
+    QVERIFY(loader.loaded());
+
+    qint64 size = 0;
+    if(tree) {
+        QBENCHMARK {
+            size = activityTree(loader).size();
+        }
+    } else {
+        QBENCHMARK {
+            QBuffer buffer;
+            buffer.open(QIODevice::WriteOnly);
+            writeRunKeeperActivity(loader.points(), loader.description(), &buffer);
+            size = buffer.size();
+        }
+    }
+    QVERIFY(size > 0);
+}
@@ -0,0 +1,114 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QElapsedTimer>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "benchsensorconnection.h"
+
+FakeSensor::FakeSensor() :
+    device(-1),
+    opened(0),
+    packets(0),
+    refuse(false)
+{
+}
+
+FakeSensor::~FakeSensor() {
+    stop();
+    if(device >= 0) {
+        ::close(device);
+    }
+}
+
+int FakeSensor::openSocket() {
+    opened++;
+    if(refuse) {
+        return -1;
+    }
+    int fds[2];
+    if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0, fds) < 0) {
+        return -1;
+    }
+    if(device >= 0) {
+        ::close(device);
+    }
+    device = fds[1];
+    return fds[0];
+}
+
+void FakeSensor::packetReceived(const uint8_t *data, int len) {
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    packets++;
+}
+
+// A device hanging up is retried and the new connection used
+void BenchSensorConnection::reconnect() {
+    FakeSensor sensor;
+    sensor.start();
+    QTRY_VERIFY(sensor.isConnected());
+    QCOMPARE(::write(sensor.device, "\x1b\x13\x00\x01", 4), (ssize_t)4);
+    QTRY_COMPARE(sensor.packets, 1);
+
+    ::close(sensor.device);
+    sensor.device = -1;
+    QTRY_VERIFY(!sensor.isConnected());
+    QTRY_COMPARE_WITH_TIMEOUT(sensor.opened, 2, 3000);
+    QTRY_VERIFY(sensor.isConnected());
+    QCOMPARE(::write(sensor.device, "\x1b\x13\x00\x01", 4), (ssize_t)4);
+    QTRY_COMPARE(sensor.packets, 2);
+
+    sensor.stop();
+    QVERIFY(!sensor.isConnected());
+}
+
+void BenchSensorConnection::backoff() {
+    FakeSensor sensor;
+    sensor.refuse = true;
+    sensor.start();
+    QCOMPARE(sensor.opened, 1);
+    QCOMPARE(sensor.retryDelay(), 2000);
+    QTRY_COMPARE_WITH_TIMEOUT(sensor.opened, 2, 3000);
+    QCOMPARE(sensor.retryDelay(), 4000);
+    sensor.stop();
+    QTest::qWait(2500);
+    QCOMPARE(sensor.opened, 2);
+}
+
+void BenchSensorConnection::throughput() {
+    FakeSensor sensor;
+    sensor.start();
+    QTRY_VERIFY(sensor.isConnected());
+    const int count = 100000;
+    const char packet[] = "\x1b\x13\x00\x03\x01\x00\x00\x00\x00\x04\x01\x00\x00\x04";
+    QElapsedTimer timer;
+    timer.start();
+    int sent = 0;
+    while(sensor.packets < count) {
+        while(sent < count && ::write(sensor.device, packet, sizeof(packet) - 1) > 0) {
+            sent++;
+        }
+        QCoreApplication::processEvents();
+    }
+    qint64 nsecs = timer.nsecsElapsed();
+    qDebug("sensor connection: %d packets, %.0f packets/s", count, count * 1e9 / qMax(nsecs, Q_INT64_C(1)));
+}
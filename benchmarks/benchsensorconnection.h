@@ -0,0 +1,56 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHSENSORCONNECTION_H
+#define BENCHSENSORCONNECTION_H
+
+#include <QObject>
+
+#include "../plugins/SensorConnection.h"
+
+// Sensor whose device is the other end of a socketpair
+class FakeSensor : public SensorConnection
+{
+    Q_OBJECT
+
+public:
+    FakeSensor();
+    ~FakeSensor();
+    int device;         // Peer socket, -1 when not connected
+    int opened;
+    int packets;
+    bool refuse;        // Make openSocket() fail
+
+protected:
+    int openSocket();
+    void packetReceived(const uint8_t *data, int len);
+};
+
+class BenchSensorConnection : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void reconnect();
+    void backoff();
+    void throughput();
+};
+
+#endif // BENCHSENSORCONNECTION_H
@@ -0,0 +1,248 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QDir>
+#include <QElapsedTimer>
+#include "benchtrackloader.h"
+#include "benchutils.h"
+#include "trackloader.h"
+#include "historymodel.h"
+#include "tracksummarycache.h"
+
+static const int trackSizes[] = {1000, 10000, 100000};
+static const int historySizes[] = {10, 100, 500};
+static const int historyTrackPoints = 300;
+
+static QString trackName(int points) {
+    return QString("track-%1.gpx").arg(points);
+}
+
+// Every history size gets its own home, HistoryModel always reads $HOME/Rena
+static QString historyHome(const QTemporaryDir &dir, int tracks) {
+    return dir.path() + QString("/history-%1").arg(tracks);
+}
+
+static bool indexed(const QString &path) {
+    TrackSummaryCache cache;
+    TrackSummary summary;
+    return cache.load() && cache.lookup(QFileInfo(path), summary);
+}
+
+void BenchTrackLoader::initTestCase() {
+    QVERIFY(m_dir.isValid());
+    QVERIFY(useTemporaryHome(m_dir.path()));
+    for(unsigned i=0;i<sizeof(trackSizes)/sizeof(trackSizes[0]);i++) {
+        QVERIFY(writeSyntheticGpx(m_dir.path() + "/Rena/" + trackName(trackSizes[i]), trackSizes[i]));
+    }
+
+    for(unsigned i=0;i<sizeof(historySizes)/sizeof(historySizes[0]);i++) {
+        QString rena = historyHome(m_dir, historySizes[i]) + "/Rena";
+        QVERIFY(QDir().mkpath(rena));
+        QString first = rena + "/0000.gpx";
+        QVERIFY(writeSyntheticGpx(first, historyTrackPoints));
+        for(int track=1;track<historySizes[i];track++) {
+            QVERIFY(QFile::copy(first, rena + QString("/%1.gpx").arg(track, 4, 10, QLatin1Char('0'))));
+        }
+    }
+}
+
+void BenchTrackLoader::load_data() {
+    QTest::addColumn<int>("points");
+    for(unsigned i=0;i<sizeof(trackSizes)/sizeof(trackSizes[0]);i++) {
+        QTest::newRow(QByteArray::number(trackSizes[i]).constData()) << trackSizes[i];
+    }
+}
+
+void BenchTrackLoader::load() {
+    QFETCH(int, points);
+    QVERIFY(useTemporaryHome(m_dir.path()));
+
+    QElapsedTimer timer;
+    timer.start();
+    TrackLoader loader;
+    loader.setFilename(trackName(points));
+    QVERIFY(loader.loaded());
+    qint64 nsecs = timer.nsecsElapsed();
+    qDebug("track loader: %d points, %.1f ms, %.0f points/s", points, nsecs / 1e6,
+           points * 1e9 / qMax(nsecs, Q_INT64_C(1)));
+    QCOMPARE(loader.trackPointCount(), points);
+    QVERIFY(loader.distance() > 0);
+
+    QBENCHMARK {
+        TrackLoader loader;
+        loader.setFilename(trackName(points));
+    }
+}
+
+void BenchTrackLoader::loadAsync_data() {
+    load_data();
+}
+
+// Time until the map gets its first points and until the summary is ready
+void BenchTrackLoader::loadAsync() {
+    QFETCH(int, points);
+    QVERIFY(useTemporaryHome(m_dir.path()));
+
+    QElapsedTimer timer;
+    timer.start();
+    TrackLoader loader;
+    loader.setAsynchronous(true);
+    QSignalSpy chunks(&loader, SIGNAL(pointsAdded(int,int)));
+    QSignalSpy track(&loader, SIGNAL(trackChanged()));
+    loader.setFilename(trackName(points));
+    QVERIFY(loader.loading());
+    QVERIFY(!loader.loaded());
+    QTRY_VERIFY_WITH_TIMEOUT(chunks.count() > 0, 60000);
+    qint64 first = timer.nsecsElapsed();
+    QTRY_COMPARE_WITH_TIMEOUT(track.count(), 1, 60000);
+    qint64 nsecs = timer.nsecsElapsed();
+    qDebug("track loader async: %d points in %d chunks, first %.1f ms, all %.1f ms",
+           points, chunks.count(), first / 1e6, nsecs / 1e6);
+
+    int received = 0;
+    for(int i=0;i<chunks.count();i++) {
+        QCOMPARE(chunks.at(i).at(0).toInt(), received);
+        received += chunks.at(i).at(1).toInt();
+    }
+    QCOMPARE(received, points);
+    QVERIFY(!loader.loading());
+    QVERIFY(loader.loaded());
+    QCOMPARE(loader.progress(), 1.0);
+    QCOMPARE(loader.trackPointCount(), points);
+
+    TrackLoader reference;
+    reference.setFilename(trackName(points));
+    QCOMPARE(loader.distance(), reference.distance());
+    QCOMPARE(loader.duration(), reference.duration());
+}
+
+void BenchTrackLoader::cancelAsync() {
+    QVERIFY(useTemporaryHome(m_dir.path()));
+    int points = trackSizes[sizeof(trackSizes)/sizeof(trackSizes[0]) - 1];
+
+    TrackLoader loader;
+    loader.setAsynchronous(true);
+    QSignalSpy track(&loader, SIGNAL(trackChanged()));
+    loader.setFilename(trackName(points));
+    loader.cancel();
+    QVERIFY(!loader.loading());
+    QCOMPARE(loader.trackPointCount(), 0);
+    QTest::qWait(100);
+    QCOMPARE(track.count(), 0);
+    QVERIFY(!loader.loaded());
+
+    // The same filename again, as when the page comes back, parses it all
+    loader.setFilename(trackName(points));
+    QTRY_COMPARE_WITH_TIMEOUT(track.count(), 1, 60000);
+    QCOMPARE(loader.trackPointCount(), points);
+
+    // A new filename starts over
+    loader.setFilename(trackName(trackSizes[0]));
+    QTRY_COMPARE_WITH_TIMEOUT(track.count(), 2, 60000);
+    QCOMPARE(loader.trackPointCount(), trackSizes[0]);
+}
+
+void BenchTrackLoader::historyScan_data() {
+    QTest::addColumn<int>("tracks");
+    for(unsigned i=0;i<sizeof(historySizes)/sizeof(historySizes[0]);i++) {
+        QTest::newRow(QByteArray::number(historySizes[i]).constData()) << historySizes[i];
+    }
+}
+
+// First scan parses every file and writes the summary index, later scans
+// are served from the index
+void BenchTrackLoader::historyScan() {
+    QFETCH(int, tracks);
+    QString home = historyHome(m_dir, tracks);
+    QVERIFY(useTemporaryHome(home));
+    QFile::remove(home + "/Rena/.trackindex");
+
+    QElapsedTimer timer;
+    timer.start();
+    {
+        HistoryModel model;
+        QCOMPARE(model.rowCount(QModelIndex()), tracks);
+        QSignalSpy parsed(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+        QTRY_COMPARE_WITH_TIMEOUT(parsed.count(), tracks, 60000);
+        QTRY_VERIFY(QFile::exists(home + "/Rena/.trackindex"));
+    }
+    qint64 cold = timer.nsecsElapsed();
+
+    timer.restart();
+    {
+        HistoryModel model;
+        QCOMPARE(model.rowCount(QModelIndex()), tracks);
+        QModelIndex last = model.index(tracks - 1);
+        QVERIFY(model.data(last, HistoryModel::DistanceRole).toString() != "-km");
+    }
+    qint64 warm = timer.nsecsElapsed();
+    qDebug("history scan: %d tracks, cold %.1f ms, indexed %.1f ms", tracks, cold / 1e6, warm / 1e6);
+
+    QBENCHMARK {
+        HistoryModel model;
+    }
+}
+
+// A track saved while history scans keeps its index entry, and writers
+// holding an older copy of the index do not drop each other's entries
+void BenchTrackLoader::summaryIndexMerge() {
+    QString home = historyHome(m_dir, historySizes[0]);
+    QVERIFY(useTemporaryHome(home));
+    QString rena = home + "/Rena";
+    QFile::remove(rena + "/.trackindex");
+
+    TrackSummary summary;
+    summary.name = "Saved";
+    summary.time = QDateTime::currentDateTime();
+    summary.duration = 60;
+    summary.distance = 100;
+    summary.speed = 100.0 / 60;
+    {
+        HistoryModel model;
+        QSignalSpy parsed(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+        // What the recorder does when an export finishes
+        QVERIFY(QFile::copy(rena + "/0000.gpx", rena + "/saved.gpx"));
+        TrackSummaryCache cache;
+        cache.load();
+        cache.insert(QFileInfo(rena + "/saved.gpx"), summary);
+        QVERIFY(cache.save());
+        QTRY_COMPARE_WITH_TIMEOUT(parsed.count(), historySizes[0], 60000);
+        QTRY_VERIFY(indexed(rena + "/0000.gpx"));
+    }
+    TrackSummaryCache index;
+    TrackSummary found;
+    QVERIFY(index.load());
+    QVERIFY(index.lookup(QFileInfo(rena + "/saved.gpx"), found));
+    QCOMPARE(found.name, QString("Saved"));
+    QVERIFY(index.lookup(QFileInfo(rena + "/0000.gpx"), found));
+
+    TrackSummaryCache older;
+    older.load();
+    index.remove("saved.gpx");
+    QVERIFY(index.save());
+    older.insert(QFileInfo(rena + "/0001.gpx"), summary);
+    QVERIFY(older.save());
+    QVERIFY(index.load());
+    QVERIFY(!index.lookup(QFileInfo(rena + "/saved.gpx"), found));
+    QVERIFY(index.lookup(QFileInfo(rena + "/0001.gpx"), found));
+    QCOMPARE(found.name, QString("Saved"));
+    QFile::remove(rena + "/saved.gpx");
+}
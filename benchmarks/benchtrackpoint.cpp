@@ -0,0 +1,43 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include "benchtrackpoint.h"
+#include "benchutils.h"
+#include "TrackPoint.h"
+
+void BenchTrackPoint::fromPositionInfo() {
+    QGeoPositionInfo info = syntheticFix(1234);
+    TrackPoint point(info);
+    QVERIFY(point.hasCoordinate());
+    QVERIFY(point.hasTime());
+    QVERIFY(point.hasElevation());
+    QVERIFY(point.hasVerticalAccuracy());
+    QCOMPARE(point.getTime(), info.timestamp());
+
+    qreal sink = 0;
+    QBENCHMARK {
+        for(int i=0;i<1000;i++) {
+            TrackPoint point(info);
+            sink += point.getLatitude();
+        }
+    }
+    QVERIFY(sink != 0);
+}
@@ -0,0 +1,286 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QDir>
+#include <QElapsedTimer>
+#include "benchtrackrecorder.h"
+#include "benchutils.h"
+#include "trackrecorder.h"
+#include "gpxparser.h"
+#include "trackloader.h"
+#include "tracksummarycache.h"
+
+static const int trackSizes[] = {1000, 10000, 100000};
+static const int rideFixes = 18000;    // 5 hours at 1 Hz
+
+static void reportRate(const char *path, int points, qint64 nsecs) {
+    qDebug("%s: %d points, %.1f ms, %.0f points/s", path, points, nsecs / 1e6,
+           points * 1e9 / qMax(nsecs, Q_INT64_C(1)));
+}
+
+void BenchTrackRecorder::initTestCase() {
+    QVERIFY(m_dir.isValid());
+    QVERIFY(useTemporaryHome(m_dir.path()));
+}
+
+// Feeds fixes the way the position source does and stops, which flushes
+// everything still waiting in the sensor fusion
+void BenchTrackRecorder::record(TrackRecorder *recorder, int fixes) {
+    recorder->clearTrack();
+    recorder->setIsTracking(true);
+    for(int i=0;i<fixes;i++) {
+        recorder->positionUpdated(syntheticFix(i));
+    }
+    recorder->setIsTracking(false);
+}
+
+// Fixes from..to with a wheel sensor that measures 10 % less than GPS,
+// the fusion takes the wheel
+void BenchTrackRecorder::recordWithWheel(TrackRecorder *recorder, int from, int to) {
+    recorder->setIsTracking(true);
+    qreal wheel = 0;
+    for(int i=0;i<to;i++) {
+        if(i > 0) {
+            wheel += 0.9 * syntheticFix(i - 1).coordinate().distanceTo(syntheticFix(i).coordinate());
+        }
+        if(i < from) {
+            continue;
+        }
+        QGeoPositionInfo fix = syntheticFix(i);
+        TrackPoint sample;
+        sample.setTimeMs(fix.timestamp().toMSecsSinceEpoch());
+        sample.setDistance(wheel);
+        recorder->positionUpdated(sample);
+        recorder->positionUpdated(fix);
+    }
+    recorder->setIsTracking(false);
+}
+
+void BenchTrackRecorder::positionUpdated_data() {
+    QTest::addColumn<int>("points");
+    for(unsigned i=0;i<sizeof(trackSizes)/sizeof(trackSizes[0]);i++) {
+        QTest::newRow(QByteArray::number(trackSizes[i]).constData()) << trackSizes[i];
+    }
+}
+
+void BenchTrackRecorder::positionUpdated() {
+    QFETCH(int, points);
+    QObject parent;
+    TrackRecorder *recorder = new TrackRecorder(&parent);
+
+    QElapsedTimer timer;
+    timer.start();
+    record(recorder, points);
+    reportRate("recorder positionUpdated", points, timer.nsecsElapsed());
+    QCOMPARE(recorder->points(), points);
+    QVERIFY(recorder->distance() > 0);
+
+    QBENCHMARK {
+        record(recorder, points);
+    }
+    recorder->clearTrack();
+}
+
+// Without sensor samples every fix is stored as soon as it arrives, even
+// with the long intervals of adaptive sampling
+void BenchTrackRecorder::gpsOnly() {
+    QObject parent;
+    TrackRecorder *recorder = new TrackRecorder(&parent);
+    recorder->clearTrack();
+    recorder->setIsTracking(true);
+    for(int i=0;i<100;i++) {
+        recorder->positionUpdated(syntheticFix(i * 20));
+        QCOMPARE(recorder->points(), i + 1);
+    }
+    recorder->setIsTracking(false);
+    QCOMPARE(recorder->points(), 100);
+    recorder->clearTrack();
+}
+
+// Journal written by one recorder is what the next one starts with
+void BenchTrackRecorder::autoSave() {
+    QObject parent;
+    TrackRecorder *recorder = new TrackRecorder(&parent);
+    record(recorder, rideFixes);
+
+    QElapsedTimer timer;
+    timer.start();
+    recorder->autoSave();
+    reportRate("autosave", rideFixes, timer.nsecsElapsed());
+    QVERIFY(QFile::exists(m_dir.path() + "/Rena/Autosave"));
+
+    timer.restart();
+    TrackRecorder *loaded = new TrackRecorder(&parent);
+    reportRate("load autosave", rideFixes, timer.nsecsElapsed());
+    QCOMPARE(loaded->points(), recorder->points());
+    QVERIFY(qAbs(loaded->distance() - recorder->distance()) < 1);
+
+    QBENCHMARK {
+        TrackRecorder restored;
+    }
+    loaded->clearTrack();
+}
+
+// The restored distance is the fused one and later points add to it the
+// same way
+void BenchTrackRecorder::fusedDistance() {
+    QObject parent;
+    TrackRecorder *recorder = new TrackRecorder(&parent);
+    recorder->clearTrack();
+    recordWithWheel(recorder, 0, 1000);
+    qreal gps = recorder->statistics().distance();
+    QVERIFY(qAbs(recorder->distance() - 0.9 * gps) < gps * 0.01);
+    recorder->autoSave();
+
+    TrackRecorder *loaded = new TrackRecorder(&parent);
+    QVERIFY(qAbs(loaded->distance() - recorder->distance()) < 0.01);
+    recordWithWheel(recorder, 1000, 1100);
+    recordWithWheel(loaded, 1000, 1100);
+    QVERIFY(qAbs(loaded->distance() - recorder->distance()) < 0.01);
+    loaded->clearTrack();
+}
+
+// The call only takes the snapshot, writing happens on a worker thread
+void BenchTrackRecorder::exportGpx() {
+    QObject parent;
+    TrackRecorder *recorder = new TrackRecorder(&parent);
+    record(recorder, rideFixes);
+    QSignalSpy finished(recorder, SIGNAL(exportFinished(QString,bool)));
+
+    QElapsedTimer timer;
+    timer.start();
+    recorder->exportGpx("Benchmark", "Exported by the benchmark");
+    reportRate("export gpx, ui thread", rideFixes, timer.nsecsElapsed());
+    QVERIFY(recorder->isExporting());
+    QVERIFY(finished.wait(30000));
+    reportRate("export gpx, written", rideFixes, timer.nsecsElapsed());
+    QCOMPARE(finished.first().at(1).toBool(), true);
+    QVERIFY(!recorder->isExporting());
+
+    QDir dir(m_dir.path() + "/Rena");
+    QStringList files = dir.entryList(QStringList("*.gpx"), QDir::Files);
+    QCOMPARE(files.size(), 1);
+    QCOMPARE(finished.first().at(0).toString(), files.first());
+    GpxTrack track;
+    QCOMPARE(GpxParser::parseFile(dir.filePath(files.first()), track), GpxParser::Ok);
+    QCOMPARE(track.points.size(), rideFixes);
+    QCOMPARE(track.name, QString("Benchmark"));
+    QVERIFY(dir.entryList(QStringList("Autosave*"), QDir::Files).isEmpty());
+
+    // Indexed the way history computes it when it parses the file
+    TrackSummaryCache cache;
+    TrackSummary summary;
+    QVERIFY(cache.load());
+    QVERIFY(cache.lookup(QFileInfo(dir.filePath(files.first())), summary));
+    TrackLoader loader;
+    loader.setFilename(files.first());
+    QCOMPARE(summary.duration, (int)loader.duration());
+    QVERIFY(qAbs(summary.distance - loader.distance()) < 0.01);
+    QVERIFY(qAbs(summary.speed - loader.speed()) < 0.0001);
+
+    QBENCHMARK {
+        recorder->exportGpx("Benchmark", "Exported by the benchmark");
+        recorder->waitForExports();
+    }
+    recorder->clearTrack();
+    dir.remove(files.first());
+}
+
+// A new recording starts while the previous one is still being written,
+// each keeps its own points and autosave
+void BenchTrackRecorder::recordWhileExporting() {
+    QObject parent;
+    TrackRecorder *recorder = new TrackRecorder(&parent);
+    record(recorder, rideFixes);
+    recorder->exportGpx("First", "");
+    recorder->clearTrack();
+
+    recorder->setIsTracking(true);
+    for(int i=0;i<1000;i++) {
+        recorder->positionUpdated(syntheticFix(rideFixes + i));
+    }
+    recorder->setIsTracking(false);
+    recorder->autoSave();
+    recorder->waitForExports();
+
+    QDir dir(m_dir.path() + "/Rena");
+    QStringList files = dir.entryList(QStringList("*First.gpx"), QDir::Files);
+    QCOMPARE(files.size(), 1);
+    GpxTrack track;
+    QCOMPARE(GpxParser::parseFile(dir.filePath(files.first()), track), GpxParser::Ok);
+    QCOMPARE(track.points.size(), rideFixes);
+    QCOMPARE(dir.entryList(QStringList("Autosave*"), QDir::Files), QStringList("Autosave"));
+
+    TrackRecorder restored;
+    QCOMPARE(restored.points(), 1000);
+    restored.clearTrack();
+    dir.remove(files.first());
+}
+
+// The autosave of a track that could not be written comes back on restart
+void BenchTrackRecorder::failedExport() {
+    QObject parent;
+    TrackRecorder *recorder = new TrackRecorder(&parent);
+    record(recorder, 1000);
+    QSignalSpy finished(recorder, SIGNAL(exportFinished(QString,bool)));
+    recorder->exportGpx("Blocked", "");
+    recorder->waitForExports();
+    QCOMPARE(finished.size(), 1);
+    QCOMPARE(finished.first().at(1).toBool(), true);
+
+    // A directory in place of the file makes the next write fail
+    QDir dir(m_dir.path() + "/Rena");
+    QString filename = finished.first().at(0).toString();
+    QVERIFY(dir.remove(filename));
+    QVERIFY(dir.mkdir(filename));
+    recorder->exportGpx("Blocked", "");
+    recorder->clearTrack();
+    recorder->waitForExports();
+    QCOMPARE(finished.size(), 2);
+    QCOMPARE(finished.last().at(1).toBool(), false);
+    QCOMPARE(recorder->failedExports(), 1);
+    QCOMPARE(dir.entryList(QStringList("Autosave*"), QDir::Files), QStringList("Autosave.export-1"));
+
+    // A new recording does not hide the failed one from the next session
+    record(recorder, 10);
+    recorder->autoSave();
+    {
+        TrackRecorder restored;
+        QCOMPARE(restored.points(), recorder->points());
+        QCOMPARE(restored.failedExports(), 1);
+    }
+
+    // Retried with the name it was saved with
+    recorder->retryExports();
+    recorder->waitForExports();
+    QCOMPARE(finished.size(), 3);
+    QCOMPARE(finished.last().at(1).toBool(), false);
+    QCOMPARE(recorder->failedExports(), 1);
+    QVERIFY(dir.rmdir(filename));
+    recorder->retryExports();
+    recorder->waitForExports();
+    QCOMPARE(finished.size(), 4);
+    QCOMPARE(finished.last().at(0).toString(), filename);
+    QCOMPARE(finished.last().at(1).toBool(), true);
+    QCOMPARE(recorder->failedExports(), 0);
+    QVERIFY(!QFile::exists(dir.filePath("Autosave.export-1")));
+    recorder->clearTrack();
+}
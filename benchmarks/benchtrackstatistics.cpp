@@ -0,0 +1,132 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <qmath.h>
+#include "benchtrackstatistics.h"
+#include "trackstatistics.h"
+
+// QGeoCoordinate::distanceTo() works on a 6371.0072 km sphere, matching it
+// keeps the split boundaries exact
+static const qreal metresPerLatitude = 6371007.2 * M_PI / 180;
+static const qint64 startMs = Q_INT64_C(1400000000000);
+
+// 1 Hz run north: 6 km at 4 m/s with the third km at 5 m/s, a minute
+// standing still at 2 km, 50 m up and back down, +-2 m of elevation noise
+static QVector<TrackPoint> run() {
+    QVector<TrackPoint> points;
+    qreal distance = 0;
+    qint64 ms = 0;
+    quint32 seed = 1;
+    while(distance < 6000) {
+        qreal speed = distance >= 3000 && distance < 4000 ? 5 : 4;
+        seed = seed * 1103515245 + 12345;
+        qreal noise = ((seed >> 16) % 400) / 100.0 - 2;
+        TrackPoint point;
+        point.setTimeMs(startMs + ms);
+        point.setLatitude(61.4981 + distance / metresPerLatitude);
+        point.setLongitude(23.7608);
+        point.setElevation((distance < 3000 ? distance : 6000 - distance) / 60 + noise);
+        point.setGroundSpeed(speed);
+        point.setCadence(distance < 100 ? 0 : 85);
+        points.append(point);
+        if(distance == 2000) {
+            for(int i=0;i<60;i++) {
+                ms += 1000;
+                point.setTimeMs(startMs + ms);
+                points.append(point);
+            }
+        }
+        ms += 1000;
+        distance += speed;
+    }
+    return points;
+}
+
+static void addAll(TrackStatistics &statistics, const QVector<TrackPoint> &points) {
+    for(int i=0;i<points.size();i++) {
+        statistics.add(points.at(i));
+    }
+}
+
+void BenchTrackStatistics::summary() {
+    TrackStatistics statistics;
+    QCOMPARE(statistics.averageSpeed(), 0.0);
+    QCOMPARE(statistics.pace(), 0.0);
+    QCOMPARE(statistics.best1km(), Q_INT64_C(-1));
+
+    addAll(statistics, run());
+    QVERIFY(qAbs(statistics.distance() - 6000) < 10);
+    QCOMPARE(statistics.elapsedMs() - statistics.movingMs(), Q_INT64_C(60000));
+    QVERIFY(statistics.movingSpeed() > statistics.averageSpeed());
+    QCOMPARE(statistics.maxSpeed(), 5.0);
+    QCOMPARE(statistics.averageCadence(), 85.0);
+    QCOMPARE(statistics.maxCadence(), 85.0);
+    // The noise stays below the hysteresis
+    QVERIFY(qAbs(statistics.ascent() - 50) < 5);
+    QVERIFY(qAbs(statistics.descent() - 50) < 5);
+
+    statistics.clear();
+    QCOMPARE(statistics.pointCount(), 0);
+    QCOMPARE(statistics.distance(), 0.0);
+}
+
+void BenchTrackStatistics::splits() {
+    TrackStatistics statistics;
+    addAll(statistics, run());
+    const QVector<qint64> &km = statistics.kmSplits();
+    QCOMPARE(km.size(), 5);
+    // 250 s per km at 4 m/s, the stop lands in the third km
+    QVERIFY(qAbs(km.at(0) - 250000) < 2000);
+    QVERIFY(qAbs(km.at(2) - 310000) < 2000);
+    QVERIFY(qAbs(km.at(3) - 200000) < 2000);
+    QCOMPARE(statistics.mileSplits().size(), 3);
+}
+
+void BenchTrackStatistics::bestEfforts() {
+    TrackStatistics statistics;
+    addAll(statistics, run());
+    QVERIFY(qAbs(statistics.best1km() - 200000) < 2000);
+    // Every 5 km window includes the stop
+    QVERIFY(qAbs(statistics.best5km() - 1260000) < 5000);
+}
+
+// Flat ground with GPS altitude noise must not climb
+void BenchTrackStatistics::elevationNoise() {
+    TrackStatistics statistics;
+    quint32 seed = 7;
+    for(int i=0;i<3600;i++) {
+        seed = seed * 1103515245 + 12345;
+        TrackPoint point;
+        point.setTimeMs(startMs + i * 1000);
+        point.setElevation(120 + ((seed >> 16) % 800) / 100.0 - 4);
+        statistics.add(point);
+    }
+    QVERIFY(statistics.ascent() < 10);
+    QVERIFY(statistics.descent() < 10);
+}
+
+void BenchTrackStatistics::add() {
+    QVector<TrackPoint> points = run();
+    QBENCHMARK {
+        TrackStatistics statistics;
+        addAll(statistics, points);
+    }
+}
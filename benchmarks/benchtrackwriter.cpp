@@ -0,0 +1,231 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QBuffer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QXmlStreamReader>
+#include <QtEndian>
+#include "benchtrackwriter.h"
+#include "benchutils.h"
+#include "trackwriter.h"
+#include "gpxwriter.h"
+#include "fitwriter.h"
+#include "trackstatistics.h"
+
+static const int points = 18000;
+
+static QByteArray writeTrack(TrackWriter::Format format, const TrackPoints &track) {
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QScopedPointer<TrackWriter> writer(TrackWriter::create(format, &buffer));
+    if(!writer->write(track, "Name <&>", "Desc \"quoted\"")) {
+        return QByteArray();
+    }
+    return buffer.data();
+}
+
+// Every third point without a coordinate, like a sensor sample between fixes
+static TrackPoints sparseTrack(int count) {
+    TrackPoints full = syntheticTrack(count);
+    TrackPoints track;
+    for(int i=0;i<count;i++) {
+        TrackPoint point = full.at(i);
+        if(i % 3 == 0) {
+            TrackPoint sample;
+            sample.setTimeMs(point.getTimeMs());
+            for(int field=TrackPoint::Elevation;field<TrackPoint::FieldCount;field++) {
+                if(point.has(field)) {
+                    sample.setValue(field, point.value(field));
+                }
+            }
+            point = sample;
+        }
+        track.append(point);
+    }
+    return track;
+}
+
+void BenchTrackWriter::iterator() {
+    TrackPoints track = syntheticTrack(100);
+    TrackPointIterator all(track);
+    QCOMPARE(all.remaining(), 100);
+    int visited = 0;
+    while(all.next()) {
+        QCOMPARE(all.index(), visited);
+        QCOMPARE(all.timeMs(), track.timeMs(visited));
+        QCOMPARE(all.latitude(), track.latitude(visited));
+        QCOMPARE(all.point().getTimeMs(), track.at(visited).getTimeMs());
+        visited++;
+    }
+    QCOMPARE(visited, 100);
+    QVERIFY(all.atEnd());
+    QVERIFY(!all.next());
+
+    // A copy continues on its own
+    TrackPointIterator range(track, 10, 20);
+    QCOMPARE(range.remaining(), 10);
+    QVERIFY(range.next());
+    TrackPointIterator copy(range);
+    QVERIFY(range.next());
+    QCOMPARE(range.index(), 11);
+    QCOMPARE(copy.index(), 10);
+    QCOMPARE(copy.remaining(), 9);
+
+    // Columns no point has read as NaN
+    TrackPointIterator sparse(track);
+    QVERIFY(sparse.next());
+    QVERIFY(qIsNaN(sparse.value(TrackPoint::VerticalSpeed)));
+}
+
+// GpxWriter on the shared base must not change a byte of the output
+void BenchTrackWriter::gpxUnchanged() {
+    TrackPoints track = sparseTrack(1000);
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(GpxWriter(&buffer).write(track, "Name <&>", "Desc \"quoted\""));
+    QCOMPARE(writeTrack(TrackWriter::Gpx, track), buffer.data());
+    QVERIFY(buffer.data().startsWith("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<gpx "));
+}
+
+void BenchTrackWriter::tcx() {
+    TrackPoints track = sparseTrack(1000);
+    QXmlStreamReader xml(writeTrack(TrackWriter::Tcx, track));
+    int trackpoints = 0;
+    int positions = 0;
+    qreal lapDistance = -1;
+    QString notes;
+    while(!xml.atEnd()) {
+        if(xml.readNext() != QXmlStreamReader::StartElement) {
+            continue;
+        }
+        if(xml.name() == "Trackpoint") {
+            trackpoints++;
+        } else if(xml.name() == "Position") {
+            positions++;
+        } else if(xml.name() == "DistanceMeters" && lapDistance < 0) {
+            lapDistance = xml.readElementText().toDouble();
+        } else if(xml.name() == "Notes") {
+            notes = xml.readElementText();
+        }
+    }
+    QVERIFY(!xml.hasError());
+    QCOMPARE(trackpoints, track.size());
+    QCOMPARE(positions, track.size() - (track.size() + 2) / 3);
+    QCOMPARE(notes, QString("Name <&>\nDesc \"quoted\""));
+    TrackStatistics statistics;
+    for(int i=0;i<track.size();i++) {
+        statistics.add(track.at(i));
+    }
+    QCOMPARE(lapDistance, statistics.distance());
+}
+
+void BenchTrackWriter::geoJson() {
+    TrackPoints track = sparseTrack(1000);
+    QJsonParseError error;
+    QJsonObject feature = QJsonDocument::fromJson(writeTrack(TrackWriter::GeoJson, track), &error).object();
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    QCOMPARE(feature["type"].toString(), QString("Feature"));
+    QJsonObject properties = feature["properties"].toObject();
+    QCOMPARE(properties["name"].toString(), QString("Name <&>"));
+    QCOMPARE(properties["desc"].toString(), QString("Desc \"quoted\""));
+    QJsonArray coordinates = feature["geometry"].toObject()["coordinates"].toArray();
+    QJsonArray times = properties["coordTimes"].toArray();
+    QCOMPARE(coordinates.size(), track.size() - (track.size() + 2) / 3);
+    QCOMPARE(times.size(), coordinates.size());
+    // The first point with a coordinate is the second one
+    QJsonArray first = coordinates.first().toArray();
+    QCOMPARE(first.size(), 3);
+    QCOMPARE(first.at(0).toDouble(), track.longitude(1));
+    QCOMPARE(first.at(1).toDouble(), track.latitude(1));
+    QCOMPARE(first.at(2).toDouble(), track.elevation(1));
+    QCOMPARE(times.first().toString(), track.time(1).toString(Qt::ISODate));
+}
+
+// Checks the header, both CRCs and the message framing, counts records
+void BenchTrackWriter::fit() {
+    TrackPoints track = sparseTrack(1000);
+    QByteArray data = writeTrack(TrackWriter::Fit, track);
+    const uchar *bytes = (const uchar *)data.constData();
+    QVERIFY(data.size() > 16);
+    QCOMPARE((int)bytes[0], 14);
+    QCOMPARE(data.mid(8, 4), QByteArray(".FIT"));
+    quint32 dataSize = qFromLittleEndian<quint32>(bytes + 4);
+    QCOMPARE((int)dataSize + 16, data.size());
+    QCOMPARE(qFromLittleEndian<quint16>(bytes + 12), FitWriter::crc(0, bytes, 12));
+    QCOMPARE(FitWriter::crc(0, bytes, data.size()), (quint16)0);
+
+    int sizes[16] = {0};
+    quint16 globals[16] = {0};
+    int records = 0;
+    int pos = 14;
+    while(pos < 14 + (int)dataSize) {
+        uchar header = bytes[pos++];
+        int local = header & 0x0f;
+        if(header & 0x40) {
+            globals[local] = qFromLittleEndian<quint16>(bytes + pos + 2);
+            int fields = bytes[pos + 4];
+            pos += 5;
+            sizes[local] = 0;
+            for(int i=0;i<fields;i++) {
+                sizes[local] += bytes[pos + 3 * i + 1];
+            }
+            pos += 3 * fields;
+        } else {
+            QVERIFY(sizes[local] > 0);
+            if(globals[local] == 20) {
+                if(records == 1) {
+                    // timestamp, position_lat of the first point with a coordinate
+                    QCOMPARE(qFromLittleEndian<quint32>(bytes + pos),
+                             (quint32)(track.timeMs(1) / 1000 - Q_INT64_C(631065600)));
+                    qint32 lat = qFromLittleEndian<qint32>(bytes + pos + 4);
+                    QVERIFY(qAbs(lat * 180.0 / 2147483648.0 - track.latitude(1)) < 1e-7);
+                }
+                records++;
+            }
+            pos += sizes[local];
+        }
+    }
+    QCOMPARE(pos, 14 + (int)dataSize);
+    QCOMPARE(records, track.size());
+}
+
+void BenchTrackWriter::write_data() {
+    QTest::addColumn<int>("format");
+    QTest::newRow("GPX") << (int)TrackWriter::Gpx;
+    QTest::newRow("TCX") << (int)TrackWriter::Tcx;
+    QTest::newRow("GeoJSON") << (int)TrackWriter::GeoJson;
+    QTest::newRow("FIT") << (int)TrackWriter::Fit;
+}
+
+// A 5 hour ride into memory
+void BenchTrackWriter::write() {
+    QFETCH(int, format);
+    TrackPoints track = syntheticTrack(points);
+    qint64 size = 0;
+    QBENCHMARK {
+        size = writeTrack((TrackWriter::Format)format, track).size();
+    }
+    QVERIFY(size > 0);
+    qDebug("%s: %d points, %lld bytes", qPrintable(TrackWriter::suffix((TrackWriter::Format)format)),
+           points, size);
+}
@@ -0,0 +1,295 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QFile>
+#include <QTimer>
+#include <QNetworkRequest>
+#include "benchuploadqueue.h"
+
+static const int backlog = 60;
+
+HttpStub::HttpStub() :
+    delay(0), failEvery(0), keepAlive(false), rejectGzip(false),
+    requests(0), connections(0), active(0), maxActive(0)
+{
+    connect(this, SIGNAL(newConnection()), this, SLOT(accepted()));
+}
+
+void HttpStub::accepted() {
+    while(hasPendingConnections()) {
+        QTcpSocket *socket = nextPendingConnection();
+        connections++;
+        m_received.insert(socket, QByteArray());
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readable()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+}
+
+void HttpStub::readable() {
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if(!socket || !m_received.contains(socket)) {
+        return;
+    }
+    QByteArray &data = m_received[socket];
+    data.append(socket->readAll());
+    int headerEnd = data.indexOf("\r\n\r\n");
+    if(headerEnd < 0) {
+        return;
+    }
+    QByteArray headers = data.left(headerEnd).toLower();
+    int length = 0;
+    QList<QByteArray> lines = headers.split('\n');
+    for(int i=0;i<lines.size();i++) {
+        if(lines.at(i).startsWith("content-length:")) {
+            length = lines.at(i).mid(15).trimmed().toInt();
+        }
+    }
+    if(data.size() < headerEnd + 4 + length) {
+        return;
+    }
+    lastHeaders = data.left(headerEnd);
+    lastBody = data.mid(headerEnd + 4, length);
+    if(keepAlive) {
+        data.remove(0, headerEnd + 4 + length);
+    } else {
+        m_received.remove(socket);
+    }
+    requests++;
+    active++;
+    maxActive = qMax(maxActive, active);
+    int status = 201;
+    if(failEvery > 0 && requests % failEvery == 0) {
+        status = 500;
+    } else if(rejectGzip && headers.contains("content-encoding: gzip")) {
+        status = 415;
+    }
+    // Same delay for everyone, so answers go out in arrival order
+    m_waiting.append(socket);
+    m_status.append(status);
+    QTimer::singleShot(delay, this, SLOT(respond()));
+}
+
+void HttpStub::respond() {
+    QTcpSocket *socket = m_waiting.takeFirst();
+    int status = m_status.takeFirst();
+    active--;
+    socket->write(QString("HTTP/1.1 %1 Stub\r\nContent-Length: 0\r\n").arg(status).toLatin1());
+    if(keepAlive) {
+        socket->write("Connection: keep-alive\r\n\r\n");
+    } else {
+        socket->write("Connection: close\r\n\r\n");
+        socket->disconnectFromHost();
+    }
+}
+
+UploadClient::UploadClient(UploadQueue *queue, const QUrl &url) :
+    m_queue(queue), m_url(url)
+{
+    connect(queue, SIGNAL(upload(QString)), this, SLOT(upload(QString)));
+    connect(&m_nam, SIGNAL(finished(QNetworkReply*)), this, SLOT(finished(QNetworkReply*)));
+}
+
+void UploadClient::upload(const QString &name) {
+    QNetworkRequest request(m_url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    m_uploads.insert(m_nam.post(request, QByteArray(4096, ' ')), name);
+}
+
+void UploadClient::finished(QNetworkReply *reply) {
+    QString name = m_uploads.take(reply);
+    if(reply->error() == QNetworkReply::NoError) {
+        m_queue->done(name);
+    } else {
+        m_queue->failed(name);
+    }
+    reply->deleteLater();
+}
+
+FailingUploader::FailingUploader(UploadQueue *queue) :
+    m_queue(queue)
+{
+    connect(queue, SIGNAL(upload(QString)), this, SLOT(upload(QString)));
+    m_clock.start();
+}
+
+void FailingUploader::upload(const QString &name) {
+    attempts.append(m_clock.elapsed());
+    m_queue->failed(name);
+}
+
+QString BenchUploadQueue::queueFile(const char *name) const {
+    return m_dir.path() + "/" + name;
+}
+
+void BenchUploadQueue::initTestCase() {
+    QVERIFY(m_dir.isValid());
+}
+
+// State survives reopening, in flight items come back as pending
+void BenchUploadQueue::journal() {
+    QString filename = queueFile("journal");
+    {
+        UploadQueue queue(filename);
+        QVERIFY(queue.open());
+        queue.add("a.gpx");
+        queue.add("b.gpx");
+        queue.add("c.gpx");
+        queue.add("b.gpx");
+        QCOMPARE(queue.size(), 3);
+        queue.failed("b.gpx");
+        queue.failed("b.gpx");
+        queue.done("a.gpx");
+        QCOMPARE(queue.state("b.gpx"), UploadQueue::Waiting);
+    }
+    UploadQueue queue(filename);
+    QVERIFY(queue.open());
+    QCOMPARE(queue.names(), QStringList() << "b.gpx" << "c.gpx");
+    QCOMPARE(queue.attempts("b.gpx"), 2);
+    QCOMPARE(queue.state("b.gpx"), UploadQueue::Pending);
+
+    // Opening compacts, the finished item is gone from the file
+    QFile file(filename);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray("+ b.gpx\n! b.gpx\n! b.gpx\n+ c.gpx\n"));
+}
+
+void BenchUploadQueue::tornRecord() {
+    QString filename = queueFile("torn");
+    QFile file(filename);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("+ a.gpx\n+ b.gpx\n- a.gpx\n? junk\n- b.g");
+    file.close();
+
+    UploadQueue queue(filename);
+    QVERIFY(queue.open());
+    QCOMPARE(queue.names(), QStringList() << "b.gpx");
+    queue.add("c.gpx");
+
+    UploadQueue reopened(filename);
+    QVERIFY(reopened.open());
+    QCOMPARE(reopened.names(), QStringList() << "b.gpx" << "c.gpx");
+}
+
+void BenchUploadQueue::backoff() {
+    UploadQueue queue(queueFile("backoff"));
+    QVERIFY(queue.open());
+    queue.setRetryDelay(100, 400);
+    FailingUploader uploader(&queue);
+    queue.add("a.gpx");
+    queue.start();
+    QTRY_COMPARE_WITH_TIMEOUT(uploader.attempts.size(), 5, 5000);
+    queue.stop();
+
+    // 100, 200, 400, then capped
+    const qint64 expected[] = {100, 200, 400, 400};
+    for(int i=0;i<4;i++) {
+        qint64 gap = uploader.attempts.at(i + 1) - uploader.attempts.at(i);
+        QVERIFY2(gap >= expected[i] - 5 && gap < expected[i] + 250,
+                 qPrintable(QString("retry %1 after %2 ms").arg(i + 1).arg(gap)));
+    }
+    QCOMPARE(queue.attempts("a.gpx"), 5);
+}
+
+// Rejected items and ones out of attempts leave the queue for good
+void BenchUploadQueue::giveUp() {
+    QString filename = queueFile("giveup");
+    {
+        UploadQueue queue(filename);
+        QVERIFY(queue.open());
+        queue.setRetryDelay(10, 10);
+        queue.setMaxAttempts(3);
+        QSignalSpy gaveUp(&queue, SIGNAL(gaveUp(QString)));
+        queue.add("a.gpx");
+        queue.add("b.gpx");
+        queue.rejected("a.gpx");
+        QCOMPARE(gaveUp.size(), 1);
+        QCOMPARE(gaveUp.first().at(0).toString(), QString("a.gpx"));
+
+        FailingUploader uploader(&queue);
+        queue.start();
+        QTRY_COMPARE(gaveUp.size(), 2);
+        QCOMPARE(uploader.attempts.size(), 3);
+        QCOMPARE(gaveUp.last().at(0).toString(), QString("b.gpx"));
+        QCOMPARE(queue.size(), 0);
+        QCOMPARE(queue.inFlight(), 0);
+    }
+    UploadQueue queue(filename);
+    QVERIFY(queue.open());
+    QCOMPARE(queue.size(), 0);
+}
+
+void BenchUploadQueue::drain_data() {
+    QTest::addColumn<int>("maxInFlight");
+    QTest::newRow("1 in flight") << 1;
+    QTest::newRow("3 in flight") << 3;
+    QTest::newRow("6 in flight") << 6;
+}
+
+// A week offline: the backlog goes out against a server taking 50 ms per
+// request and failing every 7th one
+void BenchUploadQueue::drain() {
+    QFETCH(int, maxInFlight);
+    HttpStub server;
+    server.delay = 50;
+    server.failEvery = 7;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    QString filename = queueFile("drain");
+    QFile::remove(filename);
+    UploadQueue queue(filename, maxInFlight);
+    QVERIFY(queue.open());
+    queue.setRetryDelay(20, 1000);
+    for(int i=0;i<backlog;i++) {
+        queue.add(QString("%1.gpx").arg(i));
+    }
+    UploadClient client(&queue, QUrl(QString("http://127.0.0.1:%1/activities").arg(server.serverPort())));
+
+    QElapsedTimer timer;
+    timer.start();
+    queue.start();
+    QTRY_COMPARE_WITH_TIMEOUT(queue.size(), 0, 30000);
+    qint64 msecs = timer.elapsed();
+    qDebug("upload queue: %d tracks, %d in flight, %d requests, %lld ms", backlog, maxInFlight,
+           server.requests, msecs);
+    QVERIFY(server.requests > backlog);
+    QVERIFY(server.maxActive <= maxInFlight);
+    QCOMPARE(queue.inFlight(), 0);
+}
+
+// One after another the uploads share a single connection
+void BenchUploadQueue::keepAlive() {
+    HttpStub server;
+    server.keepAlive = true;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    QString filename = queueFile("keepalive");
+    QFile::remove(filename);
+    UploadQueue queue(filename, 1);
+    QVERIFY(queue.open());
+    for(int i=0;i<10;i++) {
+        queue.add(QString("%1.gpx").arg(i));
+    }
+    UploadClient client(&queue, QUrl(QString("http://127.0.0.1:%1/activities").arg(server.serverPort())));
+    queue.start();
+    QTRY_COMPARE_WITH_TIMEOUT(queue.size(), 0, 10000);
+    QCOMPARE(server.requests, 10);
+    QCOMPARE(server.connections, 1);
+}
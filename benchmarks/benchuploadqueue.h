@@ -0,0 +1,120 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHUPLOADQUEUE_H
+#define BENCHUPLOADQUEUE_H
+
+#include <QObject>
+#include <QTemporaryDir>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+
+#include "../plugins/UploadQueue.h"
+
+// Local HTTP server that answers every request after a delay
+class HttpStub : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    HttpStub();
+    int delay;          // ms before answering
+    int failEvery;      // Every n:th request gets 500, 0 for none
+    bool keepAlive;     // Keep connections open between requests
+    bool rejectGzip;    // Answer gzipped bodies with 415
+    int requests;
+    int connections;
+    int active;
+    int maxActive;      // Most requests being served at once
+    QByteArray lastHeaders;
+    QByteArray lastBody;
+
+private slots:
+    void accepted();
+    void readable();
+    void respond();
+
+private:
+    QHash<QTcpSocket*, QByteArray> m_received;
+    QList<QTcpSocket*> m_waiting;
+    QList<int> m_status;
+};
+
+// Posts whatever the queue hands out to a URL
+class UploadClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    UploadClient(UploadQueue *queue, const QUrl &url);
+
+private slots:
+    void upload(const QString &name);
+    void finished(QNetworkReply *reply);
+
+private:
+    UploadQueue *m_queue;
+    QUrl m_url;
+    QNetworkAccessManager m_nam;
+    QHash<QNetworkReply*, QString> m_uploads;
+};
+
+// Fails every upload right away and records when they were tried
+class FailingUploader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FailingUploader(UploadQueue *queue);
+    QList<qint64> attempts;     // ms since construction
+
+private slots:
+    void upload(const QString &name);
+
+private:
+    UploadQueue *m_queue;
+    QElapsedTimer m_clock;
+};
+
+class BenchUploadQueue : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void journal();
+    void tornRecord();
+    void backoff();
+    void giveUp();
+    void drain_data();
+    void drain();
+    void keepAlive();
+
+private:
+    QString queueFile(const char *name) const;
+    QTemporaryDir m_dir;
+};
+
+#endif // BENCHUPLOADQUEUE_H
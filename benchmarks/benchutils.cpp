@@ -0,0 +1,110 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include <QXmlStreamWriter>
+#include <qmath.h>
+#include "benchutils.h"
+
+TrackPoints syntheticTrack(int count) {
+    TrackPoints points;
+    points.reserve(count);
+    qint64 start = Q_INT64_C(1400000000000);
+    for(int i=0;i<count;i++) {
+        TrackPoint point;
+        point.setTimeMs(start + i * Q_INT64_C(1000));
+        point.setLatitude(61.4981 + i * 0.00001);
+        point.setLongitude(23.7608 + i * 0.000013);
+        point.setElevation(112.5 + (i % 50) * 0.1);
+        point.setDirection(i % 360);
+        point.setGroundSpeed(4.2);
+        point.setHorizontalAccuracy(5);
+        point.setDistance(i * 4.2);
+        point.setCadence(85 + i % 5);
+        points.append(point);
+    }
+    return points;
+}
+
+bool writeSyntheticGpx(const QString &filename, int points) {
+    QFile file(filename);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    QXmlStreamWriter xml(&file);
+    xml.setAutoFormatting(true);
+    xml.writeStartDocument();
+    xml.writeDefaultNamespace("http://www.topografix.com/GPX/1/1");
+    xml.writeStartElement("gpx");
+    xml.writeAttribute("version", "1.1");
+    xml.writeAttribute("Creator", "Rena for Sailfish");
+    xml.writeStartElement("metadata");
+    xml.writeTextElement("name", "Benchmark & track");
+    xml.writeEndElement(); // metadata
+    xml.writeStartElement("trk");
+    xml.writeStartElement("trkseg");
+
+    QDateTime start = QDateTime::fromMSecsSinceEpoch(Q_INT64_C(1400000000000)).toUTC();
+    for(int i=0;i<points;i++) {
+        // Slow spiral around Helsinki, one fix per second
+        qreal angle = i / 600.0;
+        xml.writeStartElement("trkpt");
+        xml.writeAttribute("lat", QString::number(60.17 + 0.01 * qSin(angle) + i * 1e-7, 'g', 15));
+        xml.writeAttribute("lon", QString::number(24.94 + 0.02 * qCos(angle), 'g', 15));
+        xml.writeTextElement("time", start.addSecs(i).toString(Qt::ISODate));
+        xml.writeTextElement("ele", QString::number(20 + 5 * qSin(angle * 3), 'g', 15));
+        xml.writeStartElement("extensions");
+        xml.writeTextElement("dir", QString::number(fmod(angle * 57.3, 360), 'g', 15));
+        xml.writeTextElement("g_spd", QString::number(4 + qSin(angle), 'g', 15));
+        xml.writeTextElement("h_acc", QString::number(5 + i % 7, 'g', 15));
+        xml.writeTextElement("v_acc", QString::number(8 + i % 5, 'g', 15));
+        xml.writeEndElement(); // extensions
+        xml.writeEndElement(); // trkpt
+    }
+
+    xml.writeEndElement(); // trkseg
+    xml.writeEndElement(); // trk
+    xml.writeEndElement(); // gpx
+    xml.writeEndDocument();
+    return file.error() == QFile::NoError;
+}
+
+QGeoPositionInfo syntheticFix(int i) {
+    qreal angle = i / 600.0;
+    QGeoCoordinate coordinate(60.17 + 0.01 * qSin(angle) + i * 1e-7, 24.94 + 0.02 * qCos(angle),
+                              20 + 5 * qSin(angle * 3));
+    QDateTime time = QDateTime::fromMSecsSinceEpoch(Q_INT64_C(1400000000000) + i * Q_INT64_C(1000)).toUTC();
+    QGeoPositionInfo info(coordinate, time);
+    info.setAttribute(QGeoPositionInfo::Direction, fmod(angle * 57.3, 360));
+    info.setAttribute(QGeoPositionInfo::GroundSpeed, 4 + qSin(angle));
+    info.setAttribute(QGeoPositionInfo::VerticalSpeed, 0.1);
+    info.setAttribute(QGeoPositionInfo::HorizontalAccuracy, 5 + i % 7);
+    info.setAttribute(QGeoPositionInfo::VerticalAccuracy, 8 + i % 5);
+    return info;
+}
+
+bool useTemporaryHome(const QString &path) {
+    if(!QDir().mkpath(path + "/Rena")) {
+        return false;
+    }
+    return qputenv("HOME", QFile::encodeName(path));
+}
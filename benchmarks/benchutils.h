@@ -0,0 +1,39 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHUTILS_H
+#define BENCHUTILS_H
+
+#include <QString>
+#include <QGeoPositionInfo>
+
+#include "TrackPoints.h"
+
+// Writes a track of the given length in the layout TrackRecorder::exportGpx() uses
+bool writeSyntheticGpx(const QString &filename, int points);
+// One point per second with every column the writers know filled in
+TrackPoints syntheticTrack(int count);
+// Fix number i of a one fix per second ride with all attributes set
+QGeoPositionInfo syntheticFix(int i);
+// Points $HOME at path and creates the Rena directory under it, the
+// recorder, loader and history all work there
+bool useTemporaryHome(const QString &path);
+
+#endif // BENCHUTILS_H
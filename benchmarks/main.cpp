@@ -0,0 +1,75 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCoreApplication>
+#include <QtTest>
+#include "benchgpxparser.h"
+#include "benchgpxwriter.h"
+#include "benchtrackwriter.h"
+#include "benchisotime.h"
+#include "benchcscdecoder.h"
+#include "benchsensorconnection.h"
+#include "benchkalmanfilter.h"
+#include "benchadaptivesampler.h"
+#include "benchreplay.h"
+#include "benchtrackpoint.h"
+#include "benchtrackrecorder.h"
+#include "benchtrackloader.h"
+#include "benchtrackstatistics.h"
+#include "benchrunkeeper.h"
+#include "benchuploadqueue.h"
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    int status = 0;
+
+    BenchGpxParser gpxParser;
+    status |= QTest::qExec(&gpxParser, argc, argv);
+    BenchGpxWriter gpxWriter;
+    status |= QTest::qExec(&gpxWriter, argc, argv);
+    BenchTrackWriter trackWriter;
+    status |= QTest::qExec(&trackWriter, argc, argv);
+    BenchIsoTime isoTime;
+    status |= QTest::qExec(&isoTime, argc, argv);
+    BenchCscDecoder cscDecoder;
+    status |= QTest::qExec(&cscDecoder, argc, argv);
+    BenchSensorConnection sensorConnection;
+    status |= QTest::qExec(&sensorConnection, argc, argv);
+    BenchKalmanFilter kalmanFilter;
+    status |= QTest::qExec(&kalmanFilter, argc, argv);
+    BenchAdaptiveSampler adaptiveSampler;
+    status |= QTest::qExec(&adaptiveSampler, argc, argv);
+    BenchReplay replay;
+    status |= QTest::qExec(&replay, argc, argv);
+    BenchTrackPoint trackPoint;
+    status |= QTest::qExec(&trackPoint, argc, argv);
+    BenchTrackRecorder trackRecorder;
+    status |= QTest::qExec(&trackRecorder, argc, argv);
+    BenchTrackLoader trackLoader;
+    status |= QTest::qExec(&trackLoader, argc, argv);
+    BenchTrackStatistics trackStatistics;
+    status |= QTest::qExec(&trackStatistics, argc, argv);
+    BenchRunKeeper runKeeper;
+    status |= QTest::qExec(&runKeeper, argc, argv);
+    BenchUploadQueue uploadQueue;
+    status |= QTest::qExec(&uploadQueue, argc, argv);
+
+    return status;
+}
@@ -23,7 +23,22 @@ SOURCES += src/harbour-rena.cpp \
     src/historymodel.cpp \
     src/trackloader.cpp \
     src/settings.cpp \
-    src/plugins.cpp
+    src/plugins.cpp \
+    src/autosavejournal.cpp \
+    src/gpxparser.cpp \
+    src/isotime.cpp \
+    src/trackwriter.cpp \
+    src/gpxwriter.cpp \
+    src/tcxwriter.cpp \
+    src/geojsonwriter.cpp \
+    src/fitwriter.cpp \
+    src/tracksummarycache.cpp \
+    src/pathsimplifier.cpp \
+    src/sensorfusion.cpp \
+    src/gpskalmanfilter.cpp \
+    src/adaptivesampler.cpp \
+    src/replaypositionsource.cpp \
+    src/trackstatistics.cpp
 
 OTHER_FILES += qml/harbour-rena.qml \
     qml/cover/CoverPage.qml \
@@ -43,4 +58,23 @@ HEADERS += \
     src/historymodel.h \
     src/trackloader.h \
     src/settings.h \
-    src/plugins.h
+    src/plugins.h \
+    src/autosavejournal.h \
+    src/gpxparser.h \
+    src/isotime.h \
+    src/trackwriter.h \
+    src/gpxwriter.h \
+    src/tcxwriter.h \
+    src/geojsonwriter.h \
+    src/fitwriter.h \
+    src/tracksummarycache.h \
+    src/pathsimplifier.h \
+    src/sensorfusion.h \
+    src/gpskalmanfilter.h \
+    src/adaptivesampler.h \
+    src/replaypositionsource.h \
+    src/trackstatistics.h \
+    src/TrackPoint.h \
+    src/TrackPoints.h \
+    src/TrackPointIterator.h \
+    src/TrackBounds.h
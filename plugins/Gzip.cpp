@@ -0,0 +1,82 @@
+#include <QDebug>
+
+#include <string.h>
+#include <zlib.h>
+
+#include "Gzip.h"
+
+static const int chunk_size = 16 * 1024;
+// 15 bit window with a gzip header instead of the zlib one
+static const int gzip_window_bits = 15 + 16;
+
+static bool writeAll(QIODevice *out, const char *data, int len) {
+	return len == 0 || out->write(data, len) == len;
+}
+
+bool gzipCompress(QIODevice *in, QIODevice *out) {
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, gzip_window_bits, 8,
+			Z_DEFAULT_STRATEGY) != Z_OK) {
+		return false;
+	}
+	char in_buffer[chunk_size];
+	char out_buffer[chunk_size];
+	bool ok = true;
+	int flush = Z_NO_FLUSH;
+	while (ok && flush != Z_FINISH) {
+		qint64 len = in->read(in_buffer, chunk_size);
+		if (len < 0) {
+			ok = false;
+			break;
+		}
+		flush = in->atEnd() ? Z_FINISH : Z_NO_FLUSH;
+		stream.next_in = (Bytef *) in_buffer;
+		stream.avail_in = len;
+		do {
+			stream.next_out = (Bytef *) out_buffer;
+			stream.avail_out = chunk_size;
+			deflate(&stream, flush);
+			ok = writeAll(out, out_buffer, chunk_size - stream.avail_out);
+		} while (ok && stream.avail_out == 0);
+	}
+	deflateEnd(&stream);
+	if (!ok) {
+		qDebug() << "gzip compression failed" << in->errorString() << out->errorString();
+	}
+	return ok;
+}
+
+bool gzipDecompress(QIODevice *in, QIODevice *out) {
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	if (inflateInit2(&stream, gzip_window_bits) != Z_OK) {
+		return false;
+	}
+	char in_buffer[chunk_size];
+	char out_buffer[chunk_size];
+	int result = Z_OK;
+	bool ok = true;
+	while (ok && result != Z_STREAM_END) {
+		qint64 len = in->read(in_buffer, chunk_size);
+		if (len <= 0) {
+			// Ended before the gzip trailer
+			ok = false;
+			break;
+		}
+		stream.next_in = (Bytef *) in_buffer;
+		stream.avail_in = len;
+		do {
+			stream.next_out = (Bytef *) out_buffer;
+			stream.avail_out = chunk_size;
+			result = inflate(&stream, Z_NO_FLUSH);
+			if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+				ok = false;
+				break;
+			}
+			ok = writeAll(out, out_buffer, chunk_size - stream.avail_out);
+		} while (ok && stream.avail_out == 0 && result != Z_STREAM_END);
+	}
+	inflateEnd(&stream);
+	return ok;
+}
@@ -0,0 +1,14 @@
+#ifndef GZIP_H
+#define GZIP_H
+
+#include <QIODevice>
+
+/*
+ * gzip (RFC 1952) streams through zlib in fixed size chunks, so neither
+ * side has to fit in memory. Both read in until its end and return false
+ * on any read, write or format error.
+ */
+bool gzipCompress(QIODevice *in, QIODevice *out);
+bool gzipDecompress(QIODevice *in, QIODevice *out);
+
+#endif // GZIP_H
@@ -0,0 +1,140 @@
+#include <QDebug>
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "SensorConnection.h"
+
+static const int min_retry_delay = 1000;
+static const int max_retry_delay = 60000;
+static const int connect_timeout = 20000;
+// Packets handled per wakeup before yielding to other sensors
+static const int max_reads = 32;
+
+SensorConnection::SensorConnection(QObject *parent) : QObject(parent) {
+	state = Idle;
+	fd = -1;
+	read_notifier = 0;
+	write_notifier = 0;
+	retry_delay = min_retry_delay;
+	got_data = false;
+	timer = new QTimer(this);
+	timer->setSingleShot(true);
+	QObject::connect(timer, SIGNAL(timeout()), this, SLOT(timeout()));
+}
+
+SensorConnection::~SensorConnection() {
+	closeSocket();
+}
+
+void SensorConnection::start() {
+	if (state != Idle) {
+		return;
+	}
+	retry_delay = min_retry_delay;
+	connectSocket();
+}
+
+void SensorConnection::stop() {
+	timer->stop();
+	closeSocket();
+	state = Idle;
+}
+
+void SensorConnection::connectSocket() {
+	fd = openSocket();
+	if (fd < 0) {
+		failed();
+		return;
+	}
+	state = Connecting;
+	got_data = false;
+	// Writable once connect() has finished, successfully or not
+	write_notifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
+	QObject::connect(write_notifier, SIGNAL(activated(int)), this, SLOT(writable()));
+	timer->start(connect_timeout);
+}
+
+void SensorConnection::closeSocket() {
+	// May run inside a notifier's own activated() signal
+	if (read_notifier) {
+		read_notifier->setEnabled(false);
+		read_notifier->deleteLater();
+		read_notifier = 0;
+	}
+	if (write_notifier) {
+		write_notifier->setEnabled(false);
+		write_notifier->deleteLater();
+		write_notifier = 0;
+	}
+	if (fd >= 0) {
+		::close(fd);
+		fd = -1;
+	}
+}
+
+void SensorConnection::failed() {
+	closeSocket();
+	if (got_data) {
+		// Was working, reconnect quickly
+		retry_delay = min_retry_delay;
+		got_data = false;
+	}
+	qDebug() << "sensor connection failed, retrying in" << retry_delay << "ms";
+	state = Waiting;
+	timer->start(retry_delay);
+	retry_delay = qMin(retry_delay * 2, max_retry_delay);
+}
+
+void SensorConnection::timeout() {
+	if (state == Waiting) {
+		connectSocket();
+	} else if (state == Connecting) {
+		qDebug() << "sensor connect timed out";
+		failed();
+	}
+}
+
+void SensorConnection::writable() {
+	int error = 0;
+	socklen_t len = sizeof(error);
+	write_notifier->setEnabled(false);
+	write_notifier->deleteLater();
+	write_notifier = 0;
+	timer->stop();
+	if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+		qDebug() << "sensor connect failed" << strerror(error ? error : errno);
+		failed();
+		return;
+	}
+	state = Connected;
+	read_notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+	QObject::connect(read_notifier, SIGNAL(activated(int)), this, SLOT(readable()));
+	if (!socketConnected(fd)) {
+		failed();
+	}
+}
+
+void SensorConnection::readable() {
+	uint8_t buf[512];
+	for (int i = 0; i < max_reads && state == Connected; i++) {
+		ssize_t red = ::recv(fd, buf, sizeof(buf), 0);
+		if (red > 0) {
+			got_data = true;
+			packetReceived(buf, red);
+		} else if (red == 0) {
+			qDebug() << "sensor socket closed";
+			failed();
+		} else if (errno == EINTR) {
+			continue;
+		} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			break;
+		} else {
+			qDebug() << "reading sensor socket failed" << strerror(errno);
+			failed();
+		}
+	}
+}
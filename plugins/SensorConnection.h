@@ -0,0 +1,62 @@
+#ifndef SENSORCONNECTION_H
+#define SENSORCONNECTION_H
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <stdint.h>
+
+/*
+ * Non-blocking socket to a sensor driven by the event loop of the thread
+ * the object lives in, so any number of sensors can share one thread.
+ * Subclasses open the socket and handle packets. Failed or dropped
+ * connections are retried with exponential backoff until stop().
+ */
+class SensorConnection : public QObject {
+	Q_OBJECT
+public:
+	explicit SensorConnection(QObject *parent = 0);
+	virtual ~SensorConnection();
+
+	// Both must be called in the thread the object lives in
+	void start();
+	void stop();
+
+	bool isConnected() const {return state == Connected;}
+	int retryDelay() const {return retry_delay;}
+
+protected:
+	// Returns a non-blocking socket with connect() started, or -1
+	virtual int openSocket() = 0;
+	// Called once connect() has completed, return false to drop the
+	// connection
+	virtual bool socketConnected(int fd) {Q_UNUSED(fd); return true;}
+	virtual void packetReceived(const uint8_t *data, int len) = 0;
+
+private slots:
+	void timeout();
+	void writable();
+	void readable();
+
+private:
+	enum State {
+		Idle,
+		Waiting,	// For the retry timer
+		Connecting,
+		Connected
+	};
+	void connectSocket();
+	void closeSocket();
+	void failed();
+
+	State state;
+	int fd;
+	QSocketNotifier *read_notifier;
+	QSocketNotifier *write_notifier;
+	QTimer *timer;
+	int retry_delay;
+	bool got_data;
+};
+
+#endif // SENSORCONNECTION_H
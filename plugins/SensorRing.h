@@ -0,0 +1,100 @@
+#ifndef SENSORRING_H
+#define SENSORRING_H
+
+#include <QAtomicInt>
+
+#include "../src/TrackPoint.h"
+
+/*
+ * Sensor fields of one packet. Plugins only report distance, speed and
+ * cadence, so a sample is a fraction of a full TrackPoint.
+ */
+struct SensorSample {
+	qint64 time;
+	quint16 flags;
+	qreal distance;
+	qreal groundSpeed;
+	qreal cadence;
+
+	static SensorSample fromTrackPoint(const TrackPoint &point) {
+		SensorSample sample;
+		sample.time = point.getTimeMs();
+		sample.flags = point.flags() & (TrackPoint::HasTime | TrackPoint::HasDistance
+				| TrackPoint::HasGroundSpeed | TrackPoint::HasCadence);
+		sample.distance = point.value(TrackPoint::Distance);
+		sample.groundSpeed = point.value(TrackPoint::GroundSpeed);
+		sample.cadence = point.value(TrackPoint::Cadence);
+		return sample;
+	}
+
+	TrackPoint toTrackPoint() const {
+		TrackPoint point;
+		if (flags & TrackPoint::HasTime) {
+			point.setTimeMs(time);
+		}
+		if (flags & TrackPoint::HasDistance) {
+			point.setDistance(distance);
+		}
+		if (flags & TrackPoint::HasGroundSpeed) {
+			point.setGroundSpeed(groundSpeed);
+		}
+		if (flags & TrackPoint::HasCadence) {
+			point.setCadence(cadence);
+		}
+		return point;
+	}
+};
+
+/*
+ * Lock-free single producer, single consumer ring of sensor samples. The
+ * plugin thread pushes, the recorder drains on its own timer. When the
+ * consumer falls behind new samples are dropped and counted rather than
+ * queued without bound.
+ *
+ * Positions run modulo 2 * Capacity so a full ring can be told apart from
+ * an empty one without a separate counter.
+ */
+class SensorRing {
+public:
+	enum {Capacity = 256};
+
+	SensorRing() : m_head(0), m_tail(0), m_dropped(0) {}
+
+	// Producer side
+	bool push(const SensorSample &sample) {
+		int head = m_head.load();
+		int tail = m_tail.loadAcquire();
+		if (((head - tail) & PositionMask) == Capacity) {
+			m_dropped.fetchAndAddRelaxed(1);
+			return false;
+		}
+		m_samples[head & IndexMask] = sample;
+		m_head.storeRelease((head + 1) & PositionMask);
+		return true;
+	}
+
+	// Consumer side
+	bool pop(SensorSample &sample) {
+		int tail = m_tail.load();
+		int head = m_head.loadAcquire();
+		if (head == tail) {
+			return false;
+		}
+		sample = m_samples[tail & IndexMask];
+		m_tail.storeRelease((tail + 1) & PositionMask);
+		return true;
+	}
+
+	// Samples lost to a full ring since the start
+	int dropped() const {return m_dropped.load();}
+
+private:
+	enum {IndexMask = Capacity - 1, PositionMask = 2 * Capacity - 1};
+
+	SensorSample m_samples[Capacity];
+	QAtomicInt m_head;
+	QAtomicInt m_tail;
+	QAtomicInt m_dropped;
+};
+
+#endif // SENSORRING_H
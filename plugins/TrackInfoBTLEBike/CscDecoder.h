@@ -0,0 +1,183 @@
+#ifndef CSCDECODER_H
+#define CSCDECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Decoder for the Bluetooth Cycling Speed and Cadence Measurement
+ * characteristic. Plain C++ without Qt or heap use so captured packets
+ * can be replayed and fuzzed offline.
+ *
+ * Measurement layout (little endian):
+ *   flags      uint8   bit 0 wheel data present, bit 1 crank data present
+ *   wheel revs uint32  cumulative, wraps
+ *   wheel time uint16  last wheel event, 1/1024 s, wraps
+ *   crank revs uint16  cumulative, wraps
+ *   crank time uint16  last crank event, 1/1024 s, wraps
+ */
+class CscDecoder {
+public:
+	enum Flag {
+		WheelData = 0x01,
+		CrankData = 0x02
+	};
+
+	enum Field {
+		Distance = 0x01,	// metres since the decoder was created
+		Speed = 0x02,		// m/s
+		Cadence = 0x04		// rpm
+	};
+
+	struct Result {
+		unsigned fields;
+		double distance;
+		double speed;
+		double cadence;
+	};
+
+	explicit CscDecoder(double circumference = 0) : m_circumference(circumference), m_wheelTotal(0) {
+		resync();
+	}
+
+	// Wheel circumference in metres
+	void setCircumference(double circumference) {m_circumference = circumference;}
+
+	// Forget previous counter values, e.g. after reconnecting. Distance
+	// already travelled is kept.
+	void resync() {
+		m_wheel.valid = false;
+		m_crank.valid = false;
+	}
+
+	// ATT handle value notification: opcode 0x1b, handle, measurement
+	bool decodeNotification(const uint8_t *data, size_t len, Result &result) {
+		if (len < 3 || data[0] != 0x1b) {
+			return false;
+		}
+		return decode(data + 3, len - 3, result);
+	}
+
+	// Bare measurement value starting with the flags byte
+	bool decode(const uint8_t *data, size_t len, Result &result) {
+		// Payload length for each combination of the two data flags
+		static const uint8_t payloadLength[4] = {0, 6, 4, 10};
+
+		result.fields = 0;
+		result.distance = result.speed = result.cadence = 0;
+		if (len < 1) {
+			return false;
+		}
+		uint8_t flags = data[0] & (WheelData | CrankData);
+		if (len < 1u + payloadLength[flags]) {
+			return false;
+		}
+		const uint8_t *p = data + 1;
+
+		if (flags & WheelData) {
+			uint32_t revs = get32(p);
+			uint16_t time = get16(p + 4);
+			p += 6;
+			uint32_t revsDelta;
+			double seconds;
+			switch (update(m_wheel, revs, time, revsDelta, seconds)) {
+			case Moving:
+				m_wheelTotal += revsDelta;
+				result.speed = revsDelta * m_circumference / seconds;
+				result.fields |= Speed;
+				break;
+			case Stopped:
+				result.fields |= Speed;
+				break;
+			default:
+				break;
+			}
+			result.distance = m_wheelTotal * m_circumference;
+			result.fields |= Distance;
+		}
+
+		if (flags & CrankData) {
+			uint16_t revs = get16(p);
+			uint16_t time = get16(p + 2);
+			uint32_t revsDelta;
+			double seconds;
+			switch (update(m_crank, revs, time, revsDelta, seconds, 0xffff)) {
+			case Moving:
+				result.cadence = revsDelta * 60 / seconds;
+				result.fields |= Cadence;
+				break;
+			case Stopped:
+				result.fields |= Cadence;
+				break;
+			default:
+				break;
+			}
+		}
+		return true;
+	}
+
+private:
+	enum Progress {
+		NoData,		// First sample or counter jump, no rate yet
+		Waiting,	// No new event yet, rate unknown
+		Moving,
+		Stopped		// No new event for a while
+	};
+
+	struct Counter {
+		bool valid;
+		uint32_t revs;
+		uint16_t time;
+		int idle;	// Samples since the last new event
+	};
+
+	// Sensors repeat the last event until a new one happens, after this
+	// many repeats the wheel or crank is considered stopped
+	static const int stoppedAfter = 3;
+	// Larger jumps are a sensor reset, not movement
+	static const uint32_t maxRevsDelta = 255;
+
+	static uint16_t get16(const uint8_t *p) {
+		return (uint16_t)(p[0] | (p[1] << 8));
+	}
+
+	static uint32_t get32(const uint8_t *p) {
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	// Counter differences modulo the counter width handle rollover
+	static Progress update(Counter &counter, uint32_t revs, uint16_t time,
+			uint32_t &revsDelta, double &seconds, uint32_t revsMask = 0xffffffff) {
+		if (!counter.valid) {
+			counter.valid = true;
+			counter.revs = revs;
+			counter.time = time;
+			counter.idle = 0;
+			return NoData;
+		}
+		revsDelta = (revs - counter.revs) & revsMask;
+		uint16_t ticks = (uint16_t)(time - counter.time);
+		if (revsDelta > maxRevsDelta) {
+			counter.revs = revs;
+			counter.time = time;
+			counter.idle = 0;
+			return NoData;
+		}
+		if (revsDelta == 0 || ticks == 0) {
+			counter.idle++;
+			return counter.idle >= stoppedAfter ? Stopped : Waiting;
+		}
+		counter.revs = revs;
+		counter.time = time;
+		counter.idle = 0;
+		seconds = ticks / 1024.0;
+		return Moving;
+	}
+
+	double m_circumference;
+	uint64_t m_wheelTotal;
+	Counter m_wheel;
+	Counter m_crank;
+};
+
+#endif // CSCDECODER_H
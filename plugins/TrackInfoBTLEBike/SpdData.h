@@ -1,10 +0,0 @@
-class SpdData {
-public:
-	unsigned short d1;
-	unsigned char d2;
-	unsigned char mode;
-	unsigned int distance_cnt;
-	unsigned short distance_u;
-	unsigned short cadence_cnt;
-	unsigned short cadence_u;
-};
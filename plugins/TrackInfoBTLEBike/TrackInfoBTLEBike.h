@@ -1,32 +1,32 @@
 #include <QObject>
 #include <QtPlugin>
-#include <QThread>
 #include <QSettings>
 #include <QString>
 
 #include "../TrackInfoInterface.h"
+#include "../SensorConnection.h"
 #include "../../src/TrackPoint.h"
+#include "CscDecoder.h"
 
-class TrackInfoBTLEBike : public QObject, public TrackInfoInterface {
+class TrackInfoBTLEBike : public SensorConnection, public TrackInfoInterface {
 	Q_OBJECT
-	Q_PLUGIN_METADATA(IID "org.rena.TrackInfoInterface")
+	Q_PLUGIN_METADATA(IID "org.rena.TrackInfoInterface/3")
 	Q_INTERFACES(TrackInfoInterface)
 public slots:
-    void connect();
-    void read();
-signals:
-	void infoAvailable(TrackPoint info);
+	void setTracking(bool tracking);
+protected:
+	int openSocket();
+	bool socketConnected(int fd);
+	void packetReceived(const uint8_t *data, int len);
 private:
-	int sock;
+	SensorRing ring;
+	CscDecoder decoder;
 	QString mac;
 	short circuit;
-	QThread workerThread;
-	bool thread_exit;
 	QSettings *settings;
 public:
 	TrackInfoBTLEBike();
 	~TrackInfoBTLEBike();
-	void closeThread();
-	void setTracking(bool tracking);
 	QObject* getObject() {return this;}
+	SensorRing* samples() {return &ring;}
 };
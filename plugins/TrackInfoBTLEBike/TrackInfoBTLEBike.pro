@@ -3,9 +3,12 @@ CONFIG += plugin
 QT += positioning location
 LIBS += -lbluetooth
 
-SOURCES += TrackInfoBTLEBike.cpp
+SOURCES += TrackInfoBTLEBike.cpp \
+			../SensorConnection.cpp
 HEADERS += TrackInfoBTLEBike.h \
-			SpdData.h \
+			CscDecoder.h \
+			../SensorRing.h \
+			../SensorConnection.h \
 			../../src/TrackPoint.h
 
 uploads.path = /usr/lib/rena
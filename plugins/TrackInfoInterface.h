@@ -1,11 +1,20 @@
 #include <QObject>
 
+#include "SensorRing.h"
+
+/*
+ * Sensor plugins live in a thread shared by all of them. The host moves
+ * getObject() there and calls setTracking() as a queued slot, so it must
+ * be declared as a slot. Plugins must not block that thread.
+ */
 class TrackInfoInterface {
 public:
 	virtual ~TrackInfoInterface() {}
 	
 	virtual void setTracking(bool tracking) = 0;
 	virtual QObject* getObject() = 0;
+	// Filled by the plugin thread, drained by the recorder
+	virtual SensorRing* samples() = 0;
 };
 
-Q_DECLARE_INTERFACE(TrackInfoInterface, "org.rena.TrackInfoInterface")
+Q_DECLARE_INTERFACE(TrackInfoInterface, "org.rena.TrackInfoInterface/3")
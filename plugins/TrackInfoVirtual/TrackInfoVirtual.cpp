@@ -1,10 +1,14 @@
-#include <QTimer>
+#include <QDebug>
+#include <QDateTime>
 
 #include "TrackInfoVirtual.h"
 
 TrackInfoVirtual::TrackInfoVirtual() {
-	running = 0;
 	counter = 0;
+	// Child so it follows the plugin to the sensor thread
+	timer = new QTimer(this);
+	timer->setInterval(1000);
+	connect(timer, SIGNAL(timeout()), this, SLOT(worker()));
 }
 
 TrackInfoVirtual::~TrackInfoVirtual() {
@@ -13,25 +17,17 @@ TrackInfoVirtual::~TrackInfoVirtual() {
 
 void TrackInfoVirtual::setTracking(bool tracking) {
 	if (tracking) {
-		running = 1;
-		this->moveToThread(&workerThread);
-		QMetaObject::invokeMethod(this, "worker");
-		workerThread.start();
+		timer->start();
 	} else {
-		running = 0;
-		workerThread.quit();
+		timer->stop();
 	}
 }
 
 void TrackInfoVirtual::worker() {
-	if (!running) {
-		return;
-	}
 	TrackPoint p;
 	p.setDistance(counter);
 	p.setCadence(counter*2);
-	p.setTime(QDateTime::currentDateTimeUtc());
-	emit infoAvailable(p);
+	p.setTimeMs(QDateTime::currentMSecsSinceEpoch());
+	ring.push(SensorSample::fromTrackPoint(p));
 	counter++;
-	QTimer::singleShot(1000, this, SLOT(worker()));
 }
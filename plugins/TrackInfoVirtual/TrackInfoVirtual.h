@@ -1,25 +1,24 @@
 #include <QObject>
 #include <QtPlugin>
-#include <QThread>
+#include <QTimer>
 
 #include "../TrackInfoInterface.h"
 #include "../../src/TrackPoint.h"
 
 class TrackInfoVirtual : public QObject, public TrackInfoInterface {
 	Q_OBJECT
-	Q_PLUGIN_METADATA(IID "org.rena.TrackInfoInterface")
+	Q_PLUGIN_METADATA(IID "org.rena.TrackInfoInterface/3")
 	Q_INTERFACES(TrackInfoInterface)
 public slots:
+	void setTracking(bool tracking);
     void worker();
-signals:
-	void infoAvailable(TrackPoint info);
 private:
-	bool running;
+	SensorRing ring;
 	int counter;
-	QThread workerThread;
+	QTimer *timer;
 public:
 	TrackInfoVirtual();
 	~TrackInfoVirtual();
-	void setTracking(bool tracking);
 	QObject* getObject() {return this;}
+	SensorRing* samples() {return &ring;}
 };
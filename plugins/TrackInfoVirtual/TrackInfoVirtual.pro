@@ -4,6 +4,7 @@ QT += positioning location
 
 SOURCES += TrackInfoVirtual.cpp
 HEADERS += TrackInfoVirtual.h \
+			../SensorRing.h \
 			../../src/TrackPoint.h
 
 uploads.path = /usr/lib/rena
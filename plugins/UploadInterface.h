@@ -1,4 +1,7 @@
 #include <QString>
+#include <QVariantList>
+
+#include "../src/TrackPoints.h"
 
 class UploadInterface {
 public:
@@ -7,6 +10,17 @@ public:
 	virtual void showSettings() = 0;
 	virtual void uploadTrack(QString filename) = 0;
 	virtual QString getName() = 0;
+	// Recent uploads as maps of filename, json_bytes, sent_bytes,
+	// latency_ms, compressed and status, oldest first
+	virtual QVariantList getUploadMetrics() {return QVariantList();}
+	// A recording that was just saved, with its points still in memory so
+	// the plugin does not have to read the file back. points is an
+	// implicitly shared copy the plugin may keep.
+	virtual void uploadRecordedTrack(QString filename, const TrackPoints &points, QString description) {
+		Q_UNUSED(points);
+		Q_UNUSED(description);
+		uploadTrack(filename);
+	}
 };
 
-Q_DECLARE_INTERFACE(UploadInterface, "org.rena.UploadInterface")
+Q_DECLARE_INTERFACE(UploadInterface, "org.rena.UploadInterface/2")
@@ -0,0 +1,298 @@
+#include <QDebug>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+
+#include <unistd.h>
+
+#include "UploadQueue.h"
+
+static const int default_min_retry_delay = 30000;
+static const int default_max_retry_delay = 3600000;
+// With the delays above, about two days of retrying
+static const int default_max_attempts = 50;
+// Compaction once the journal is this much longer than the queue
+static const int compact_slack = 64;
+
+UploadQueue::UploadQueue(const QString &filename, int max_in_flight, QObject *parent) :
+	QObject(parent),
+	file(filename),
+	max_in_flight(qMax(max_in_flight, 1)),
+	in_flight(0),
+	min_retry_delay(default_min_retry_delay),
+	max_retry_delay(default_max_retry_delay),
+	max_attempts(default_max_attempts),
+	records(0),
+	live_records(0),
+	running(false)
+{
+	timer = new QTimer(this);
+	timer->setSingleShot(true);
+	QObject::connect(timer, SIGNAL(timeout()), this, SLOT(dispatch()));
+}
+
+bool UploadQueue::open() {
+	QDir().mkpath(QFileInfo(file).absolutePath());
+	if (!file.open(QIODevice::ReadWrite)) {
+		qDebug() << "could not open upload queue" << file.fileName() << file.errorString();
+		return false;
+	}
+	QByteArray data = file.readAll();
+	file.close();
+
+	items.clear();
+	in_flight = 0;
+	records = 0;
+	live_records = 0;
+	int pos = 0;
+	// A line without its newline was torn by a crash and never took effect
+	for (int end = data.indexOf('\n'); end >= 0; pos = end + 1, end = data.indexOf('\n', pos)) {
+		if (end - pos < 3 || data.at(pos + 1) != ' ') {
+			qDebug() << "skipping bad upload queue record" << data.mid(pos, end - pos);
+			continue;
+		}
+		QString name = QString::fromUtf8(data.constData() + pos + 2, end - pos - 2);
+		int index = find(name);
+		switch (data.at(pos)) {
+		case '+':
+			if (index < 0) {
+				Item item = {name, Pending, 0, 0};
+				items.append(item);
+			}
+			break;
+		case '!':
+			if (index >= 0) {
+				items[index].attempts++;
+			}
+			break;
+		case '-':
+			if (index >= 0) {
+				items.removeAt(index);
+			}
+			break;
+		default:
+			qDebug() << "skipping bad upload queue record" << data.mid(pos, end - pos);
+			continue;
+		}
+		records++;
+	}
+	// Always rewritten, this also drops a torn tail
+	if (!compact()) {
+		return false;
+	}
+	schedule();
+	return true;
+}
+
+void UploadQueue::add(const QString &name) {
+	if (contains(name) || !append('+', name)) {
+		return;
+	}
+	Item item = {name, Pending, 0, 0};
+	items.append(item);
+	live_records++;
+	schedule();
+}
+
+void UploadQueue::done(const QString &name) {
+	int index = find(name);
+	if (index < 0) {
+		return;
+	}
+	remove(index);
+	schedule();
+}
+
+void UploadQueue::rejected(const QString &name) {
+	int index = find(name);
+	if (index < 0) {
+		return;
+	}
+	qDebug() << "upload of" << name << "rejected, giving up";
+	remove(index);
+	emit gaveUp(name);
+	schedule();
+}
+
+void UploadQueue::failed(const QString &name) {
+	int index = find(name);
+	if (index < 0) {
+		return;
+	}
+	Item &item = items[index];
+	if (max_attempts > 0 && item.attempts + 1 >= max_attempts) {
+		qDebug() << "upload of" << name << "failed" << max_attempts << "times, giving up";
+		remove(index);
+		emit gaveUp(name);
+		schedule();
+		return;
+	}
+	append('!', name);
+	live_records++;
+	if (item.state == InFlight) {
+		in_flight--;
+	}
+	qint64 delay = min_retry_delay;
+	for (int i = 0; i < item.attempts && delay < max_retry_delay; i++) {
+		delay *= 2;
+	}
+	delay = qMin(delay, (qint64) max_retry_delay);
+	item.attempts++;
+	item.state = Waiting;
+	item.retry_at = QDateTime::currentMSecsSinceEpoch() + delay;
+	qDebug() << "upload of" << name << "failed" << item.attempts << "times, retrying in" << delay << "ms";
+	if (records > live_records + compact_slack) {
+		compact();
+	}
+	schedule();
+}
+
+void UploadQueue::start() {
+	running = true;
+	schedule();
+}
+
+void UploadQueue::stop() {
+	running = false;
+	timer->stop();
+}
+
+UploadQueue::State UploadQueue::state(const QString &name) const {
+	int index = find(name);
+	return index >= 0 ? items.at(index).state : Pending;
+}
+
+int UploadQueue::attempts(const QString &name) const {
+	int index = find(name);
+	return index >= 0 ? items.at(index).attempts : 0;
+}
+
+QStringList UploadQueue::names() const {
+	QStringList list;
+	for (int i = 0; i < items.size(); i++) {
+		list.append(items.at(i).name);
+	}
+	return list;
+}
+
+void UploadQueue::setRetryDelay(int min_delay, int max_delay) {
+	min_retry_delay = qMax(min_delay, 0);
+	max_retry_delay = qMax(max_delay, min_retry_delay);
+}
+
+// Oldest first, a failed item does not hold back the ones behind it
+void UploadQueue::dispatch() {
+	if (!running) {
+		return;
+	}
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	QStringList started;
+	for (int i = 0; i < items.size() && in_flight < max_in_flight; i++) {
+		Item &item = items[i];
+		if (item.state == Pending || (item.state == Waiting && item.retry_at <= now)) {
+			item.state = InFlight;
+			in_flight++;
+			started.append(item.name);
+		}
+	}
+	// Receivers may answer right away and change the list
+	for (int i = 0; i < started.size(); i++) {
+		emit upload(started.at(i));
+	}
+	schedule();
+}
+
+// Arms the timer for the next item that can go out
+void UploadQueue::schedule() {
+	if (!running || in_flight >= max_in_flight) {
+		timer->stop();
+		return;
+	}
+	qint64 next = -1;
+	for (int i = 0; i < items.size(); i++) {
+		const Item &item = items.at(i);
+		if (item.state == Pending) {
+			next = 0;
+			break;
+		}
+		if (item.state == Waiting && (next < 0 || item.retry_at < next)) {
+			next = item.retry_at;
+		}
+	}
+	if (next < 0) {
+		timer->stop();
+		return;
+	}
+	qint64 delay = next > 0 ? qMax(next - QDateTime::currentMSecsSinceEpoch(), (qint64) 0) : 0;
+	timer->start((int) qMin(delay, (qint64) max_retry_delay));
+}
+
+int UploadQueue::find(const QString &name) const {
+	for (int i = 0; i < items.size(); i++) {
+		if (items.at(i).name == name) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool UploadQueue::append(char op, const QString &name) {
+	QByteArray line;
+	line.append(op);
+	line.append(' ');
+	line.append(name.toUtf8());
+	line.append('\n');
+	if (file.write(line) != line.size() || !file.flush() || ::fsync(file.handle()) != 0) {
+		qDebug() << "writing upload queue failed" << file.errorString();
+		return false;
+	}
+	records++;
+	return true;
+}
+
+// Writes the removal and drops the item, compacting once the journal is
+// mostly history
+void UploadQueue::remove(int index) {
+	const Item &item = items.at(index);
+	append('-', item.name);
+	if (item.state == InFlight) {
+		in_flight--;
+	}
+	live_records -= 1 + item.attempts;
+	items.removeAt(index);
+	if (records > live_records + compact_slack) {
+		compact();
+	}
+}
+
+// Replaces the journal with one that only describes the current queue
+bool UploadQueue::compact() {
+	QSaveFile out(file.fileName());
+	if (!out.open(QIODevice::WriteOnly)) {
+		qDebug() << "could not compact upload queue" << out.errorString();
+		return false;
+	}
+	int written = 0;
+	for (int i = 0; i < items.size(); i++) {
+		QByteArray name = items.at(i).name.toUtf8();
+		out.write("+ " + name + "\n");
+		for (int k = 0; k < items.at(i).attempts; k++) {
+			out.write("! " + name + "\n");
+		}
+		written += 1 + items.at(i).attempts;
+	}
+	if (!out.commit()) {
+		qDebug() << "could not compact upload queue" << out.errorString();
+		return false;
+	}
+	records = written;
+	live_records = written;
+	// The old handle still points at the replaced file
+	file.close();
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		qDebug() << "could not open upload queue" << file.errorString();
+		return false;
+	}
+	return true;
+}
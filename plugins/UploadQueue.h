@@ -0,0 +1,98 @@
+#ifndef UPLOADQUEUE_H
+#define UPLOADQUEUE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QFile>
+#include <QTimer>
+
+/*
+ * Persistent queue of tracks waiting for upload, shared by the upload
+ * plugins. Every change is appended to a small journal file and synced
+ * before it takes effect, one line per record:
+ *
+ *   + name	queued
+ *   ! name	an attempt failed
+ *   - name	uploaded or given up, removed from the queue
+ *
+ * A torn last line is ignored and the journal is compacted on open. Items
+ * are only removed after done(), so after a crash anything that was in
+ * flight is sent again.
+ *
+ * While started, up to maxInFlight items at a time are handed out through
+ * upload(). The plugin answers each with done(), failed() or rejected().
+ * Failed items wait with exponential backoff before the next attempt and
+ * are given up after maxAttempts. Rejected ones, e.g. answered with a 4xx
+ * status that will not change, are given up right away. Either way they
+ * are removed and gaveUp() is emitted.
+ */
+class UploadQueue : public QObject {
+	Q_OBJECT
+public:
+	enum State {
+		Pending,
+		InFlight,
+		Waiting		// For the retry timer after a failure
+	};
+
+	explicit UploadQueue(const QString &filename, int max_in_flight = 3, QObject *parent = 0);
+
+	// Replays the journal, false if it could not be opened
+	bool open();
+	void add(const QString &name);
+	void done(const QString &name);
+	void failed(const QString &name);
+	void rejected(const QString &name);
+
+	// Starts or stops handing out items, requests in flight are not touched
+	void start();
+	void stop();
+
+	int size() const {return items.size();}
+	int inFlight() const {return in_flight;}
+	bool contains(const QString &name) const {return find(name) >= 0;}
+	State state(const QString &name) const;
+	int attempts(const QString &name) const;
+	QStringList names() const;
+
+	// Delay after the first failure, doubled for every further one
+	void setRetryDelay(int min_delay, int max_delay);
+	// Failed attempts before an item is given up, 0 for no limit
+	void setMaxAttempts(int attempts) {max_attempts = qMax(attempts, 0);}
+
+signals:
+	void upload(const QString &name);
+	void gaveUp(const QString &name);
+
+private slots:
+	void dispatch();
+
+private:
+	struct Item {
+		QString name;
+		State state;
+		int attempts;
+		qint64 retry_at;
+	};
+	int find(const QString &name) const;
+	bool append(char op, const QString &name);
+	void remove(int index);
+	bool compact();
+	void schedule();
+
+	QFile file;
+	QList<Item> items;
+	QTimer *timer;
+	int max_in_flight;
+	int in_flight;
+	int min_retry_delay;
+	int max_retry_delay;
+	int max_attempts;
+	int records;		// In the journal
+	int live_records;	// Left after compaction
+	bool running;
+};
+
+#endif // UPLOADQUEUE_H
@@ -0,0 +1,143 @@
+#include <QLocale>
+#include <QTemporaryFile>
+#include <QDebug>
+
+#include "RunKeeperActivity.h"
+#include "../Gzip.h"
+#include "../../src/trackstatistics.h"
+
+// Below this the gzip header and the extra pass are not worth it
+static const qint64 gzip_threshold = 1024;
+
+RunKeeperWriter::RunKeeperWriter(QIODevice *device) :
+	TrackWriter(device)
+{
+}
+
+bool RunKeeperWriter::write(TrackPointIterator &points, const QString &name, const QString &description) {
+	Q_UNUSED(name);
+	// Summary pass, the totals come before the points
+	TrackStatistics statistics;
+	int coordinates = 0;
+	bool has_distance = false;
+	int first = -1;
+	int last = -1;
+	qint64 start_ms = 0;
+	TrackPointIterator summary(points);
+	while (summary.next()) {
+		if (first < 0) {
+			first = summary.index();
+			start_ms = summary.timeMs();
+		}
+		last = summary.index();
+		coordinates += summary.has(TrackPoint::HasCoordinate) ? 1 : 0;
+		has_distance |= summary.has(TrackPoint::HasDistance);
+		statistics.add(summary.point());
+	}
+	if (first < 0) {
+		return false;
+	}
+	QDateTime start_time = QDateTime::fromMSecsSinceEpoch(start_ms).toUTC();
+
+	begin();
+	append("{\"type\":\"Cycling\",\"start_time\":");
+	writeJsonString(QLocale::c().toString(start_time, "ddd, d MMM yyyy HH:mm:ss"));
+	append(",\"notes\":");
+	writeJsonString(description);
+	append(",\"total_distance\":");
+	writeJsonNumber(statistics.distance());
+	append(",\"duration\":");
+	writeInteger(statistics.elapsedMs() / 1000);
+
+	if (coordinates > 1) {
+		append(",\"path\":[");
+		TrackPointIterator it(points);
+		bool separate = false;
+		while (!m_error && it.next()) {
+			if (!it.has(TrackPoint::HasCoordinate)) {
+				continue;
+			}
+			// Whole seconds like QDateTime::secsTo()
+			if (separate) {
+				append(",");
+			}
+			append("{\"timestamp\":");
+			separate = true;
+			writeInteger((it.timeMs() - start_ms) / 1000);
+			append(",\"altitude\":");
+			writeJsonNumber(it.elevation());
+			append(",\"longitude\":");
+			writeJsonNumber(it.longitude());
+			append(",\"latitude\":");
+			writeJsonNumber(it.latitude());
+			append(",\"type\":");
+			if (it.index() == first) {
+				append("\"start\"}");
+			} else if (it.index() == last) {
+				append("\"end\"}");
+			} else {
+				append("\"gps\"}");
+			}
+		}
+		append("]");
+	}
+
+	if (has_distance) {
+		append(",\"distance\":[");
+		TrackPointIterator it(points);
+		bool separate = false;
+		double start_distance = 0;
+		while (!m_error && it.next()) {
+			if (!it.has(TrackPoint::HasDistance)) {
+				continue;
+			}
+			if (separate) {
+				append(",");
+			} else {
+				start_distance = it.distance();
+			}
+			append("{\"timestamp\":");
+			separate = true;
+			writeInteger((it.timeMs() - start_ms) / 1000);
+			append(",\"distance\":");
+			writeJsonNumber(it.distance() - start_distance);
+			append("}");
+		}
+		append("]");
+	}
+	append("}");
+	return end();
+}
+
+bool writeRunKeeperActivity(const TrackPoints &points, const QString &description, QIODevice *device) {
+	if (points.isEmpty()) {
+		return false;
+	}
+	return RunKeeperWriter(device).write(points, QString(), description);
+}
+
+QIODevice *createRunKeeperBody(const TrackPoints &points, const QString &description, bool compress,
+		QNetworkRequest &request, qint64 *json_size) {
+	QTemporaryFile *body = new QTemporaryFile();
+	if (!body->open() || !writeRunKeeperActivity(points, description, body) || !body->seek(0)) {
+		qDebug() << "writing upload body failed" << body->errorString();
+		delete body;
+		return 0;
+	}
+	if (json_size) {
+		*json_size = body->size();
+	}
+	if (!compress || body->size() < gzip_threshold) {
+		return body;
+	}
+	QTemporaryFile *packed = new QTemporaryFile();
+	bool ok = packed->open() && gzipCompress(body, packed) && packed->seek(0);
+	delete body;
+	if (!ok) {
+		qDebug() << "compressing upload body failed" << packed->errorString();
+		delete packed;
+		return 0;
+	}
+	request.setRawHeader("Content-Encoding", "gzip");
+	return packed;
+}
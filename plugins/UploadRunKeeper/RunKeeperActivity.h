@@ -0,0 +1,38 @@
+#ifndef RUNKEEPERACTIVITY_H
+#define RUNKEEPERACTIVITY_H
+
+#include <QIODevice>
+#include <QNetworkRequest>
+
+#include "../../src/TrackPoints.h"
+#include "../../src/trackwriter.h"
+
+/*
+ * Writes a track as a RunKeeper NewFitnessActivity document, one more
+ * TrackWriter format. The points go from their columns straight into the
+ * device, no JSON objects are built. The description becomes the notes,
+ * the name is not used.
+ */
+class RunKeeperWriter : public TrackWriter {
+public:
+	explicit RunKeeperWriter(QIODevice *device);
+	using TrackWriter::write;
+	bool write(TrackPointIterator &points, const QString &name, const QString &description);
+};
+
+/*
+ * Points can come from a TrackLoader or straight from the recorder.
+ * Returns false if the track has no points or writing failed.
+ */
+bool writeRunKeeperActivity(const TrackPoints &points, const QString &description, QIODevice *device);
+
+/*
+ * Writes the activity into a temporary file ready for
+ * QNetworkAccessManager::post(). With compress set, bodies worth it are
+ * gzipped and Content-Encoding is added to request. The uncompressed size
+ * goes to json_size. Returns 0 on failure, the caller owns the file.
+ */
+QIODevice *createRunKeeperBody(const TrackPoints &points, const QString &description, bool compress,
+		QNetworkRequest &request, qint64 *json_size = 0);
+
+#endif // RUNKEEPERACTIVITY_H
@@ -8,18 +8,29 @@
 #include <QGeoCoordinate>
 
 #include <QJsonObject>
-#include <QJsonArray>
 #include <QJsonDocument>
 
 #include <QTimer>
 
 #include "UploadRunKeeper.h"
 #include "../../src/trackloader.h"
+#include "RunKeeperActivity.h"
+
+// Requests in flight at once while a backlog drains
+static const int max_uploads = 3;
+// Uploads remembered for getUploadMetrics()
+static const int max_metrics = 20;
 
 UploadRunKeeper::UploadRunKeeper() {
 	settings = new QSettings("Simom", "rena-uploadrunkeeper");
 	nam = new QNetworkAccessManager(this);
 	QObject::connect(nam, SIGNAL(finished(QNetworkReply*)), this, SLOT(finishedNetwork(QNetworkReply*)));
+	QString home_dir = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
+	queue = new UploadQueue(home_dir + "/Rena/.uploadqueue-runkeeper", max_uploads, this);
+	QObject::connect(queue, SIGNAL(upload(QString)), this, SLOT(startUpload(QString)));
+	QObject::connect(queue, SIGNAL(gaveUp(QString)), this, SLOT(dropUpload(QString)));
+	queue->open();
+	migrateTrackQueue();
 	initialized = false;
 	QMetaObject::invokeMethod(this, "initRunKeeper");
 }
@@ -39,8 +50,7 @@ void UploadRunKeeper::finishedNetwork(QNetworkReply* reply) {
 				fitness_activities = obj.value("fitness_activities").toString();
 				qDebug() << "init success" << fitness_activities;
 				initialized = true;
-				uploading = true;
-				QTimer::singleShot(1000, this, SLOT(uploadTrack()));
+				queue->start();
 			} else {
 				qDebug() << "init failed: could not get doc";
 				QTimer::singleShot(60000, this, SLOT(initRunKeeper()));
@@ -49,19 +59,32 @@ void UploadRunKeeper::finishedNetwork(QNetworkReply* reply) {
 			qDebug() << "init failed: network error" << reply->errorString();
 			QTimer::singleShot(60000, this, SLOT(initRunKeeper()));
 		}
-	} else {
+	} else if (uploads.contains(reply)) {
+		Upload upload = uploads.take(reply);
+		int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+		addMetrics(upload, status);
 		if (reply->error() == QNetworkReply::NoError) {
-			qDebug() << "upload success";
-			QString name;
-			getFirstTrackFromQueue(name);
-			delTrackFromQueue(name);
-			QTimer::singleShot(1000, this, SLOT(uploadTrack()));
+			qDebug() << "upload success" << upload.filename;
+			recorded.remove(upload.filename);
+			queue->done(upload.filename);
+		} else if (status == 415 && upload.compressed) {
+			// Unsupported Media Type, the server does not take gzip
+			qDebug() << "gzip rejected, uploading uncompressed from now on";
+			settings->setValue("gzip", false);
+			startUpload(upload.filename);
+		} else if (status == 400 || status == 404 || status == 409 || status == 413 || status == 422) {
+			// The same request would get the same answer. 401 and 403
+			// mean the token went bad, those are retried until it works
+			qDebug() << "upload rejected" << upload.filename << status << reply->errorString();
+			qDebug() << reply->readAll();
+			queue->rejected(upload.filename);
 		} else {
-			qDebug() << "upload failed" << reply->errorString();
+			qDebug() << "upload failed" << upload.filename << reply->errorString();
 			qDebug() << reply->readAll();
-			QTimer::singleShot(60000, this, SLOT(uploadTrack()));
+			queue->failed(upload.filename);
 		}
 	}
+	reply->deleteLater();
 }
 
 void UploadRunKeeper::initRunKeeper() {
@@ -70,7 +93,6 @@ void UploadRunKeeper::initRunKeeper() {
 	QUrl url("http://api.runkeeper.com/user");
 	QNetworkRequest request(url);
 	request.setRawHeader("Authorization", QString("Bearer " + auth).toUtf8());
-	request.setRawHeader("Connection", "Close");
 	nam->get(request);
 }
 
@@ -79,130 +101,95 @@ void UploadRunKeeper::showSettings() {
 }
 
 void UploadRunKeeper::uploadTrack(QString filename) {
-	addTrackToQueue(filename);
-	if (initialized && !uploading) {
-		uploading = true;
-		QMetaObject::invokeMethod(this, "uploadTrack");
-	}
+	queue->add(filename);
 }
 
-void UploadRunKeeper::uploadTrack() {
-	QString filename;
-	if (getFirstTrackFromQueue(filename)) {
-		qDebug() << "got track from queue and now uploading" << filename;
+void UploadRunKeeper::uploadRecordedTrack(QString filename, const TrackPoints &points, QString description) {
+	RecordedTrack track;
+	track.points = points;
+	track.description = description;
+	recorded.insert(filename, track);
+	queue->add(filename);
+}
+
+void UploadRunKeeper::startUpload(const QString &filename) {
+	qDebug() << "uploading" << filename;
+	RecordedTrack track;
+	if (recorded.contains(filename)) {
+		track = recorded.value(filename);
+	} else {
 		TrackLoader loader;
 		loader.setFilename(filename);
-		QDateTime start_time = loader.trackPointTimeAt(0);
-		QJsonObject json;
-		double start_distance = 0;
-		bool has_start_distance = false;
-		json["type"] = QString("Cycling");
-		json["start_time"] = QLocale::c().toString(start_time, "ddd, d MMM yyyy HH:mm:ss");
-		json["notes"] = loader.description();
-		json["total_distance"] = loader.distance();
-		json["duration"] = (int) loader.duration();
-		
-		QJsonArray path;
-		QJsonArray distance;
-		for (int i = 0; i < loader.trackPointCount(); i++) {
-			TrackPoint tp = loader.trackPointAt2(i);
-			QDateTime time = loader.trackPointTimeAt(i);
-			QJsonObject point;
-			QJsonObject distance_point;
-			point["timestamp"] = (int) start_time.secsTo(time);
-			distance_point["timestamp"] = (int) start_time.secsTo(time);
-			if (tp.hasCoordinate()) {
-				point["altitude"] = tp.getElevation();
-				point["longitude"] = tp.getLongitude();
-				point["latitude"] = tp.getLatitude();
-				if (i == 0) {
-					point["type"] = QString("start");
-				} else if (i == loader.trackPointCount()-1) {
-					point["type"] = QString("end");
-				} else {
-					point["type"] = QString("gps");
-				}
-				path.push_back(point);
-			}
-			if (tp.hasDistance()) {
-				if (!has_start_distance) {
-					start_distance = tp.getDistance();
-					has_start_distance = 1;
-				}
-				distance_point["distance"] = tp.getDistance() - start_distance;
-				distance.push_back(distance_point);
-			}
-		}
-		
-		if (path.size() > 1) {
-			json["path"] = path;
-		}
-		if (distance.size()) {
-			json["distance"] = distance;
-		}
-		
-		QJsonDocument doc;
-		doc.setObject(json);
-		
-		QString auth;
-		auth = settings->value("access_token").toString();
-		QUrl url("http://api.runkeeper.com" + fitness_activities);
-		QNetworkRequest request(url);
-		request.setHeader(QNetworkRequest::ContentTypeHeader, "application/vnd.com.runkeeper.NewFitnessActivity+json");
-		request.setRawHeader("Authorization", QString("Bearer " + auth).toUtf8());
-		request.setRawHeader("Connection", "Close");
-		nam->post(request, doc.toJson());
-		
-		qDebug() << "upload track";
-	} else {
-		uploading = false;
+		// description() loads the file, points() does not
+		track.description = loader.description();
+		track.points = loader.points();
+	}
+	if (track.points.isEmpty()) {
+		qDebug() << "nothing to upload in" << filename;
+		recorded.remove(filename);
+		queue->done(filename);
+		return;
+	}
+	QString auth;
+	auth = settings->value("access_token").toString();
+	QUrl url("http://api.runkeeper.com" + fitness_activities);
+	QNetworkRequest request(url);
+	request.setHeader(QNetworkRequest::ContentTypeHeader, "application/vnd.com.runkeeper.NewFitnessActivity+json");
+	request.setRawHeader("Authorization", QString("Bearer " + auth).toUtf8());
+
+	// The body is streamed from disk, memory use does not grow with the track
+	Upload upload;
+	upload.filename = filename;
+	QIODevice *body = createRunKeeperBody(track.points, track.description,
+			settings->value("gzip", true).toBool(), request, &upload.json_bytes);
+	if (!body) {
+		queue->failed(filename);
+		return;
 	}
+	upload.sent_bytes = body->size();
+	upload.compressed = !request.rawHeader("Content-Encoding").isEmpty();
+	upload.timer.start();
+	QNetworkReply *reply = nam->post(request, body);
+	body->setParent(reply);
+	uploads.insert(reply, upload);
+}
+
+void UploadRunKeeper::dropUpload(const QString &filename) {
+	recorded.remove(filename);
 }
 
 QString UploadRunKeeper::getName() {
 	return "Upload Runkeeper";
 }
 
-void UploadRunKeeper::setTrackQueue(QList<QString> &trackqueue) {
-	settings->beginWriteArray("trackqueue");
-	for (int i = 0; i < trackqueue.size(); i++) {
-		settings->setArrayIndex(i);
-		settings->setValue("name", trackqueue.at(i));
+QVariantList UploadRunKeeper::getUploadMetrics() {
+	return metrics;
+}
+
+void UploadRunKeeper::addMetrics(const Upload &upload, int status) {
+	QVariantMap entry;
+	entry.insert("filename", upload.filename);
+	entry.insert("json_bytes", upload.json_bytes);
+	entry.insert("sent_bytes", upload.sent_bytes);
+	entry.insert("latency_ms", upload.timer.elapsed());
+	entry.insert("compressed", upload.compressed);
+	entry.insert("status", status);
+	qDebug() << "upload metrics" << entry;
+	metrics.append(entry);
+	while (metrics.size() > max_metrics) {
+		metrics.removeFirst();
 	}
-	settings->endArray();
 }
 
-QList<QString> UploadRunKeeper::getTrackQueue() {
-	QList<QString> trackqueue;
+// Older versions kept the queue in settings
+void UploadRunKeeper::migrateTrackQueue() {
 	int count = settings->beginReadArray("trackqueue");
 	for (int i = 0; i < count; i++) {
 		settings->setArrayIndex(i);
-		trackqueue.push_back(settings->value("name").toString());
+		queue->add(settings->value("name").toString());
 	}
 	settings->endArray();
-	return trackqueue;
-}
-
-void UploadRunKeeper::addTrackToQueue(QString name) {
-	QList<QString> trackqueue = getTrackQueue();
-	trackqueue.push_back(name);
-	setTrackQueue(trackqueue);
-}
-
-void UploadRunKeeper::delTrackFromQueue(QString name) {
-	QList<QString> trackqueue = getTrackQueue();
-	trackqueue.removeAll(name);
-	setTrackQueue(trackqueue);
-}
-
-bool UploadRunKeeper::getFirstTrackFromQueue(QString &name) {
-	int count = settings->beginReadArray("trackqueue");
 	if (count > 0) {
-		settings->setArrayIndex(0);
-		name = settings->value("name").toString();
-		settings->endArray();
-		return true;
+		settings->remove("trackqueue");
 	}
-	settings->endArray();
-	return false;
 }
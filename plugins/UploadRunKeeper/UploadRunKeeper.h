@@ -4,21 +4,44 @@
 #include <QSettings>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QVariantList>
 
 #include "../UploadInterface.h"
+#include "../UploadQueue.h"
 
 class UploadRunKeeper : public QObject, public UploadInterface {
 	Q_OBJECT
-	Q_PLUGIN_METADATA(IID "org.rena.UploadInterface")
+	Q_PLUGIN_METADATA(IID "org.rena.UploadInterface/2")
 	Q_INTERFACES(UploadInterface)
 public slots:
     void finishedNetwork(QNetworkReply*);
     void initRunKeeper();
-    void uploadTrack();
+    void startUpload(const QString &filename);
+    void dropUpload(const QString &filename);
 private:
+	struct Upload {
+		QString filename;
+		QElapsedTimer timer;
+		qint64 json_bytes;
+		qint64 sent_bytes;
+		bool compressed;
+	};
+	struct RecordedTrack {
+		TrackPoints points;
+		QString description;
+	};
+	void migrateTrackQueue();
+	void addMetrics(const Upload &upload, int status);
+
 	QSettings *settings;
 	QNetworkAccessManager* nam;
-	bool uploading;
+	UploadQueue *queue;
+	QHash<QNetworkReply*, Upload> uploads;
+	// Saved in this session, uploaded without reading the file back
+	QHash<QString, RecordedTrack> recorded;
+	QVariantList metrics;
 	bool initialized;
 	QString fitness_activities;
 public:
@@ -26,10 +49,7 @@ public:
 	~UploadRunKeeper();
 	void showSettings();
 	void uploadTrack(QString filename);
+	void uploadRecordedTrack(QString filename, const TrackPoints &points, QString description);
 	QString getName();
-	void setTrackQueue(QList<QString> &trackqueue);
-	QList<QString> getTrackQueue();
-	void addTrackToQueue(QString name);
-	void delTrackFromQueue(QString name);
-	bool getFirstTrackFromQueue(QString &name);
+	QVariantList getUploadMetrics();
 };
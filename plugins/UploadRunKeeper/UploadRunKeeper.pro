@@ -1,11 +1,41 @@
 TEMPLATE = lib
 CONFIG += plugin
-QT += positioning location
+QT += positioning location concurrent
+LIBS += -lz
 
 SOURCES += UploadRunKeeper.cpp \
-	../../src/trackloader.cpp
+	RunKeeperActivity.cpp \
+	../UploadQueue.cpp \
+	../Gzip.cpp \
+	../../src/trackloader.cpp \
+	../../src/gpxparser.cpp \
+	../../src/isotime.cpp \
+	../../src/trackwriter.cpp \
+	../../src/gpxwriter.cpp \
+	../../src/tcxwriter.cpp \
+	../../src/geojsonwriter.cpp \
+	../../src/fitwriter.cpp \
+	../../src/pathsimplifier.cpp \
+	../../src/trackstatistics.cpp
 HEADERS += UploadRunKeeper.h \
-	../../src/trackloader.h
+	RunKeeperActivity.h \
+	../UploadInterface.h \
+	../UploadQueue.h \
+	../Gzip.h \
+	../../src/trackloader.h \
+	../../src/gpxparser.h \
+	../../src/isotime.h \
+	../../src/trackwriter.h \
+	../../src/gpxwriter.h \
+	../../src/tcxwriter.h \
+	../../src/geojsonwriter.h \
+	../../src/fitwriter.h \
+	../../src/pathsimplifier.h \
+	../../src/trackstatistics.h \
+	../../src/TrackPoint.h \
+	../../src/TrackPoints.h \
+	../../src/TrackPointIterator.h \
+	../../src/TrackBounds.h
 OTHERS += qml/UploadRunKeeper.qml
 
 uploads.path = /usr/lib/rena
@@ -44,5 +44,7 @@ ApplicationWindow {
         objectName: "recorder"
         applicationActive: appWindow.applicationActive
         updateInterval: settings.updateInterval
+        smoothTrack: settings.smoothTrack
+        adaptiveSampling: settings.adaptiveSampling
     }
 }
@@ -33,30 +33,35 @@ Page {
     function setMapViewport() {
         trackMap.zoomLevel = Math.min(trackMap.maximumZoomLevel,
                                       trackLoader.fitZoomLevel(trackMap.width, trackMap.height));
-        trackMap.center = trackLoader.center();
+        trackMap.center = trackLoader.center;
     }
 
     onStatusChanged: {
         if (status === PageStatus.Active) {
             trackLoader.filename = filename;
+        } else if (status === PageStatus.Inactive && pageStack.find(function(p) { return p === detailPage; }) === null) {
+            // Page was popped, no point in parsing the rest
+            trackLoader.cancel();
         }
     }
 
     TrackLoader {
         id: trackLoader
-        onTrackChanged: {
-            var trackLength = trackLoader.trackPointCount();
-            var trackPoints = [];
-            for(var i=0;i<trackLength;i++) {
-				var point = trackLoader.trackPointAt(i);
-				if (point.latitude == point.latitude && point.longitude == point.longitude) {
-					trackPoints.push(point);
-                }
+        asynchronous: true
+        onPointsAdded: {
+            if (from === 0) {
+                // Show the start of the route while the rest is parsed
+                setMapViewport();
+                trackMap.addMapItem(trackLine);
+                trackMap.opacity = 1.0
             }
-            trackLine.path = trackPoints;
-            trackMap.addMapItem(trackLine);
+            trackLine.path = trackLoader.simplifiedPath(trackMap.pathZoom);
+        }
+        onTrackChanged: {
             //trackMap.fitViewportToMapItems(); // Not working
             setMapViewport(); // Workaround for above
+            trackLine.path = trackLoader.simplifiedPath(trackMap.pathZoom);
+            trackMap.addMapItem(trackLine);
         }
         onLoadedChanged: {
             gridContainer.opacity = 1.0
@@ -72,11 +77,22 @@ Page {
     }
 
     BusyIndicator {
+        id: busyIndicator
         anchors.centerIn: detailPage
         running: !trackLoader.loaded
         size: BusyIndicatorSize.Large
     }
 
+    ProgressBar {
+        anchors.top: busyIndicator.bottom
+        width: parent.width
+        visible: trackLoader.loading
+        minimumValue: 0
+        maximumValue: 1
+        value: trackLoader.progress
+        label: "Loading track"
+    }
+
     SilicaFlickable {
         anchors {
             top: parent.top
@@ -209,6 +225,80 @@ Page {
                     width: descriptionData.width
                     text: trackLoader.pace.toFixed(1) + " min/km"
                 }
+                Label {
+                    width: avgSpeedLabel.width
+                    height:movingTimeData.height
+                    horizontalAlignment: Text.AlignRight
+                    verticalAlignment: Text.AlignBottom
+                    color: Theme.secondaryColor
+                    font.pixelSize: Theme.fontSizeSmall
+                    text: "Moving time:"
+                }
+                Label {
+                    id: movingTimeData
+                    width: descriptionData.width
+                    text: trackLoader.formatDuration(trackLoader.movingTime)
+                }
+                Label {
+                    width: avgSpeedLabel.width
+                    height:elevationData.height
+                    horizontalAlignment: Text.AlignRight
+                    verticalAlignment: Text.AlignBottom
+                    color: Theme.secondaryColor
+                    font.pixelSize: Theme.fontSizeSmall
+                    text: "Elevation:"
+                }
+                Label {
+                    id: elevationData
+                    width: descriptionData.width
+                    text: "+" + trackLoader.ascent.toFixed(0) + " m / -"
+                          + trackLoader.descent.toFixed(0) + " m"
+                }
+                Label {
+                    width: avgSpeedLabel.width
+                    height:cadenceData.height
+                    horizontalAlignment: Text.AlignRight
+                    verticalAlignment: Text.AlignBottom
+                    color: Theme.secondaryColor
+                    font.pixelSize: Theme.fontSizeSmall
+                    text: "Cadence:"
+                }
+                Label {
+                    id: cadenceData
+                    width: descriptionData.width
+                    text: trackLoader.maxCadence>0
+                          ? trackLoader.averageCadence.toFixed(0) + " avg, "
+                            + trackLoader.maxCadence.toFixed(0) + " max"
+                          : "-"
+                }
+                Label {
+                    width: avgSpeedLabel.width
+                    height:best1kmData.height
+                    horizontalAlignment: Text.AlignRight
+                    verticalAlignment: Text.AlignBottom
+                    color: Theme.secondaryColor
+                    font.pixelSize: Theme.fontSizeSmall
+                    text: "Best 1 km:"
+                }
+                Label {
+                    id: best1kmData
+                    width: descriptionData.width
+                    text: trackLoader.best1km>=0 ? trackLoader.formatDuration(trackLoader.best1km) : "-"
+                }
+                Label {
+                    width: avgSpeedLabel.width
+                    height:best5kmData.height
+                    horizontalAlignment: Text.AlignRight
+                    verticalAlignment: Text.AlignBottom
+                    color: Theme.secondaryColor
+                    font.pixelSize: Theme.fontSizeSmall
+                    text: "Best 5 km:"
+                }
+                Label {
+                    id: best5kmData
+                    width: descriptionData.width
+                    text: trackLoader.best5km>=0 ? trackLoader.formatDuration(trackLoader.best5km) : "-"
+                }
             }
         }
     }
@@ -228,6 +318,13 @@ Page {
             longitude: 0
         }
         zoomLevel: minimumZoomLevel
+        // Track line detail follows whole zoom levels
+        property int pathZoom: Math.ceil(zoomLevel)
+        onPathZoomChanged: {
+            if(trackLoader.loaded || trackLoader.loading) {
+                trackLine.path = trackLoader.simplifiedPath(pathZoom);
+            }
+        }
         onHeightChanged: setMapViewport()
         onWidthChanged: setMapViewport()
         opacity: 0.1
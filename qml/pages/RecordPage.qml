@@ -31,7 +31,7 @@ Page {
         dialog.accepted.connect(function() {
             console.log("Saving track");
             recorder.exportGpx(dialog.name, dialog.description);
-            recorder.clearTrack();  // TODO: Make sure save was successful?
+            recorder.clearTrack();  // Kept in recorder.failedExports if saving fails
             trackLine.path = [];
         })
     }
@@ -101,15 +101,15 @@ Page {
         recorder.newTrackPoint.connect(newTrackPoint);
         map.addMapItem(positionMarker);
         console.log("RecordPage: Plotting track line");
-        for(var i=0;i<recorder.points;i++) {
-            trackLine.addCoordinate(recorder.trackPointAt(i));
-        }
+        trackLine.path = recorder.simplifiedPath(map.pathZoom);
         console.log("RecordPage: Appending track line to map");
         map.addMapItem(trackLine);
         console.log("RecordPage: Setting map viewport");
         setMapViewport();
     }
 
+    RemorsePopup { id: remorse }
+
     MapCircle {
         id: positionMarker
         center: recorder.currentPosition
@@ -206,6 +206,34 @@ Page {
                 id: header
                 title: "Rena"
             }
+            Column {
+                id: failedExportsItem
+                width: parent.width
+                spacing: Theme.paddingSmall
+                visible: recorder.failedExports > 0
+                Label {
+                    x: Theme.paddingLarge
+                    width: parent.width - 2*Theme.paddingLarge
+                    wrapMode: Text.Wrap
+                    color: Theme.highlightColor
+                    text: recorder.failedExports === 1
+                          ? qsTr("Saving a track failed")
+                          : qsTr("Saving %1 tracks failed").arg(recorder.failedExports)
+                }
+                Row {
+                    anchors.horizontalCenter: parent.horizontalCenter
+                    spacing: Theme.paddingLarge
+                    Button {
+                        text: qsTr("Retry")
+                        onClicked: recorder.retryExports()
+                    }
+                    Button {
+                        text: qsTr("Discard")
+                        onClicked: remorse.execute(qsTr("Discarding unsaved tracks"),
+                                                   function() { recorder.discardFailedExports() })
+                    }
+                }
+            }
             Label {
                 id: stateLabel
                 anchors.horizontalCenter: parent.horizontalCenter
@@ -272,6 +300,10 @@ Page {
             longitude: 0.0
         }
         zoomLevel: minimumZoomLevel
+        // Track line detail follows whole zoom levels, new points are
+        // appended as they come
+        property int pathZoom: Math.ceil(zoomLevel)
+        onPathZoomChanged: trackLine.path = recorder.simplifiedPath(pathZoom)
         onHeightChanged: setMapViewport()
         onWidthChanged: setMapViewport()
         Behavior on height {
@@ -63,6 +63,18 @@ Page {
                     MenuItem { text: qsTr("30 s"); onClicked: settings.updateInterval = 30000; }
                     MenuItem { text: qsTr("1 minute"); onClicked: settings.updateInterval = 60000; }
                 }
+            }
+            TextSwitch {
+                text: qsTr("Smooth track")
+                description: qsTr("Filters GPS noise and holds the position when standing still. Measured positions are kept in the exported GPX.")
+                checked: settings.smoothTrack
+                onCheckedChanged: settings.smoothTrack = checked
+            }
+            TextSwitch {
+                text: qsTr("Adaptive interval")
+                description: qsTr("Uses the track point interval in turns and fewer points on straights and stops. Saves battery on long activities.")
+                checked: settings.adaptiveSampling
+                onCheckedChanged: settings.adaptiveSampling = checked
             }
 			Label {
 				text: "Upload plugins"
@@ -0,0 +1,120 @@
+#ifndef TRACKBOUNDS_H
+#define TRACKBOUNDS_H
+
+#include <QGeoCoordinate>
+#include <qmath.h>
+
+/*
+ * Running bounding box of a track. Points are added one at a time while
+ * the track is parsed or recorded, so the map fit is O(1) afterwards.
+ * Web-Mercator coordinates are normalised to [0, 1] with y growing south.
+ */
+class TrackBounds {
+public:
+	TrackBounds() {clear();}
+
+	void clear() {
+		m_minLat = m_maxLat = m_minLon = m_maxLon = 0;
+		m_sumLat = m_sumLon = 0;
+		m_count = 0;
+	}
+
+	void add(qreal lat, qreal lon) {
+		if (lat != lat || lon != lon) {
+			return;
+		}
+		if (m_count == 0) {
+			m_minLat = m_maxLat = lat;
+			m_minLon = m_maxLon = lon;
+		} else {
+			if (lat < m_minLat) {
+				m_minLat = lat;
+			}
+			if (lat > m_maxLat) {
+				m_maxLat = lat;
+			}
+			if (lon < m_minLon) {
+				m_minLon = lon;
+			}
+			if (lon > m_maxLon) {
+				m_maxLon = lon;
+			}
+		}
+		m_sumLat += lat;
+		m_sumLon += lon;
+		m_count++;
+	}
+
+	void add(const QGeoCoordinate &coordinate) {
+		if (coordinate.isValid()) {
+			add(coordinate.latitude(), coordinate.longitude());
+		}
+	}
+
+	bool isEmpty() const {return m_count == 0;}
+	int count() const {return m_count;}
+	qreal minLatitude() const {return m_minLat;}
+	qreal maxLatitude() const {return m_maxLat;}
+	qreal minLongitude() const {return m_minLon;}
+	qreal maxLongitude() const {return m_maxLon;}
+
+	// Center of the box as drawn on the map, i.e. in Mercator space
+	QGeoCoordinate center() const {
+		if (isEmpty()) {
+			return QGeoCoordinate();
+		}
+		qreal y = (mercatorY(m_minLat) + mercatorY(m_maxLat)) / 2;
+		return QGeoCoordinate(latitudeFromMercatorY(y), (m_minLon + m_maxLon) / 2);
+	}
+
+	// Mean of all added points
+	QGeoCoordinate centroid() const {
+		if (isEmpty()) {
+			return QGeoCoordinate();
+		}
+		return QGeoCoordinate(m_sumLat / m_count, m_sumLon / m_count);
+	}
+
+	qreal mercatorWidth() const {return mercatorX(m_maxLon) - mercatorX(m_minLon);}
+	qreal mercatorHeight() const {return mercatorY(m_minLat) - mercatorY(m_maxLat);}
+
+	// Largest zoom level (256 pixel tiles) that shows the whole box
+	int fitZoomLevel(int width, int height, int maxZoom = 20) const {
+		if (isEmpty() || width < 1 || height < 1) {
+			return maxZoom;
+		}
+		qreal scale = qMin(width / (256.0 * mercatorWidth()), height / (256.0 * mercatorHeight()));
+		if (!(scale < qPow(2, maxZoom))) {
+			// Single point or infinite scale
+			return maxZoom;
+		}
+		return qMax(0, qFloor(qLn(scale) / M_LN2));
+	}
+
+	static qreal mercatorX(qreal lon) {
+		return (lon + 180) / 360;
+	}
+
+	static qreal mercatorY(qreal lat) {
+		// Mercator is undefined at the poles, clip like the map does
+		lat = qBound(-maxLatitudeLimit(), lat, maxLatitudeLimit());
+		return 0.5 - qLn(qTan(M_PI / 4 + lat * M_PI / 360)) / (2 * M_PI);
+	}
+
+	static qreal latitudeFromMercatorY(qreal y) {
+		return 360 / M_PI * qAtan(qExp((0.5 - y) * 2 * M_PI)) - 90;
+	}
+
+	static qreal maxLatitudeLimit() {return 85.05112878;}
+
+private:
+	qreal m_minLat;
+	qreal m_maxLat;
+	qreal m_minLon;
+	qreal m_maxLon;
+	qreal m_sumLat;
+	qreal m_sumLon;
+	int m_count;
+};
+
+#endif // TRACKBOUNDS_H
@@ -6,56 +6,71 @@
 #include <QGeoPositionInfoSource>
 #include <QDebug>
 
+#include <math.h>
+
+/*
+ * Single track point. Values live in one fixed array indexed by Field and
+ * presence is tracked in one bitmask, so a point is a flat ~120 byte value
+ * without heap allocations. Time is kept as UTC milliseconds since epoch.
+ */
 class TrackPoint {
 public:
-	qreal latitude;
-	qreal longitude;
-	QDateTime time;
-	qreal elevation;
-	qreal direction;
-	qreal groundSpeed;
-	qreal verticalSpeed;
-	qreal magneticVariation;
-	qreal horizontalAccuracy;
-	qreal verticalAccuracy;
-	qreal distance;
-	qreal cadence;
-	
-	bool has_coordinate;
-	bool has_time;
-	bool has_elevation;
-	bool has_direction;
-	bool has_ground_speed;
-	bool has_vertical_speed;
-	bool has_magnetic_variation;
-	bool has_horizontal_accuracy;
-	bool has_vertical_accuracy;
-	bool has_distance;
-	bool has_cadence;
-	
+	enum Field {
+		Latitude = 0,
+		Longitude,
+		Elevation,
+		Direction,
+		GroundSpeed,
+		VerticalSpeed,
+		MagneticVariation,
+		HorizontalAccuracy,
+		VerticalAccuracy,
+		Distance,
+		Cadence,
+		RawLatitude,		// Fix before smoothing, on every fix recorded with smoothing on
+		RawLongitude,
+		FieldCount
+	};
+
+	// Bit 0 covers both latitude and longitude, bit 1 is time and the rest
+	// match their Field index
+	enum Flag {
+		HasCoordinate = 1 << 0,
+		HasTime = 1 << 1,
+		HasElevation = 1 << Elevation,
+		HasDirection = 1 << Direction,
+		HasGroundSpeed = 1 << GroundSpeed,
+		HasVerticalSpeed = 1 << VerticalSpeed,
+		HasMagneticVariation = 1 << MagneticVariation,
+		HasHorizontalAccuracy = 1 << HorizontalAccuracy,
+		HasVerticalAccuracy = 1 << VerticalAccuracy,
+		HasDistance = 1 << Distance,
+		HasCadence = 1 << Cadence,
+		HasRawLatitude = 1 << RawLatitude,
+		HasRawLongitude = 1 << RawLongitude
+	};
+
+	static quint16 fieldFlag(int field) {
+		return field <= Longitude ? (quint16)HasCoordinate : (quint16)(1 << field);
+	}
+
 	TrackPoint() {
 		reset();
 	}
-	TrackPoint(QGeoPositionInfo info) {
+	TrackPoint(const QGeoPositionInfo &info) {
 		reset();
 		setQGeoPositionInfo(info);
 	}
-	
+
 	void reset() {
-		 has_coordinate = 0;
-		 has_time = 0;
-		 has_elevation = 0;
-		 has_direction = 0;
-		 has_ground_speed = 0;
-		 has_vertical_speed = 0;
-		 has_magnetic_variation = 0;
-		 has_horizontal_accuracy = 0;
-		 has_vertical_accuracy = 0;
-		 has_distance = 0;
-		 has_cadence = 0;
+		m_flags = 0;
+		m_time = 0;
+		for (int i = 0; i < FieldCount; i++) {
+			m_values[i] = NAN;
+		}
 	}
-	
-	void setQGeoPositionInfo(QGeoPositionInfo info) {
+
+	void setQGeoPositionInfo(const QGeoPositionInfo &info) {
         setLatitude(info.coordinate().latitude());
         setLongitude(info.coordinate().longitude());
         setTime(info.timestamp());
@@ -81,81 +96,90 @@ public:
             setVerticalAccuracy(info.attribute(QGeoPositionInfo::VerticalAccuracy));
         }
 	}
-	
-	void combine(TrackPoint &other, bool overwrite) {
+
+	void combine(const TrackPoint &other, bool overwrite) {
 		if (other.hasCoordinate() && (!hasCoordinate() || overwrite)) {
-			setLatitude(other.getLatitude());
-			setLongitude(other.getLongitude());
+			m_values[Latitude] = other.m_values[Latitude];
+			m_values[Longitude] = other.m_values[Longitude];
+			m_flags |= HasCoordinate;
 		}
 		if (other.hasTime() && (!hasTime() || overwrite)) {
-			setTime(other.getTime());
-		}
-		if (other.hasElevation() && (!hasElevation() || overwrite)) {
-			setElevation(other.getElevation());
-		}
-		if (other.hasDirection() && (!hasDirection() || overwrite)) {
-			setDirection(other.getDirection());
+			setTimeMs(other.getTimeMs());
 		}
-		if (other.hasGroundSpeed() && (!hasGroundSpeed() || overwrite)) {
-			setGroundSpeed(other.getGroundSpeed());
+		for (int i = Elevation; i < FieldCount; i++) {
+			quint16 flag = fieldFlag(i);
+			if ((other.m_flags & flag) && (!(m_flags & flag) || overwrite)) {
+				m_values[i] = other.m_values[i];
+				m_flags |= flag;
+			}
 		}
-		if (other.hasVerticalSpeed() && (!hasVerticalSpeed() || overwrite)) {
-			setVerticalSpeed(other.getVerticalSpeed());
-		}
-		if (other.hasMagneticVariation() && (!hasMagneticVariation() || overwrite)) {
-			setMagneticVariation(other.getMagneticVariation());
-		}
-		if (other.hasHorizontalAccuracy() && (!hasHorizontalAccuracy() || overwrite)) {
-			setHorizontalAccuracy(other.getHorizontalAccuracy());
-		}
-		if (other.hasVerticalAccuracy() && (!hasVerticalAccuracy() || overwrite)) {
-			setVerticalAccuracy(other.getVerticalAccuracy());
-		}
-		if (other.hasDistance() && (!hasDistance() || overwrite)) {
-			setDistance(other.getDistance());
-		}
-		if (other.hasCadence() && (!hasCadence() || overwrite)) {
-			setCadence(other.getCadence());
+	}
+
+	// Generic access used by TrackPoints and the file formats
+	quint16 flags() const {return m_flags;}
+	bool has(int field) const {return m_flags & fieldFlag(field);}
+	qreal value(int field) const {return m_values[field];}
+	void setValue(int field, qreal value) {
+		if (field == Latitude) {
+			setLatitude(value);
+		} else if (field == Longitude) {
+			setLongitude(value);
+		} else {
+			m_values[field] = value;
+			m_flags |= fieldFlag(field);
 		}
 	}
-	
-	void setLatitude(qreal latitude) {this->latitude = latitude; if (latitude != 0 && latitude == latitude) {has_coordinate = 1;} }
-	void setLongitude(qreal longitude) {this->longitude = longitude; if (longitude != 0 && latitude == latitude) {has_coordinate = 1;} }
-	void setTime(QDateTime time) {this->time = time; has_time = 1;}
-	void setElevation(qreal elevation) {this->elevation = elevation; has_elevation = 1;}
-	void setDirection(qreal direction) {this->direction = direction; has_direction = 1;}
-	void setGroundSpeed(qreal ground_speed) {this->groundSpeed = ground_speed; has_ground_speed = 1;}
-	void setVerticalSpeed(qreal vertical_speed) {this->verticalSpeed = vertical_speed; has_vertical_speed = 1;}
-	void setMagneticVariation(qreal magnetic_variation) {this->magneticVariation = magnetic_variation; has_magnetic_variation = 1;}
-	void setHorizontalAccuracy(qreal horizontal_accuracy) {this->horizontalAccuracy = horizontal_accuracy; has_horizontal_accuracy = 1;}
-	void setVerticalAccuracy(qreal vertical_accuracy) {this->verticalAccuracy = vertical_accuracy; has_vertical_accuracy = 1;}
-	void setDistance(qreal distance) {this->distance = distance; has_distance = 1;}
-	void setCadence(qreal cadence) {this->cadence = cadence; has_cadence = 1;}
-	
-	bool hasCoordinate() const {return has_coordinate;}
-	bool hasTime() const {return has_time;}
-	bool hasElevation() const {return has_elevation;}
-	bool hasDirection() const {return has_direction;}
-	bool hasGroundSpeed() const {return has_ground_speed;}
-	bool hasVerticalSpeed() const {return has_vertical_speed;}
-	bool hasMagneticVariation() const {return has_magnetic_variation;}
-	bool hasHorizontalAccuracy() const {return has_horizontal_accuracy;}
-	bool hasVerticalAccuracy() const {return has_vertical_accuracy;}
-	bool hasDistance() const {return has_distance;}
-	bool hasCadence() const {return has_cadence;}
-	
-	qreal getLatitude() const {return latitude;}
-	qreal getLongitude() const {return longitude;}
-	QDateTime getTime() const {return time;}
-	qreal getElevation() const {return elevation;}
-	qreal getDirection() const {return direction;}
-	qreal getGroundSpeed() const {return groundSpeed;}
-	qreal getVerticalSpeed() const {return verticalSpeed;}
-	qreal getMagneticVariation() const {return magneticVariation;}
-	qreal getHorizontalAccuracy() const {return horizontalAccuracy;}
-	qreal getVerticalAccuracy() const {return verticalAccuracy;}
-	qreal getDistance() const {return distance;}
-	qreal getCadence() const {return cadence;}
+
+	void setLatitude(qreal latitude) {m_values[Latitude] = latitude; if (latitude != 0 && latitude == latitude) {m_flags |= HasCoordinate;} }
+	void setLongitude(qreal longitude) {m_values[Longitude] = longitude; if (longitude != 0 && longitude == longitude) {m_flags |= HasCoordinate;} }
+	void setTime(const QDateTime &time) {setTimeMs(time.toMSecsSinceEpoch());}
+	void setTimeMs(qint64 time) {m_time = time; m_flags |= HasTime;}
+	void setElevation(qreal elevation) {setValue(Elevation, elevation);}
+	void setDirection(qreal direction) {setValue(Direction, direction);}
+	void setGroundSpeed(qreal ground_speed) {setValue(GroundSpeed, ground_speed);}
+	void setVerticalSpeed(qreal vertical_speed) {setValue(VerticalSpeed, vertical_speed);}
+	void setMagneticVariation(qreal magnetic_variation) {setValue(MagneticVariation, magnetic_variation);}
+	void setHorizontalAccuracy(qreal horizontal_accuracy) {setValue(HorizontalAccuracy, horizontal_accuracy);}
+	void setVerticalAccuracy(qreal vertical_accuracy) {setValue(VerticalAccuracy, vertical_accuracy);}
+	void setDistance(qreal distance) {setValue(Distance, distance);}
+	void setCadence(qreal cadence) {setValue(Cadence, cadence);}
+	void setRawLatitude(qreal latitude) {setValue(RawLatitude, latitude);}
+	void setRawLongitude(qreal longitude) {setValue(RawLongitude, longitude);}
+
+	bool hasCoordinate() const {return m_flags & HasCoordinate;}
+	bool hasTime() const {return m_flags & HasTime;}
+	bool hasElevation() const {return m_flags & HasElevation;}
+	bool hasDirection() const {return m_flags & HasDirection;}
+	bool hasGroundSpeed() const {return m_flags & HasGroundSpeed;}
+	bool hasVerticalSpeed() const {return m_flags & HasVerticalSpeed;}
+	bool hasMagneticVariation() const {return m_flags & HasMagneticVariation;}
+	bool hasHorizontalAccuracy() const {return m_flags & HasHorizontalAccuracy;}
+	bool hasVerticalAccuracy() const {return m_flags & HasVerticalAccuracy;}
+	bool hasDistance() const {return m_flags & HasDistance;}
+	bool hasCadence() const {return m_flags & HasCadence;}
+	bool hasRawCoordinate() const {return (m_flags & (HasRawLatitude | HasRawLongitude)) == (HasRawLatitude | HasRawLongitude);}
+
+	qreal getLatitude() const {return m_values[Latitude];}
+	qreal getLongitude() const {return m_values[Longitude];}
+	QDateTime getTime() const {return QDateTime::fromMSecsSinceEpoch(m_time).toUTC();}
+	qint64 getTimeMs() const {return m_time;}
+	uint getTimeSecs() const {return (uint)(m_time / 1000);}
+	qreal getElevation() const {return m_values[Elevation];}
+	qreal getDirection() const {return m_values[Direction];}
+	qreal getGroundSpeed() const {return m_values[GroundSpeed];}
+	qreal getVerticalSpeed() const {return m_values[VerticalSpeed];}
+	qreal getMagneticVariation() const {return m_values[MagneticVariation];}
+	qreal getHorizontalAccuracy() const {return m_values[HorizontalAccuracy];}
+	qreal getVerticalAccuracy() const {return m_values[VerticalAccuracy];}
+	qreal getDistance() const {return m_values[Distance];}
+	qreal getCadence() const {return m_values[Cadence];}
+	qreal getRawLatitude() const {return m_values[RawLatitude];}
+	qreal getRawLongitude() const {return m_values[RawLongitude];}
+
+private:
+	qreal m_values[FieldCount];
+	qint64 m_time;
+	quint16 m_flags;
 };
 
 #endif
@@ -0,0 +1,76 @@
+#ifndef TRACKPOINTITERATOR_H
+#define TRACKPOINTITERATOR_H
+
+#include "TrackPoints.h"
+
+/*
+ * Forward-only cursor over a range of a TrackPoints column store, shared
+ * by every exporter. It reads the columns in place, nothing is copied, so
+ * the points must not change while it is in use. Take a snapshot (copies
+ * are implicitly shared) to iterate points that keep growing. Copying the
+ * iterator gives an independent cursor at the same position, writers use
+ * that to make a summary pass before the real one.
+ *
+ *   TrackPointIterator it(points);
+ *   while (it.next()) { ... it.timeMs() ... }
+ */
+class TrackPointIterator {
+public:
+	explicit TrackPointIterator(const TrackPoints &points, int from = 0, int to = -1) :
+		m_times(points.times()),
+		m_flags(points.flagsData()),
+		m_index(from - 1),
+		m_end(to < 0 || to > points.size() ? points.size() : to)
+	{
+		for (int i = 0; i < TrackPoint::FieldCount; i++) {
+			m_columns[i] = points.column(i);
+		}
+	}
+
+	// Moves to the next point, must be called before the first one
+	bool next() {
+		if (m_index < m_end) {
+			m_index++;
+		}
+		return m_index < m_end;
+	}
+	bool atEnd() const {return m_index >= m_end;}
+	// Points next() has yet to visit
+	int remaining() const {return qMax(m_end - m_index - 1, 0);}
+
+	int index() const {return m_index;}
+	quint16 flags() const {return m_flags[m_index];}
+	bool has(quint16 flag) const {return m_flags[m_index] & flag;}
+	qint64 timeMs() const {return m_times[m_index];}
+	qreal value(int field) const {
+		return m_columns[field] ? m_columns[field][m_index] : NAN;
+	}
+	qreal latitude() const {return value(TrackPoint::Latitude);}
+	qreal longitude() const {return value(TrackPoint::Longitude);}
+	qreal elevation() const {return value(TrackPoint::Elevation);}
+	qreal distance() const {return value(TrackPoint::Distance);}
+	qreal cadence() const {return value(TrackPoint::Cadence);}
+
+	TrackPoint point() const {
+		TrackPoint point;
+		quint16 flags = m_flags[m_index];
+		if (flags & TrackPoint::HasTime) {
+			point.setTimeMs(m_times[m_index]);
+		}
+		for (int i = 0; i < TrackPoint::FieldCount; i++) {
+			if (flags & TrackPoint::fieldFlag(i)) {
+				point.setValue(i, m_columns[i][m_index]);
+			}
+		}
+		return point;
+	}
+
+private:
+	const qint64 *m_times;
+	const quint16 *m_flags;
+	const qreal *m_columns[TrackPoint::FieldCount];
+	int m_index;
+	int m_end;
+};
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef TRACKPOINTS_H
+#define TRACKPOINTS_H
+
+#include <QVector>
+
+#include "TrackPoint.h"
+
+/*
+ * Column store for a whole track. Every field has its own contiguous
+ * array so linear scans (distance, bounds, max speed) only touch the
+ * columns they need. Columns are allocated lazily: a field that no point
+ * has costs nothing, missing values in an allocated column are NaN.
+ * Copies are implicitly shared through QVector.
+ */
+class TrackPoints {
+public:
+	int size() const {return m_time.size();}
+	bool isEmpty() const {return m_time.isEmpty();}
+
+	void clear() {
+		m_time.clear();
+		m_flags.clear();
+		for (int i = 0; i < TrackPoint::FieldCount; i++) {
+			m_columns[i].clear();
+		}
+	}
+
+	void reserve(int size) {
+		m_time.reserve(size);
+		m_flags.reserve(size);
+		for (int i = 0; i < TrackPoint::FieldCount; i++) {
+			if (!m_columns[i].isEmpty() || i <= TrackPoint::Longitude) {
+				m_columns[i].reserve(size);
+			}
+		}
+	}
+
+	void append(const TrackPoint &point) {
+		int index = size();
+		m_time.append(point.getTimeMs());
+		m_flags.append(point.flags());
+		for (int i = 0; i < TrackPoint::FieldCount; i++) {
+			if (point.has(i)) {
+				if (m_columns[i].isEmpty()) {
+					m_columns[i].fill(NAN, index);
+				}
+				m_columns[i].append(point.value(i));
+			} else if (!m_columns[i].isEmpty()) {
+				m_columns[i].append(NAN);
+			}
+		}
+	}
+
+	TrackPoint at(int index) const {
+		TrackPoint point;
+		quint16 flags = m_flags.at(index);
+		if (flags & TrackPoint::HasTime) {
+			point.setTimeMs(m_time.at(index));
+		}
+		for (int i = 0; i < TrackPoint::FieldCount; i++) {
+			if (flags & TrackPoint::fieldFlag(i)) {
+				point.setValue(i, m_columns[i].at(index));
+			}
+		}
+		return point;
+	}
+
+	void insert(int index, const TrackPoint &point) {
+		if (index == size()) {
+			append(point);
+			return;
+		}
+		m_time.insert(index, point.getTimeMs());
+		m_flags.insert(index, point.flags());
+		for (int i = 0; i < TrackPoint::FieldCount; i++) {
+			if (point.has(i)) {
+				if (m_columns[i].isEmpty()) {
+					m_columns[i].fill(NAN, size() - 1);
+				}
+				m_columns[i].insert(index, point.value(i));
+			} else if (!m_columns[i].isEmpty()) {
+				m_columns[i].insert(index, NAN);
+			}
+		}
+	}
+
+	// First index whose time is at or after the given second
+	int lowerBound(uint secs) const {
+		int first = 0;
+		int count = size();
+		while (count > 0) {
+			int step = count / 2;
+			if (timeSecs(first + step) < secs) {
+				first += step + 1;
+				count -= step + 1;
+			} else {
+				count = step;
+			}
+		}
+		return first;
+	}
+
+	// Index of the point recorded within the given second, -1 if none
+	int indexOfSecond(uint secs) const {
+		int last = size() - 1;
+		if (last >= 0 && timeSecs(last) == secs) {
+			return last;
+		}
+		int index = lowerBound(secs);
+		if (index < size() && timeSecs(index) == secs) {
+			return index;
+		}
+		return -1;
+	}
+
+	/*
+	 * Adds a sample keeping the track in time order with at most one point
+	 * per second. Samples sharing a second with an existing point are
+	 * combined into it. In-order samples are appended, late ones (plugin
+	 * data arriving after the next GPS fix) go through a binary search.
+	 * Returns the index of the point the sample ended up in.
+	 */
+	int merge(const TrackPoint &point, bool overwrite) {
+		uint secs = point.getTimeSecs();
+		int last = size() - 1;
+		if (last < 0 || timeSecs(last) < secs) {
+			append(point);
+			return last + 1;
+		}
+		int index = timeSecs(last) == secs ? last : lowerBound(secs);
+		if (index < size() && timeSecs(index) == secs) {
+			combine(index, point, overwrite);
+		} else {
+			insert(index, point);
+		}
+		return index;
+	}
+
+	void combine(int index, const TrackPoint &other, bool overwrite) {
+		TrackPoint point = at(index);
+		point.combine(other, overwrite);
+		set(index, point);
+	}
+
+	// Replace point at index, keeping the column layout
+	void set(int index, const TrackPoint &point) {
+		m_time[index] = point.getTimeMs();
+		m_flags[index] = point.flags();
+		for (int i = 0; i < TrackPoint::FieldCount; i++) {
+			if (point.has(i)) {
+				setColumnValue(i, index, point.value(i));
+			} else if (!m_columns[i].isEmpty()) {
+				m_columns[i][index] = NAN;
+			}
+		}
+	}
+
+	quint16 flags(int index) const {return m_flags.at(index);}
+	bool has(int index, quint16 flag) const {return m_flags.at(index) & flag;}
+	bool hasCoordinate(int index) const {return m_flags.at(index) & TrackPoint::HasCoordinate;}
+	qint64 timeMs(int index) const {return m_time.at(index);}
+	uint timeSecs(int index) const {return (uint)(m_time.at(index) / 1000);}
+	QDateTime time(int index) const {return QDateTime::fromMSecsSinceEpoch(m_time.at(index)).toUTC();}
+
+	qreal value(int index, int field) const {
+		return m_columns[field].isEmpty() ? NAN : m_columns[field].at(index);
+	}
+	qreal latitude(int index) const {return value(index, TrackPoint::Latitude);}
+	qreal longitude(int index) const {return value(index, TrackPoint::Longitude);}
+	qreal elevation(int index) const {return value(index, TrackPoint::Elevation);}
+	qreal groundSpeed(int index) const {return value(index, TrackPoint::GroundSpeed);}
+	qreal distance(int index) const {return value(index, TrackPoint::Distance);}
+	qreal cadence(int index) const {return value(index, TrackPoint::Cadence);}
+
+	// Raw column for tight loops, 0 if no point has the field
+	const qreal *column(int field) const {
+		return m_columns[field].isEmpty() ? 0 : m_columns[field].constData();
+	}
+	const qint64 *times() const {return m_time.constData();}
+	const quint16 *flagsData() const {return m_flags.constData();}
+
+private:
+	void setColumnValue(int field, int index, qreal value) {
+		if (m_columns[field].isEmpty()) {
+			m_columns[field].fill(NAN, size());
+		}
+		m_columns[field][index] = value;
+	}
+
+	QVector<qint64> m_time;
+	QVector<quint16> m_flags;
+	QVector<qreal> m_columns[TrackPoint::FieldCount];
+};
+
+#endif
@@ -0,0 +1,225 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QFile>
+#include <QGeoCoordinate>
+#include <qmath.h>
+#include "adaptivesampler.h"
+
+static const char batteryFile[] = "/sys/class/power_supply/battery/capacity";
+static const qint64 batteryCheckInterval = 60000;
+static const int lowBattery = 20;
+// Turn rate above which the base interval is used, degrees per second.
+// The angle catches turns hidden between fixes far apart.
+static const qreal turnRate = 3;
+static const qreal turnAngle = 15;
+// Relative speed change between fixes that counts as not steady
+static const qreal speedChange = 0.15;
+static const qreal stillSpeed = 0.8;
+static const qreal maxSpacing = 40;         // Metres between fixes when steady
+static const int steadyInterval = 5000;     // Caps, before the battery factor
+static const int stationaryInterval = 15000;
+static const int maxInterval = 30000;
+static const int confirmFixes = 3;
+static const int maxDecisions = 100;
+
+static qreal headingDifference(qreal a, qreal b) {
+    qreal d = qAbs(a - b);
+    while(d > 360) {
+        d -= 360;
+    }
+    return d > 180 ? 360 - d : d;
+}
+
+AdaptiveSampler::AdaptiveSampler() {
+    m_baseInterval = 1000;
+    m_batteryOverride = -1;
+    reset();
+}
+
+void AdaptiveSampler::reset() {
+    m_interval = m_baseInterval;
+    m_mode = Base;
+    m_candidate = Base;
+    m_candidateFixes = 0;
+    m_haveLast = false;
+    m_lastHeading = NAN;
+    m_lastSpeed = NAN;
+    m_battery = -1;
+    m_batteryTime = 0;
+    m_decisions.clear();
+}
+
+void AdaptiveSampler::setBaseInterval(int msecs) {
+    m_baseInterval = msecs;
+    m_interval = intervalFor(m_mode, m_lastSpeed, m_battery >= 0 && m_battery < lowBattery);
+}
+
+void AdaptiveSampler::setBatteryLevel(int percent) {
+    m_batteryOverride = percent;
+    m_batteryTime = 0;
+}
+
+const char *AdaptiveSampler::modeName(Mode mode) {
+    switch(mode) {
+    case Base: return "base";
+    case Steady: return "steady";
+    case Stationary: return "stationary";
+    default: return "";
+    }
+}
+
+int AdaptiveSampler::batteryLevel(qint64 time) {
+    if(m_batteryTime != 0 && time - m_batteryTime < batteryCheckInterval) {
+        return m_battery;
+    }
+    m_batteryTime = time;
+    if(m_batteryOverride >= 0) {
+        m_battery = m_batteryOverride;
+        return m_battery;
+    }
+    QFile file(batteryFile);
+    if(!file.open(QIODevice::ReadOnly)) {
+        m_battery = -1;
+        return m_battery;
+    }
+    bool ok = false;
+    int level = file.readAll().trimmed().toInt(&ok);
+    m_battery = ok ? level : -1;
+    return m_battery;
+}
+
+int AdaptiveSampler::intervalFor(Mode mode, qreal speed, bool lowBattery) const {
+    int interval = m_baseInterval;
+    if(mode == Steady) {
+        int spacing = speed > 0 ? (int)(maxSpacing / speed * 1000) : steadyInterval;
+        interval = qMax(m_baseInterval, qMin(spacing, steadyInterval));
+    } else if(mode == Stationary) {
+        interval = qMax(m_baseInterval, stationaryInterval);
+    }
+    if(lowBattery) {
+        interval *= 2;
+    }
+    return qMin(interval, qMax(m_baseInterval, maxInterval));
+}
+
+void AdaptiveSampler::decide(qint64 time, Mode mode, int interval, int battery, const QString &reason) {
+    Decision decision;
+    decision.time = time;
+    decision.interval = interval;
+    decision.mode = mode;
+    decision.battery = battery;
+    decision.reason = reason;
+    m_decisions.append(decision);
+    if(m_decisions.size() > maxDecisions) {
+        m_decisions.removeFirst();
+    }
+}
+
+bool AdaptiveSampler::update(const TrackPoint &fix) {
+    if(!fix.hasCoordinate() || !fix.hasTime()) {
+        return false;
+    }
+    qreal dt = m_haveLast ? (fix.getTimeMs() - m_last.getTimeMs()) / 1000.0 : 0;
+    if(m_haveLast && dt <= 0) {
+        return false;
+    }
+
+    qreal speed = NAN;
+    qreal heading = NAN;
+    if(m_haveLast) {
+        QGeoCoordinate from(m_last.getLatitude(), m_last.getLongitude());
+        QGeoCoordinate to(fix.getLatitude(), fix.getLongitude());
+        qreal moved = from.distanceTo(to);
+        speed = moved / dt;
+        // Bearing from positions jumps around when barely moving
+        if(moved > 2) {
+            heading = from.azimuthTo(to);
+        }
+    }
+    if(fix.hasGroundSpeed()) {
+        speed = fix.getGroundSpeed();
+    }
+    if(fix.hasDirection() && speed == speed && speed >= stillSpeed) {
+        heading = fix.getDirection();
+    }
+
+    Mode wanted = Base;
+    QString reason;
+    if(speed != speed) {
+        reason = "no history";
+    } else if(speed < stillSpeed) {
+        wanted = Stationary;
+        reason = QString("speed %1 m/s").arg(speed, 0, 'f', 1);
+    } else if(heading == heading && m_lastHeading == m_lastHeading
+              && (headingDifference(heading, m_lastHeading) / dt > turnRate
+                  || headingDifference(heading, m_lastHeading) > turnAngle)) {
+        reason = QString("turning %1 deg in %2 s").arg(headingDifference(heading, m_lastHeading), 0, 'f', 0).arg(dt, 0, 'f', 0);
+    } else if(m_lastSpeed == m_lastSpeed && m_lastSpeed >= stillSpeed
+              && qAbs(speed - m_lastSpeed) > speedChange * m_lastSpeed) {
+        reason = QString("speed change %1 -> %2 m/s").arg(m_lastSpeed, 0, 'f', 1).arg(speed, 0, 'f', 1);
+    } else if(heading == heading && m_lastHeading == m_lastHeading) {
+        wanted = Steady;
+        reason = QString("steady %1 m/s").arg(speed, 0, 'f', 1);
+    } else {
+        reason = "no heading";
+    }
+
+    m_haveLast = true;
+    m_last = fix;
+    m_lastSpeed = speed;
+    m_lastHeading = heading;
+
+    // Faster right away, slower only after a few agreeing fixes
+    Mode mode = m_mode;
+    if(wanted == Base || (wanted == Steady && m_mode == Stationary)) {
+        mode = wanted;
+        m_candidateFixes = 0;
+    } else if(wanted != m_mode) {
+        if(wanted != m_candidate) {
+            m_candidate = wanted;
+            m_candidateFixes = 0;
+        }
+        if(++m_candidateFixes >= confirmFixes) {
+            mode = wanted;
+            m_candidateFixes = 0;
+        }
+    } else {
+        m_candidateFixes = 0;
+    }
+
+    int battery = batteryLevel(fix.getTimeMs());
+    bool low = battery >= 0 && battery < lowBattery;
+    int interval = intervalFor(mode, speed, low);
+    // Small speed wobble in steady mode is not worth a source restart
+    if(mode == m_mode && mode == Steady && qAbs(interval - m_interval) < m_interval / 5) {
+        return false;
+    }
+    if(mode == m_mode && interval == m_interval) {
+        return false;
+    }
+    if(low) {
+        reason += QString(", battery %1%").arg(battery);
+    }
+    m_mode = mode;
+    m_interval = interval;
+    decide(fix.getTimeMs(), mode, interval, battery, reason);
+    return true;
+}
@@ -0,0 +1,93 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADAPTIVESAMPLER_H
+#define ADAPTIVESAMPLER_H
+
+#include <QString>
+#include <QList>
+
+#include "TrackPoint.h"
+
+/*
+ * Picks the GPS update interval from how the track looks.
+ *
+ * The configured interval is the fastest rate and is used in turns and
+ * when speed changes. Riding straight at steady speed stretches it, as
+ * long as fixes stay within maxSpacing metres of each other, and standing
+ * still stretches it further. On low battery every interval is doubled.
+ * Slowing down needs a few agreeing fixes in a row, speeding up happens on
+ * the first fix that asks for it.
+ *
+ * Every change is kept in a short log so the choices can be checked
+ * afterwards.
+ */
+class AdaptiveSampler
+{
+public:
+    enum Mode {
+        Base,           // Turning, changing speed or not enough history
+        Steady,         // Straight at steady speed
+        Stationary,
+        ModeCount
+    };
+
+    struct Decision {
+        qint64 time;    // Fix time in ms
+        int interval;
+        Mode mode;
+        int battery;    // Percent, -1 if unknown
+        QString reason;
+    };
+
+    AdaptiveSampler();
+    void reset();
+    void setBaseInterval(int msecs);
+    int baseInterval() const {return m_baseInterval;}
+    int interval() const {return m_interval;}
+    Mode mode() const {return m_mode;}
+    // Takes the next fix, returns true when interval() changed
+    bool update(const TrackPoint &fix);
+    // Overrides reading the battery level from sysfs, -1 goes back to it
+    void setBatteryLevel(int percent);
+    const QList<Decision> &decisions() const {return m_decisions;}
+    static const char *modeName(Mode mode);
+
+private:
+    int batteryLevel(qint64 time);
+    int intervalFor(Mode mode, qreal speed, bool lowBattery) const;
+    void decide(qint64 time, Mode mode, int interval, int battery, const QString &reason);
+
+    int m_baseInterval;
+    int m_interval;
+    Mode m_mode;
+    Mode m_candidate;           // Slower mode waiting for confirmation
+    int m_candidateFixes;
+    bool m_haveLast;
+    TrackPoint m_last;
+    qreal m_lastHeading;        // Degrees, NaN when unknown
+    qreal m_lastSpeed;
+    int m_batteryOverride;
+    int m_battery;
+    qint64 m_batteryTime;
+    QList<Decision> m_decisions;
+};
+
+#endif // ADAPTIVESAMPLER_H
@@ -0,0 +1,219 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QFile>
+#include <QByteArray>
+#include <QtEndian>
+#include <QDebug>
+#include <string.h>
+#include <unistd.h>
+#include "autosavejournal.h"
+
+static const char journalMagic[8] = {'R', 'E', 'N', 'A', 'J', 'R', 'N', 'L'};
+static const char blockMagic[4] = {'B', 'L', 'K', '1'};
+static const quint32 journalVersion = 1;
+static const int headerSize = 32;
+static const int blockHeaderSize = 16;
+static const int recordHeaderSize = 16;
+
+static quint32 crc32(const uchar *data, qint64 len) {
+    static quint32 table[256];
+    static bool tableReady = false;
+    if(!tableReady) {
+        for(quint32 i=0;i<256;i++) {
+            quint32 c = i;
+            for(int k=0;k<8;k++) {
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+    quint32 crc = 0xffffffff;
+    for(qint64 i=0;i<len;i++) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
+}
+
+static void putDouble(qreal value, uchar *dest) {
+    quint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    qToLittleEndian<quint64>(bits, dest);
+}
+
+static qreal getDouble(const uchar *src) {
+    quint64 bits = qFromLittleEndian<quint64>(src);
+    qreal value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static int recordSize(int fieldCount) {
+    return recordHeaderSize + fieldCount * 8;
+}
+
+static bool validHeader(const uchar *data, qint64 size) {
+    if(size < headerSize || memcmp(data, journalMagic, sizeof(journalMagic)) != 0) {
+        return false;
+    }
+    quint32 version = qFromLittleEndian<quint32>(data + 8);
+    quint32 fieldCount = qFromLittleEndian<quint32>(data + 12);
+    quint32 recSize = qFromLittleEndian<quint32>(data + 16);
+    return version == journalVersion && fieldCount > 0 && fieldCount < 64
+            && recSize == (quint32)recordSize(fieldCount);
+}
+
+AutoSaveJournal::AutoSaveJournal(const QString &filename) :
+    m_filename(filename)
+{
+}
+
+bool AutoSaveJournal::isJournal() const {
+    QFile file(m_filename);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray header = file.read(headerSize);
+    return validHeader((const uchar *)header.constData(), header.size());
+}
+
+bool AutoSaveJournal::append(const TrackPoints &points, int from) {
+    int count = points.size() - from;
+    if(count <= 0) {
+        return true;
+    }
+
+    QFile file(m_filename);
+    if(!file.open(QIODevice::ReadWrite)) {
+        qDebug()<<"Opening autosave journal failed:"<<file.errorString();
+        return false;
+    }
+
+    QByteArray header = file.read(headerSize);
+    if(!validHeader((const uchar *)header.constData(), header.size())) {
+        // Empty file or left from an older version, start over
+        header.fill(0, headerSize);
+        uchar *h = (uchar *)header.data();
+        memcpy(h, journalMagic, sizeof(journalMagic));
+        qToLittleEndian<quint32>(journalVersion, h + 8);
+        qToLittleEndian<quint32>(TrackPoint::FieldCount, h + 12);
+        qToLittleEndian<quint32>(recordSize(TrackPoint::FieldCount), h + 16);
+        if(!file.resize(0) || file.write(header) != headerSize) {
+            qDebug()<<"Writing autosave journal header failed";
+            return false;
+        }
+    }
+    int fieldCount = qFromLittleEndian<quint32>((const uchar *)header.constData() + 12);
+    int size = recordSize(fieldCount);
+
+    QByteArray block(blockHeaderSize + count * size, 0);
+    uchar *b = (uchar *)block.data();
+    uchar *r = b + blockHeaderSize;
+    for(int i=from;i<points.size();i++) {
+        quint16 flags = points.flags(i);
+        qToLittleEndian<qint64>(points.timeMs(i), r);
+        qToLittleEndian<quint16>(flags, r + 8);
+        for(int field=0;field<fieldCount;field++) {
+            qreal value = field < TrackPoint::FieldCount ? points.value(i, field) : NAN;
+            putDouble(value, r + recordHeaderSize + field * 8);
+        }
+        r += size;
+    }
+    memcpy(b, blockMagic, sizeof(blockMagic));
+    qToLittleEndian<quint32>(count, b + 4);
+    qToLittleEndian<quint32>(crc32(b + blockHeaderSize, count * size), b + 8);
+
+    file.seek(file.size());
+    if(file.write(block) != block.size() || !file.flush()) {
+        qDebug()<<"Writing autosave journal failed:"<<file.errorString();
+        return false;
+    }
+    if(::fsync(file.handle()) != 0) {
+        qDebug()<<"Syncing autosave journal failed";
+        return false;
+    }
+    file.close();
+    return true;
+}
+
+bool AutoSaveJournal::load(TrackPoints &points) {
+    QFile file(m_filename);
+    if(!file.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    qint64 fileSize = file.size();
+    if(fileSize < headerSize) {
+        return false;
+    }
+    uchar *data = file.map(0, fileSize);
+    if(!data) {
+        qDebug()<<"Mapping autosave journal failed:"<<file.errorString();
+        return false;
+    }
+    if(!validHeader(data, fileSize)) {
+        file.unmap(data);
+        return false;
+    }
+
+    int fieldCount = qFromLittleEndian<quint32>(data + 12);
+    int size = recordSize(fieldCount);
+    int knownFields = qMin(fieldCount, (int)TrackPoint::FieldCount);
+    quint16 knownFlags = 0;
+    for(int field=0;field<knownFields;field++) {
+        knownFlags |= TrackPoint::fieldFlag(field);
+    }
+    knownFlags |= TrackPoint::HasTime;
+
+    qint64 pos = headerSize;
+    while(pos + blockHeaderSize <= fileSize) {
+        const uchar *b = data + pos;
+        quint32 count = qFromLittleEndian<quint32>(b + 4);
+        if(memcmp(b, blockMagic, sizeof(blockMagic)) != 0 || count == 0
+                || (qint64)count * size > fileSize - pos - blockHeaderSize
+                || qFromLittleEndian<quint32>(b + 8) != crc32(b + blockHeaderSize, (qint64)count * size)) {
+            break;
+        }
+        const uchar *r = b + blockHeaderSize;
+        for(quint32 i=0;i<count;i++) {
+            TrackPoint point;
+            quint16 flags = qFromLittleEndian<quint16>(r + 8) & knownFlags;
+            if(flags & TrackPoint::HasTime) {
+                point.setTimeMs(qFromLittleEndian<qint64>(r));
+            }
+            for(int field=0;field<knownFields;field++) {
+                if(flags & TrackPoint::fieldFlag(field)) {
+                    point.setValue(field, getDouble(r + recordHeaderSize + field * 8));
+                }
+            }
+            points.merge(point, true);
+            r += size;
+        }
+        pos += blockHeaderSize + (qint64)count * size;
+    }
+    file.unmap(data);
+
+    if(pos != fileSize) {
+        qDebug()<<"Autosave journal has a torn block at"<<pos<<"truncating"<<fileSize-pos<<"bytes";
+        file.resize(pos);
+    }
+    file.close();
+    return true;
+}
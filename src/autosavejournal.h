@@ -0,0 +1,57 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AUTOSAVEJOURNAL_H
+#define AUTOSAVEJOURNAL_H
+
+#include <QString>
+
+#include "TrackPoints.h"
+
+/*
+ * Binary autosave journal.
+ *
+ * File layout (little endian):
+ *   header: "RENAJRNL", version, field count, record size, reserved
+ *   blocks: "BLK1", record count, CRC-32 of the records, reserved,
+ *           followed by fixed size records
+ *   record: time (ms, int64), flags (uint16), padding, field count doubles
+ *
+ * Every autosave appends one block with the points changed since the
+ * previous one and fsyncs it. A point can appear in several blocks, later
+ * records of the same second win on load. A torn or corrupted block ends
+ * the journal and is truncated away on load.
+ */
+class AutoSaveJournal
+{
+public:
+    explicit AutoSaveJournal(const QString &filename);
+
+    // Appends points [from, points.size()) as one block
+    bool append(const TrackPoints &points, int from);
+    // Returns false if the file is missing or not a journal
+    bool load(TrackPoints &points);
+    bool isJournal() const;
+
+private:
+    QString m_filename;
+};
+
+#endif // AUTOSAVEJOURNAL_H
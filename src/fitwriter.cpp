@@ -0,0 +1,316 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtEndian>
+#include <qmath.h>
+#include "fitwriter.h"
+
+struct FitField {
+    uchar number;
+    uchar size;
+    uchar baseType;
+};
+
+// Base types
+static const uchar fitEnum = 0x00;
+static const uchar fitUint8 = 0x02;
+static const uchar fitUint16 = 0x84;
+static const uchar fitSint32 = 0x85;
+static const uchar fitUint32 = 0x86;
+static const uchar fitUint32z = 0x8c;
+
+// Global message numbers
+static const quint16 fileIdMessage = 0;
+static const quint16 recordMessage = 20;
+static const quint16 lapMessage = 19;
+static const quint16 sessionMessage = 18;
+static const quint16 activityMessage = 34;
+
+enum LocalMessage {
+    FileIdLocal,
+    RecordLocal,
+    LapLocal,
+    SessionLocal,
+    ActivityLocal
+};
+
+static const FitField fileIdFields[] = {
+    {0, 1, fitEnum},        // type
+    {1, 2, fitUint16},      // manufacturer
+    {2, 2, fitUint16},      // product
+    {3, 4, fitUint32z},     // serial_number
+    {4, 4, fitUint32}       // time_created
+};
+static const FitField recordFields[] = {
+    {253, 4, fitUint32},    // timestamp
+    {0, 4, fitSint32},      // position_lat, semicircles
+    {1, 4, fitSint32},      // position_long
+    {2, 2, fitUint16},      // altitude, 5 * (m + 500)
+    {5, 4, fitUint32},      // distance, cm
+    {6, 2, fitUint16},      // speed, mm/s
+    {4, 1, fitUint8}        // cadence, rpm
+};
+static const FitField lapFields[] = {
+    {253, 4, fitUint32},    // timestamp
+    {2, 4, fitUint32},      // start_time
+    {7, 4, fitUint32},      // total_elapsed_time, ms
+    {8, 4, fitUint32},      // total_timer_time, ms
+    {9, 4, fitUint32},      // total_distance, cm
+    {0, 1, fitEnum},        // event
+    {1, 1, fitEnum}         // event_type
+};
+static const FitField sessionFields[] = {
+    {253, 4, fitUint32},    // timestamp
+    {2, 4, fitUint32},      // start_time
+    {7, 4, fitUint32},      // total_elapsed_time, ms
+    {8, 4, fitUint32},      // total_timer_time, ms
+    {9, 4, fitUint32},      // total_distance, cm
+    {5, 1, fitEnum},        // sport
+    {6, 1, fitEnum},        // sub_sport
+    {0, 1, fitEnum},        // event
+    {1, 1, fitEnum},        // event_type
+    {25, 2, fitUint16},     // first_lap_index
+    {26, 2, fitUint16}      // num_laps
+};
+static const FitField activityFields[] = {
+    {253, 4, fitUint32},    // timestamp
+    {0, 4, fitUint32},      // total_timer_time, ms
+    {1, 2, fitUint16},      // num_sessions
+    {2, 1, fitEnum},        // type
+    {3, 1, fitEnum},        // event
+    {4, 1, fitEnum}         // event_type
+};
+
+static const int headerSize = 14;
+static const quint16 profileVersion = 2100;
+static const quint16 developmentManufacturer = 255;
+static const quint8 activityFile = 4;
+static const quint8 lapEvent = 9;
+static const quint8 sessionEvent = 8;
+static const quint8 activityEvent = 26;
+static const quint8 stopEvent = 1;
+// FIT times count from 1989-12-31T00:00:00Z
+static const qint64 fitEpochSecs = Q_INT64_C(631065600);
+
+template<int N> static int definitionSize(const FitField (&)[N]) {
+    return 6 + 3 * N;
+}
+
+template<int N> static int messageSize(const FitField (&fields)[N]) {
+    int size = 1;
+    for(int i=0;i<N;i++) {
+        size += fields[i].size;
+    }
+    return size;
+}
+
+#define FIELDS(fields) fields, int(sizeof(fields) / sizeof(fields[0]))
+
+static quint32 fitTime(qint64 msecs) {
+    return (quint32)qMax(msecs / 1000 - fitEpochSecs, Q_INT64_C(0));
+}
+
+// Rounds and clamps, values out of range become the invalid marker
+static quint32 scaled(qreal value, qreal scale, qreal offset, quint32 max, quint32 invalid) {
+    if(value != value) {
+        return invalid;
+    }
+    qreal result = qRound64((value + offset) * scale);
+    return result < 0 || result > max ? invalid : (quint32)result;
+}
+
+static qint32 semicircles(qreal degrees) {
+    return (qint32)qBound(Q_INT64_C(-2147483647), qRound64(degrees * (2147483648.0 / 180.0)),
+                          Q_INT64_C(2147483647));
+}
+
+FitWriter::FitWriter(QIODevice *device) :
+    TrackWriter(device),
+    m_crc(0)
+{
+}
+
+quint16 FitWriter::crc(quint16 crc, const uchar *data, int len) {
+    static const quint16 table[16] = {
+        0x0000, 0xcc01, 0xd801, 0x1400, 0xf001, 0x3c00, 0x2800, 0xe401,
+        0xa001, 0x6c00, 0x7800, 0xb401, 0x5000, 0x9c01, 0x8801, 0x4400
+    };
+    for(int i=0;i<len;i++) {
+        quint16 tmp = table[crc & 0xf];
+        crc = (crc >> 4) & 0x0fff;
+        crc = crc ^ tmp ^ table[data[i] & 0xf];
+        tmp = table[crc & 0xf];
+        crc = (crc >> 4) & 0x0fff;
+        crc = crc ^ tmp ^ table[(data[i] >> 4) & 0xf];
+    }
+    return crc;
+}
+
+void FitWriter::put(const void *data, int len) {
+    m_crc = crc(m_crc, (const uchar *)data, len);
+    append((const char *)data, len);
+}
+
+void FitWriter::put8(quint8 value) {
+    put(&value, 1);
+}
+
+void FitWriter::put16(quint16 value) {
+    uchar bytes[2];
+    qToLittleEndian<quint16>(value, bytes);
+    put(bytes, 2);
+}
+
+void FitWriter::put32(quint32 value) {
+    uchar bytes[4];
+    qToLittleEndian<quint32>(value, bytes);
+    put(bytes, 4);
+}
+
+void FitWriter::define(uchar local, quint16 global, const FitField *fields, int count) {
+    put8(0x40 | local);
+    put8(0);                // Reserved
+    put8(0);                // Little endian
+    put16(global);
+    put8(count);
+    for(int i=0;i<count;i++) {
+        put8(fields[i].number);
+        put8(fields[i].size);
+        put8(fields[i].baseType);
+    }
+}
+
+bool FitWriter::write(TrackPointIterator &points, const QString &name, const QString &description) {
+    Q_UNUSED(name);
+    Q_UNUSED(description);
+    int count = points.remaining();
+    quint32 dataSize = definitionSize(fileIdFields) + messageSize(fileIdFields)
+            + definitionSize(recordFields) + count * messageSize(recordFields)
+            + definitionSize(lapFields) + messageSize(lapFields)
+            + definitionSize(sessionFields) + messageSize(sessionFields)
+            + definitionSize(activityFields) + messageSize(activityFields);
+
+    begin();
+    uchar header[headerSize];
+    header[0] = headerSize;
+    header[1] = 0x10;       // Protocol 1.0
+    qToLittleEndian<quint16>(profileVersion, header + 2);
+    qToLittleEndian<quint32>(dataSize, header + 4);
+    header[8] = '.';
+    header[9] = 'F';
+    header[10] = 'I';
+    header[11] = 'T';
+    qToLittleEndian<quint16>(crc(0, header, 12), header + 12);
+    m_crc = 0;
+    put(header, headerSize);
+
+    // The start time is only known once the first point has been seen, the
+    // file_id goes out with it
+    TrackStatistics statistics;
+    qint64 startMs = -1;
+    qint64 lastMs = 0;
+    define(RecordLocal, recordMessage, FIELDS(recordFields));
+    bool first = true;
+    while(points.next()) {
+        quint16 flags = points.flags();
+        if(flags & TrackPoint::HasTime) {
+            lastMs = points.timeMs();
+            if(startMs < 0) {
+                startMs = lastMs;
+            }
+        }
+        if(first) {
+            define(FileIdLocal, fileIdMessage, FIELDS(fileIdFields));
+            put8(FileIdLocal);
+            put8(activityFile);
+            put16(developmentManufacturer);
+            put16(0);
+            put32(0);
+            put32(fitTime(lastMs));
+            first = false;
+        }
+        statistics.add(points.point());
+        bool coordinate = flags & TrackPoint::HasCoordinate;
+        put8(RecordLocal);
+        put32(fitTime(lastMs));
+        put32(coordinate ? semicircles(points.latitude()) : 0x7fffffff);
+        put32(coordinate ? semicircles(points.longitude()) : 0x7fffffff);
+        put16(scaled(flags & TrackPoint::HasElevation ? points.elevation() : NAN, 5, 500, 0xfffe, 0xffff));
+        put32(scaled(statistics.distance(), 100, 0, 0xfffffffe, 0xffffffff));
+        put16(scaled(flags & TrackPoint::HasGroundSpeed ? points.value(TrackPoint::GroundSpeed) : NAN,
+                     1000, 0, 0xfffe, 0xffff));
+        put8(scaled(flags & TrackPoint::HasCadence ? points.cadence() : NAN, 1, 0, 0xfe, 0xff));
+    }
+    if(first) {
+        // No points, the file_id still has to be there
+        define(FileIdLocal, fileIdMessage, FIELDS(fileIdFields));
+        put8(FileIdLocal);
+        put8(activityFile);
+        put16(developmentManufacturer);
+        put16(0);
+        put32(0);
+        put32(0);
+    }
+    if(startMs < 0) {
+        startMs = 0;
+    }
+
+    quint32 endTime = fitTime(lastMs);
+    quint32 elapsed = (quint32)qMax(lastMs - startMs, Q_INT64_C(0));
+    quint32 distance = scaled(statistics.distance(), 100, 0, 0xfffffffe, 0xffffffff);
+
+    define(LapLocal, lapMessage, FIELDS(lapFields));
+    put8(LapLocal);
+    put32(endTime);
+    put32(fitTime(startMs));
+    put32(elapsed);
+    put32(elapsed);
+    put32(distance);
+    put8(lapEvent);
+    put8(stopEvent);
+
+    define(SessionLocal, sessionMessage, FIELDS(sessionFields));
+    put8(SessionLocal);
+    put32(endTime);
+    put32(fitTime(startMs));
+    put32(elapsed);
+    put32(elapsed);
+    put32(distance);
+    put8(0);                // Generic sport
+    put8(0);
+    put8(sessionEvent);
+    put8(stopEvent);
+    put16(0);
+    put16(1);
+
+    define(ActivityLocal, activityMessage, FIELDS(activityFields));
+    put8(ActivityLocal);
+    put32(endTime);
+    put32(elapsed);
+    put16(1);
+    put8(0);                // Manual
+    put8(activityEvent);
+    put8(stopEvent);
+
+    uchar trailer[2];
+    qToLittleEndian<quint16>(m_crc, trailer);
+    append((const char *)trailer, 2);
+    return end();
+}
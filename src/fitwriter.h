@@ -0,0 +1,56 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FITWRITER_H
+#define FITWRITER_H
+
+#include "trackwriter.h"
+#include "trackstatistics.h"
+
+struct FitField;
+
+/*
+ * Writes a track as a binary FIT activity file: file_id, one record
+ * message per point, then lap, session and activity summaries. Every
+ * message has a fixed layout with unknown values marked invalid, so the
+ * data size in the file header is known from the point count before
+ * anything is written and the output never needs seeking.
+ */
+class FitWriter : public TrackWriter
+{
+public:
+    explicit FitWriter(QIODevice *device);
+    using TrackWriter::write;
+    bool write(TrackPointIterator &points, const QString &name, const QString &description);
+
+    // FIT CRC-16 of data continuing from crc
+    static quint16 crc(quint16 crc, const uchar *data, int len);
+
+private:
+    void define(uchar local, quint16 global, const FitField *fields, int count);
+    void put(const void *data, int len);
+    void put8(quint8 value);
+    void put16(quint16 value);
+    void put32(quint32 value);
+
+    quint16 m_crc;
+};
+
+#endif // FITWRITER_H
@@ -0,0 +1,87 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "geojsonwriter.h"
+
+GeoJsonWriter::GeoJsonWriter(QIODevice *device) :
+    TrackWriter(device)
+{
+}
+
+bool GeoJsonWriter::write(TrackPointIterator &points, const QString &name, const QString &description) {
+    // Coordinates and their times are separate arrays, one pass each
+    TrackPointIterator times(points);
+
+    begin();
+    append("{\"type\":\"Feature\",\"properties\":{");
+    if(!name.isEmpty()) {
+        append("\"name\":");
+        writeJsonString(name);
+        append(",");
+    }
+    if(!description.isEmpty()) {
+        append("\"desc\":");
+        writeJsonString(description);
+        append(",");
+    }
+    append("\"creator\":\"Rena for Sailfish\",\"coordTimes\":[");
+    bool first = true;
+    while(!m_error && times.next()) {
+        if(!times.has(TrackPoint::HasCoordinate)) {
+            continue;
+        }
+        if(!first) {
+            append(",");
+        }
+        first = false;
+        if(times.has(TrackPoint::HasTime)) {
+            append("\"");
+            writeTime(times.timeMs());
+            append("\"");
+        } else {
+            append("null");
+        }
+    }
+
+    append("]},\n\"geometry\":{\"type\":\"LineString\",\"coordinates\":[\n");
+    first = true;
+    while(!m_error && points.next()) {
+        quint16 flags = points.flags();
+        if(!(flags & TrackPoint::HasCoordinate)) {
+            continue;
+        }
+        if(first) {
+            append("[");
+        } else {
+            append(",\n[");
+        }
+        first = false;
+        writeNumber(points.longitude());
+        append(",");
+        writeNumber(points.latitude());
+        if(flags & TrackPoint::HasElevation) {
+            append(",");
+            writeNumber(points.elevation());
+        }
+        append("]");
+    }
+    append("\n]}}\n");
+    return end();
+}
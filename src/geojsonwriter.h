@@ -0,0 +1,40 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GEOJSONWRITER_H
+#define GEOJSONWRITER_H
+
+#include "trackwriter.h"
+
+/*
+ * Writes a track as one GeoJSON (RFC 7946) Feature with a LineString of
+ * the points that have a coordinate, elevation as the optional third
+ * value. Times go to a coordTimes property matching the coordinates one
+ * to one, like most GPX to GeoJSON converters do.
+ */
+class GeoJsonWriter : public TrackWriter
+{
+public:
+    explicit GeoJsonWriter(QIODevice *device);
+    using TrackWriter::write;
+    bool write(TrackPointIterator &points, const QString &name, const QString &description);
+};
+
+#endif // GEOJSONWRITER_H
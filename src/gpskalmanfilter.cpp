@@ -0,0 +1,135 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <qmath.h>
+#include "gpskalmanfilter.h"
+
+static const qreal metresPerLatitude = 111319.49;   // WGS84 equator, 2 * pi * 6378137 / 360
+// Spectral density of the white acceleration noise, m^2/s^3. Covers a
+// cyclist or runner changing pace, not a car.
+static const qreal accelerationNoise = 0.3;
+static const qreal defaultAccuracy = 10;
+static const qreal initialVelocityVariance = 25;    // (5 m/s)^2
+// Longer gaps restart the filter at the next fix
+static const qint64 maxGap = 30000;
+// Stationary clamp
+static const qreal stillSpeed = 0.8;
+static const qreal moveSpeed = 1.0;
+static const int stillFixesNeeded = 3;
+static const qreal minLeaveDistance = 10;
+
+GpsKalmanFilter::GpsKalmanFilter() {
+    reset();
+}
+
+void GpsKalmanFilter::reset() {
+    m_started = false;
+    m_time = 0;
+    m_stationary = false;
+    m_stillFixes = 0;
+}
+
+void GpsKalmanFilter::start(const TrackPoint &fix, qreal variance) {
+    m_started = true;
+    m_time = fix.getTimeMs();
+    m_originLatitude = fix.getLatitude();
+    m_originLongitude = fix.getLongitude();
+    m_metresPerLongitude = metresPerLatitude * qCos(m_originLatitude * M_PI / 180);
+    m_position[0] = m_position[1] = 0;
+    m_velocity[0] = m_velocity[1] = 0;
+    m_p00 = variance;
+    m_p01 = 0;
+    m_p11 = initialVelocityVariance;
+    m_stationary = false;
+    m_stillFixes = 0;
+}
+
+void GpsKalmanFilter::filter(TrackPoint &fix) {
+    if(!fix.hasCoordinate() || !fix.hasTime()) {
+        return;
+    }
+    // Also for fixes that start a run or are passed on unfiltered
+    fix.setRawLatitude(fix.getLatitude());
+    fix.setRawLongitude(fix.getLongitude());
+    qreal accuracy = fix.hasHorizontalAccuracy() && fix.getHorizontalAccuracy() > 0
+            ? fix.getHorizontalAccuracy() : defaultAccuracy;
+    qreal variance = accuracy * accuracy;
+    qreal dt = (fix.getTimeMs() - m_time) / 1000.0;
+    if(!m_started || dt <= 0 || dt * 1000 > maxGap) {
+        if(m_started && dt <= 0) {
+            return;     // Repeated or out of order fix, keep it as is
+        }
+        start(fix, variance);
+        return;
+    }
+    m_time = fix.getTimeMs();
+
+    // Predict
+    m_position[0] += m_velocity[0] * dt;
+    m_position[1] += m_velocity[1] * dt;
+    qreal q = accelerationNoise;
+    m_p00 += dt * (2 * m_p01 + dt * m_p11) + q * dt * dt * dt / 3;
+    m_p01 += dt * m_p11 + q * dt * dt / 2;
+    m_p11 += q * dt;
+
+    // Update
+    qreal measured[2];
+    measured[0] = (fix.getLongitude() - m_originLongitude) * m_metresPerLongitude;
+    measured[1] = (fix.getLatitude() - m_originLatitude) * metresPerLatitude;
+    qreal s = m_p00 + variance;
+    qreal k0 = m_p00 / s;
+    qreal k1 = m_p01 / s;
+    for(int axis=0;axis<2;axis++) {
+        qreal innovation = measured[axis] - m_position[axis];
+        m_position[axis] += k0 * innovation;
+        m_velocity[axis] += k1 * innovation;
+    }
+    m_p11 -= k1 * m_p01;
+    m_p01 *= 1 - k0;
+    m_p00 *= 1 - k0;
+
+    // Stationary clamp
+    qreal speed = fix.hasGroundSpeed() ? fix.getGroundSpeed()
+            : qSqrt(m_velocity[0] * m_velocity[0] + m_velocity[1] * m_velocity[1]);
+    if(m_stationary) {
+        qreal dx = measured[0] - m_held[0];
+        qreal dy = measured[1] - m_held[1];
+        if(speed > moveSpeed || qSqrt(dx * dx + dy * dy) > qMax(2 * accuracy, minLeaveDistance)) {
+            m_stationary = false;
+            m_stillFixes = 0;
+        } else {
+            m_position[0] = m_held[0];
+            m_position[1] = m_held[1];
+            m_velocity[0] = m_velocity[1] = 0;
+        }
+    } else if(speed < stillSpeed) {
+        if(++m_stillFixes >= stillFixesNeeded) {
+            m_stationary = true;
+            m_held[0] = m_position[0];
+            m_held[1] = m_position[1];
+            m_velocity[0] = m_velocity[1] = 0;
+        }
+    } else {
+        m_stillFixes = 0;
+    }
+
+    fix.setLatitude(m_originLatitude + m_position[1] / metresPerLatitude);
+    fix.setLongitude(m_originLongitude + m_position[0] / m_metresPerLongitude);
+}
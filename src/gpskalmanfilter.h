@@ -0,0 +1,67 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GPSKALMANFILTER_H
+#define GPSKALMANFILTER_H
+
+#include "TrackPoint.h"
+
+/*
+ * Constant velocity Kalman filter for GPS fixes.
+ *
+ * Fixes are projected to metres around the first fix of a run. East and
+ * north are filtered independently with the same 2x2 covariance, which is
+ * exact as long as the measurement noise is round, so one update is a
+ * handful of multiplications. The reported horizontal accuracy is used as
+ * measurement noise.
+ *
+ * On top of the filter there is a stationary clamp: after a few fixes with
+ * no speed the position is held until a fix lands clearly outside the
+ * noise or reports movement. That keeps jitter from adding distance while
+ * standing at traffic lights.
+ */
+class GpsKalmanFilter
+{
+public:
+    GpsKalmanFilter();
+    void reset();
+    // Replaces the coordinate of fix with the filtered one and keeps the
+    // measured one in RawLatitude/RawLongitude. Fixes without a coordinate
+    // or time are left alone.
+    void filter(TrackPoint &fix);
+    bool isStationary() const {return m_stationary;}
+
+private:
+    void start(const TrackPoint &fix, qreal variance);
+
+    bool m_started;
+    qint64 m_time;
+    qreal m_originLatitude;
+    qreal m_originLongitude;
+    qreal m_metresPerLongitude;
+    qreal m_position[2];        // East, north in metres from origin
+    qreal m_velocity[2];        // m/s
+    qreal m_p00, m_p01, m_p11;  // Covariance shared by both axes
+    bool m_stationary;
+    int m_stillFixes;
+    qreal m_held[2];
+};
+
+#endif // GPSKALMANFILTER_H
@@ -0,0 +1,525 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QFile>
+#include <QByteArray>
+#include <QDateTime>
+#include <QXmlStreamReader>
+#include <QDebug>
+#include <string.h>
+#include "gpxparser.h"
+#include "isotime.h"
+
+namespace {
+
+// Cursor over the mapped file used by the fast path
+class Scanner {
+public:
+    Scanner(const char *data, qint64 size) : p(data), end(data + size) {}
+
+    void skipSpace() {
+        while(p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+            p++;
+        }
+    }
+
+    template<int N> bool accept(const char (&literal)[N]) {
+        if(end - p >= N - 1 && memcmp(p, literal, N - 1) == 0) {
+            p += N - 1;
+            return true;
+        }
+        return false;
+    }
+
+    // Moves just past the next occurrence of c
+    bool skipPast(char c) {
+        const char *found = (const char *)memchr(p, c, end - p);
+        if(!found) {
+            return false;
+        }
+        p = found + 1;
+        return true;
+    }
+
+    // Text up to the next tag, p is left at '<'
+    bool text(const char *&begin, const char *&textEnd) {
+        begin = p;
+        const char *found = (const char *)memchr(p, '<', end - p);
+        if(!found) {
+            return false;
+        }
+        textEnd = p = found;
+        return true;
+    }
+
+    const char *p;
+    const char *end;
+    IsoTime times;      // Date cache for <time>
+};
+
+bool contains(const char *begin, const char *end, const char *literal) {
+    int len = strlen(literal);
+    for(const char *p = begin; end - p >= len; p++) {
+        if(*p == *literal && memcmp(p, literal, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Undoes the escaping QXmlStreamWriter does for text content
+bool decodeText(const char *begin, const char *end, QString &result) {
+    if(!memchr(begin, '&', end - begin)) {
+        result = QString::fromUtf8(begin, end - begin);
+        return true;
+    }
+    QByteArray decoded;
+    decoded.reserve(end - begin);
+    for(const char *p = begin; p < end; p++) {
+        if(*p != '&') {
+            decoded.append(*p);
+            continue;
+        }
+        const char *semicolon = (const char *)memchr(p, ';', end - p);
+        if(!semicolon) {
+            return false;
+        }
+        QByteArray entity(p + 1, semicolon - p - 1);
+        if(entity == "amp") {
+            decoded.append('&');
+        } else if(entity == "lt") {
+            decoded.append('<');
+        } else if(entity == "gt") {
+            decoded.append('>');
+        } else if(entity == "quot") {
+            decoded.append('"');
+        } else if(entity == "apos") {
+            decoded.append('\'');
+        } else if(entity.startsWith('#')) {
+            bool ok;
+            uint code = entity.startsWith("#x") ? entity.mid(2).toUInt(&ok, 16) : entity.mid(1).toUInt(&ok, 10);
+            if(!ok) {
+                return false;
+            }
+            decoded.append(QString::fromUcs4(&code, 1).toUtf8());
+        } else {
+            return false;
+        }
+        p = semicolon;
+    }
+    result = QString::fromUtf8(decoded);
+    return true;
+}
+
+int fieldForElement(const char *name, int len) {
+    switch(len) {
+    case 3:
+        if(memcmp(name, "ele", 3) == 0) return TrackPoint::Elevation;
+        if(memcmp(name, "dir", 3) == 0) return TrackPoint::Direction;
+        break;
+    case 5:
+        if(memcmp(name, "g_spd", 5) == 0) return TrackPoint::GroundSpeed;
+        if(memcmp(name, "v_spd", 5) == 0) return TrackPoint::VerticalSpeed;
+        if(memcmp(name, "m_var", 5) == 0) return TrackPoint::MagneticVariation;
+        if(memcmp(name, "h_acc", 5) == 0) return TrackPoint::HorizontalAccuracy;
+        if(memcmp(name, "v_acc", 5) == 0) return TrackPoint::VerticalAccuracy;
+        break;
+    case 7:
+        if(memcmp(name, "cadence", 7) == 0) return TrackPoint::Cadence;
+        if(memcmp(name, "raw_lat", 7) == 0) return TrackPoint::RawLatitude;
+        if(memcmp(name, "raw_lon", 7) == 0) return TrackPoint::RawLongitude;
+        break;
+    case 8:
+        if(memcmp(name, "distance", 8) == 0) return TrackPoint::Distance;
+        break;
+    }
+    return -1;
+}
+
+// Reads <name>value</name> into point, unknown elements are skipped
+bool parseValueElement(Scanner &s, TrackPoint &point) {
+    if(!s.accept("<")) {
+        return false;
+    }
+    const char *name = s.p;
+    if(!s.skipPast('>')) {
+        return false;
+    }
+    int nameLen = s.p - name - 1;
+    if(nameLen <= 0 || name[nameLen - 1] == '/') {
+        return nameLen > 0;  // Empty element, nothing to read
+    }
+    const char *value, *valueEnd;
+    if(!s.text(value, valueEnd)) {
+        return false;
+    }
+    if(s.end - s.p < nameLen + 3 || s.p[1] != '/' || memcmp(s.p + 2, name, nameLen) != 0
+            || s.p[nameLen + 2] != '>') {
+        return false;   // Nested elements, leave those to QXmlStreamReader
+    }
+    s.p += nameLen + 3;
+
+    if(nameLen == 4 && memcmp(name, "time", 4) == 0) {
+        qint64 msecs;
+        if(s.times.parse(value, valueEnd, msecs)) {
+            point.setTimeMs(msecs);
+        } else {
+            point.setTime(QDateTime::fromString(QString::fromLatin1(value, valueEnd - value), Qt::ISODate));
+        }
+        return true;
+    }
+    int field = fieldForElement(name, nameLen);
+    if(field < 0) {
+        return true;
+    }
+    qreal number;
+    if(!GpxParser::parseDouble(value, valueEnd, number)) {
+        return false;
+    }
+    point.setValue(field, number);
+    return true;
+}
+
+bool parseTrackPoint(Scanner &s, TrackPoint &point) {
+    const char *value;
+    qreal number;
+    if(!s.accept("<trkpt lat=\"")) {
+        return false;
+    }
+    value = s.p;
+    if(!s.skipPast('"') || !GpxParser::parseDouble(value, s.p - 1, number)) {
+        return false;
+    }
+    point.setLatitude(number);
+    if(!s.accept(" lon=\"")) {
+        return false;
+    }
+    value = s.p;
+    if(!s.skipPast('"') || !GpxParser::parseDouble(value, s.p - 1, number) || !s.accept(">")) {
+        return false;
+    }
+    point.setLongitude(number);
+
+    for(;;) {
+        s.skipSpace();
+        if(s.accept("</trkpt>")) {
+            return true;
+        } else if(s.accept("<extensions/>")) {
+            continue;
+        } else if(s.accept("<extensions>")) {
+            for(;;) {
+                s.skipSpace();
+                if(s.accept("</extensions>")) {
+                    break;
+                }
+                if(!parseValueElement(s, point)) {
+                    return false;
+                }
+            }
+        } else if(!parseValueElement(s, point)) {
+            return false;
+        }
+    }
+}
+
+const double powersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+} // namespace
+
+bool GpxParser::parseDouble(const char *begin, const char *end, qreal &value) {
+    const char *p = begin;
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    quint64 mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    bool anyDigits = false;
+    while(p < end && *p >= '0' && *p <= '9') {
+        if(significant < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if(mantissa) {
+                significant++;
+            }
+        } else {
+            exponent++;
+        }
+        anyDigits = true;
+        p++;
+    }
+    if(p < end && *p == '.') {
+        p++;
+        while(p < end && *p >= '0' && *p <= '9') {
+            if(significant < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if(mantissa) {
+                    significant++;
+                }
+                exponent--;
+            }
+            anyDigits = true;
+            p++;
+        }
+    }
+    if(!anyDigits) {
+        // nan, inf or garbage
+        bool ok;
+        value = QByteArray::fromRawData(begin, end - begin).toDouble(&ok);
+        return ok;
+    }
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = false;
+        if(p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            p++;
+        }
+        int e = 0;
+        const char *expDigits = p;
+        while(p < end && *p >= '0' && *p <= '9' && e < 10000) {
+            e = e * 10 + (*p - '0');
+            p++;
+        }
+        if(p == expDigits) {
+            return false;
+        }
+        exponent += negativeExponent ? -e : e;
+    }
+    if(p != end) {
+        return false;
+    }
+
+    if(mantissa > (Q_UINT64_C(1) << 53) || exponent < -22 || exponent > 22) {
+        // Outside of the exact fast path, let Qt do correct rounding
+        bool ok;
+        value = QByteArray::fromRawData(begin, end - begin).toDouble(&ok);
+        return ok;
+    }
+    double result = (double)mantissa;
+    result = exponent < 0 ? result / powersOf10[-exponent] : result * powersOf10[exponent];
+    value = negative ? -result : result;
+    return true;
+}
+
+GpxParser::Result GpxParser::parseFast(const char *data, qint64 size, GpxTrack &track,
+                                       GpxProgress *progress) {
+    Scanner s(data, size);
+
+    s.skipSpace();
+    if(s.accept("<?xml")) {
+        if(!s.skipPast('>')) {
+            return Unsupported;
+        }
+        s.skipSpace();
+    }
+    if(!s.accept("<gpx ")) {
+        return Unsupported;
+    }
+    const char *attributes = s.p;
+    if(!s.skipPast('>') || s.p[-2] == '/'
+            || !contains(attributes, s.p, "version=\"1.1\"")
+            || !contains(attributes, s.p, "Creator=\"Rena for Sailfish\"")) {
+        return Unsupported;
+    }
+
+    s.skipSpace();
+    if(s.accept("<metadata>")) {
+        for(;;) {
+            const char *text, *textEnd;
+            s.skipSpace();
+            if(s.accept("</metadata>")) {
+                break;
+            } else if(s.accept("<name>")) {
+                if(!s.text(text, textEnd) || !s.accept("</name>") || !decodeText(text, textEnd, track.name)) {
+                    return Unsupported;
+                }
+            } else if(s.accept("<desc>")) {
+                if(!s.text(text, textEnd) || !s.accept("</desc>") || !decodeText(text, textEnd, track.description)) {
+                    return Unsupported;
+                }
+            } else {
+                return Unsupported;
+            }
+        }
+        s.skipSpace();
+    }
+
+    if(!s.accept("<trk>")) {
+        return Unsupported;
+    }
+    // Rena writes roughly 250 bytes per point
+    track.points.reserve(size / 250);
+    for(;;) {
+        s.skipSpace();
+        if(s.accept("</trk>")) {
+            break;
+        }
+        if(!s.accept("<trkseg>")) {
+            return Unsupported;
+        }
+        for(;;) {
+            s.skipSpace();
+            if(s.accept("</trkseg>")) {
+                break;
+            }
+            TrackPoint point;
+            if(!parseTrackPoint(s, point)) {
+                return Unsupported;
+            }
+            track.points.append(point);
+            if(progress && track.points.size() % chunkSize == 0
+                    && !progress->update(track, (qreal)(s.p - data) / size)) {
+                return Cancelled;
+            }
+        }
+    }
+    s.skipSpace();
+    if(!s.accept("</gpx>")) {
+        return Unsupported;
+    }
+    return Ok;
+}
+
+GpxParser::Result GpxParser::parseXml(QIODevice *device, GpxTrack &track, GpxProgress *progress) {
+    QXmlStreamReader xml(device);
+    IsoTime times;
+    if(!xml.readNextStartElement()) {
+        return NotGpx;
+    }
+    if( !(xml.name() == "gpx" && xml.attributes().value("version") == "1.1") ) {
+        return NotGpx;
+    }
+
+    while(xml.readNextStartElement()) {
+        if(xml.name() == "metadata") {
+            while(xml.readNextStartElement()) {
+                if(xml.name() == "name") {
+                    track.name = xml.readElementText();
+                } else if(xml.name() == "desc") {
+                    track.description = xml.readElementText();
+                } else {
+                    xml.skipCurrentElement();
+                }
+            }
+        } else if(xml.name() == "trk") {
+            while(xml.readNextStartElement()) {
+                if(xml.name() == "trkseg") {
+                    while(xml.readNextStartElement()) {
+                        if(xml.name() == "trkpt") {
+                            TrackPoint point;
+                            point.setLatitude(xml.attributes().value("lat").toDouble());
+                            point.setLongitude(xml.attributes().value("lon").toDouble());
+                            while(xml.readNextStartElement()) {
+                                if(xml.name() == "time") {
+                                    QString text = xml.readElementText();
+                                    qint64 msecs;
+                                    if(times.parse(text, msecs)) {
+                                        point.setTimeMs(msecs);
+                                    } else {
+                                        point.setTime(QDateTime::fromString(text, Qt::ISODate));
+                                    }
+                                } else if(xml.name() == "ele") {
+                                    point.setElevation(xml.readElementText().toDouble());
+                                } else if(xml.name() == "extensions") {
+                                    while(xml.readNextStartElement()) {
+                                        if(xml.name() == "dir") {
+                                            point.setDirection(xml.readElementText().toDouble());
+                                        } else if(xml.name() == "g_spd") {
+                                            point.setGroundSpeed(xml.readElementText().toDouble());
+                                        } else if(xml.name() == "v_spd") {
+                                            point.setVerticalSpeed(xml.readElementText().toDouble());
+                                        } else if(xml.name() == "m_var") {
+                                            point.setMagneticVariation(xml.readElementText().toDouble());
+                                        } else if(xml.name() == "h_acc") {
+                                            point.setHorizontalAccuracy(xml.readElementText().toDouble());
+                                        } else if(xml.name() == "v_acc") {
+                                            point.setVerticalAccuracy(xml.readElementText().toDouble());
+                                        } else if(xml.name() == "distance") {
+                                            point.setDistance(xml.readElementText().toDouble());
+                                        } else if(xml.name() == "cadence") {
+                                            point.setCadence(xml.readElementText().toDouble());
+                                        } else if(xml.name() == "raw_lat") {
+                                            point.setRawLatitude(xml.readElementText().toDouble());
+                                        } else if(xml.name() == "raw_lon") {
+                                            point.setRawLongitude(xml.readElementText().toDouble());
+                                        } else {
+                                            xml.skipCurrentElement();
+                                        }
+                                    }
+                                } else {
+                                    xml.skipCurrentElement();
+                                }
+                            }
+                            track.points.append(point);
+                            // The reader buffers ahead, pos() is close enough for progress
+                            if(progress && track.points.size() % chunkSize == 0
+                                    && !progress->update(track, (qreal)device->pos() / qMax(device->size(), Q_INT64_C(1)))) {
+                                return Cancelled;
+                            }
+                        } else {
+                            xml.skipCurrentElement();
+                        }
+                    }
+                } else {
+                    xml.skipCurrentElement();
+                }
+            }
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+    return Ok;
+}
+
+GpxParser::Result GpxParser::parseFile(const QString &filename, GpxTrack &track, bool *fastPath,
+                                       GpxProgress *progress) {
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly)) {
+        qDebug()<<"Error opening"<<filename;
+        return NotGpx;
+    }
+
+    qint64 size = file.size();
+    uchar *data = size > 0 ? file.map(0, size) : 0;
+    if(data) {
+        Result result = parseFast((const char *)data, size, track, progress);
+        file.unmap(data);
+        if(result == Ok || result == Cancelled) {
+            if(fastPath) {
+                *fastPath = true;
+            }
+            return result;
+        }
+        // Start over with the generic reader
+        track = GpxTrack();
+    }
+
+    if(fastPath) {
+        *fastPath = false;
+    }
+    file.seek(0);
+    return parseXml(&file, track, progress);
+}
@@ -0,0 +1,76 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GPXPARSER_H
+#define GPXPARSER_H
+
+#include <QString>
+#include <QIODevice>
+
+#include "TrackPoints.h"
+
+struct GpxTrack {
+    QString name;
+    QString description;
+    TrackPoints points;
+};
+
+/*
+ * Told about the points parsed so far every GpxParser::chunkSize points.
+ * If the fast path gives up, parsing starts over and the same points are
+ * reported again from the first one.
+ */
+class GpxProgress
+{
+public:
+    virtual ~GpxProgress() {}
+    // fraction is the share of the file consumed, returning false stops
+    // parsing with GpxParser::Cancelled
+    virtual bool update(const GpxTrack &track, qreal fraction) = 0;
+};
+
+/*
+ * GPX 1.1 reader. parseFile() maps the file and first tries a hand-rolled
+ * scanner that only understands the layout written by Rena itself. Any
+ * surprise makes it give up and the file is read again with
+ * QXmlStreamReader, which handles GPX from other applications.
+ */
+class GpxParser
+{
+public:
+    enum Result {
+        Ok,
+        NotGpx,         // Not a GPX 1.1 file
+        Unsupported,    // Fast path only: layout not recognised
+        Cancelled       // GpxProgress::update() returned false
+    };
+
+    static const int chunkSize = 1000;
+
+    static Result parseFile(const QString &filename, GpxTrack &track, bool *fastPath = 0,
+                            GpxProgress *progress = 0);
+    static Result parseFast(const char *data, qint64 size, GpxTrack &track,
+                            GpxProgress *progress = 0);
+    static Result parseXml(QIODevice *device, GpxTrack &track, GpxProgress *progress = 0);
+
+    static bool parseDouble(const char *begin, const char *end, qreal &value);
+};
+
+#endif // GPXPARSER_H
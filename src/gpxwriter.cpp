@@ -0,0 +1,135 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpxwriter.h"
+
+#define ELEMENT(name) "<" name ">", sizeof("<" name ">") - 1, "</" name ">\n", sizeof("</" name ">\n") - 1
+
+GpxWriter::GpxWriter(QIODevice *device) :
+    TrackWriter(device)
+{
+}
+
+void GpxWriter::writeElement(const char *open, int openLen, const char *close, int closeLen, qreal value) {
+    append(open, openLen);
+    writeNumber(value);
+    append(close, closeLen);
+}
+
+bool GpxWriter::write(TrackPointIterator &points, const QString &name, const QString &description) {
+    begin();
+
+    append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+           "<gpx xmlns=\"http://www.topografix.com/GPX/1/1\" version=\"1.1\" Creator=\"Rena for Sailfish\">\n");
+    if(!name.isEmpty() || !description.isEmpty()) {
+        append("    <metadata>\n");
+        if(!name.isEmpty()) {
+            append("        <name>");
+            writeEscaped(name);
+            append("</name>\n");
+        }
+        if(!description.isEmpty()) {
+            append("        <desc>");
+            writeEscaped(description);
+            append("</desc>\n");
+        }
+        append("    </metadata>\n");
+    }
+    append("    <trk>\n"
+           "        <trkseg>\n");
+
+    const quint16 extensionFlags = TrackPoint::HasDirection | TrackPoint::HasGroundSpeed
+            | TrackPoint::HasVerticalSpeed | TrackPoint::HasMagneticVariation
+            | TrackPoint::HasHorizontalAccuracy | TrackPoint::HasVerticalAccuracy
+            | TrackPoint::HasDistance | TrackPoint::HasCadence
+            | TrackPoint::HasRawLatitude | TrackPoint::HasRawLongitude;
+
+    while(!m_error && points.next()) {
+        quint16 flags = points.flags();
+        bool coordinate = flags & TrackPoint::HasCoordinate;
+        append("            <trkpt lat=\"");
+        writeNumber(coordinate ? points.latitude() : 0);
+        append("\" lon=\"");
+        writeNumber(coordinate ? points.longitude() : 0);
+        append("\">\n"
+               "                <time>");
+        if(flags & TrackPoint::HasTime) {
+            writeTime(points.timeMs());
+        }
+        append("</time>\n");
+        if(flags & TrackPoint::HasElevation) {
+            append("                ");
+            writeElement(ELEMENT("ele"), points.elevation());
+        }
+
+        if(flags & extensionFlags) {
+            append("                <extensions>\n");
+            if(flags & TrackPoint::HasDirection) {
+                append("                    ");
+                writeElement(ELEMENT("dir"), points.value(TrackPoint::Direction));
+            }
+            if(flags & TrackPoint::HasGroundSpeed) {
+                append("                    ");
+                writeElement(ELEMENT("g_spd"), points.value(TrackPoint::GroundSpeed));
+            }
+            if(flags & TrackPoint::HasVerticalSpeed) {
+                append("                    ");
+                writeElement(ELEMENT("v_spd"), points.value(TrackPoint::VerticalSpeed));
+            }
+            if(flags & TrackPoint::HasMagneticVariation) {
+                append("                    ");
+                writeElement(ELEMENT("m_var"), points.value(TrackPoint::MagneticVariation));
+            }
+            if(flags & TrackPoint::HasHorizontalAccuracy) {
+                append("                    ");
+                writeElement(ELEMENT("h_acc"), points.value(TrackPoint::HorizontalAccuracy));
+            }
+            if(flags & TrackPoint::HasVerticalAccuracy) {
+                append("                    ");
+                writeElement(ELEMENT("v_acc"), points.value(TrackPoint::VerticalAccuracy));
+            }
+            if(flags & TrackPoint::HasDistance) {
+                append("                    ");
+                writeElement(ELEMENT("distance"), points.value(TrackPoint::Distance));
+            }
+            if(flags & TrackPoint::HasCadence) {
+                append("                    ");
+                writeElement(ELEMENT("cadence"), points.value(TrackPoint::Cadence));
+            }
+            if(flags & TrackPoint::HasRawLatitude) {
+                append("                    ");
+                writeElement(ELEMENT("raw_lat"), points.value(TrackPoint::RawLatitude));
+            }
+            if(flags & TrackPoint::HasRawLongitude) {
+                append("                    ");
+                writeElement(ELEMENT("raw_lon"), points.value(TrackPoint::RawLongitude));
+            }
+            append("                </extensions>\n");
+        } else {
+            append("                <extensions/>\n");
+        }
+        append("            </trkpt>\n");
+    }
+
+    append("        </trkseg>\n"
+           "    </trk>\n"
+           "</gpx>\n");
+    return end();
+}
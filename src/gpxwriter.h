@@ -0,0 +1,41 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GPXWRITER_H
+#define GPXWRITER_H
+
+#include "trackwriter.h"
+
+/*
+ * Writes a track as GPX 1.1 in the layout QXmlStreamWriter used to produce
+ * with auto formatting, so old and new files look the same.
+ */
+class GpxWriter : public TrackWriter
+{
+public:
+    explicit GpxWriter(QIODevice *device);
+    using TrackWriter::write;
+    bool write(TrackPointIterator &points, const QString &name, const QString &description);
+
+private:
+    void writeElement(const char *open, int openLen, const char *close, int closeLen, qreal value);
+};
+
+#endif // GPXWRITER_H
@@ -24,6 +24,7 @@
 #include <QDebug>
 #include "historymodel.h"
 #include "trackloader.h"
+#include "tracksummarycache.h"
 
 TrackItem loadTrack(TrackItem track) {
     TrackItem data = track;
@@ -162,6 +163,10 @@ bool HistoryModel::removeTrack(int index) {
     QString filename = m_trackList.at(index).filename;
     bool success = dir.remove(filename);
     if(success) {
+        TrackSummaryCache cache;
+        cache.load();
+        cache.remove(filename);
+        cache.save();
         beginRemoveRows(QModelIndex(), index, index);
         m_trackList.removeAt(index);
         endRemoveRows();
@@ -177,12 +182,37 @@ void HistoryModel::newTrackData(int num) {
     TrackItem data = trackLoading.resultAt(num);
     qDebug()<<"Finished loading"<<data.filename;
     m_trackList[data.id] = data;
+    m_newSummaries.append(data);
     QModelIndex index = QAbstractItemModel::createIndex(data.id, 0);
     emit dataChanged(index, index);
 }
 
 void HistoryModel::loadingFinished() {
     qDebug()<<"Data loading finished";
+    updateSummaryCache();
+}
+
+void HistoryModel::updateSummaryCache() {
+    if(m_newSummaries.isEmpty()) {
+        return;
+    }
+    TrackSummaryCache cache;
+    cache.load();
+    // Listed again, a track saved since readDirectory() keeps its entry
+    QString dirName = QStandardPaths::writableLocation(QStandardPaths::HomeLocation) + "/Rena";
+    QStringList filenames = QDir(dirName).entryList(QStringList("*.gpx"), QDir::Files);
+    cache.retain(filenames);
+    foreach(const TrackItem &item, m_newSummaries) {
+        TrackSummary summary;
+        summary.name = item.name;
+        summary.time = item.time;
+        summary.duration = item.duration;
+        summary.distance = item.distance;
+        summary.speed = item.speed;
+        cache.insert(item.info, summary);
+    }
+    cache.save();
+    m_newSummaries.clear();
 }
 
 void HistoryModel::readDirectory() {
@@ -200,19 +230,38 @@ void HistoryModel::readDirectory() {
     dir.setFilter(QDir::Files);
     dir.setSorting(QDir::Name | QDir::Reversed);
     dir.setNameFilters(QStringList("*.gpx"));
-    QStringList entries = dir.entryList();
+    // entryInfoList() stats every file once, that is all a cached entry needs
+    QFileInfoList entries = dir.entryInfoList();
 
+    TrackSummaryCache cache;
+    cache.load();
+    QList<TrackItem> pending;
     for(int i=0;i<entries.size();i++) {
         TrackItem item;
+        TrackSummary summary;
         item.id = i;
-        item.filename = entries.at(i);
-        item.ready = false;
-        item.name = item.filename;
-        item.time = QDateTime();
-        item.duration = 0;
-        item.distance = 0;
-        item.speed = 0;
+        item.info = entries.at(i);
+        item.filename = item.info.fileName();
+        if(cache.lookup(item.info, summary)) {
+            item.ready = true;
+            item.name = summary.name;
+            item.time = summary.time;
+            item.duration = summary.duration;
+            item.distance = summary.distance;
+            item.speed = summary.speed;
+        } else {
+            item.ready = false;
+            item.name = item.filename;
+            item.time = QDateTime();
+            item.duration = 0;
+            item.distance = 0;
+            item.speed = 0;
+            pending.append(item);
+        }
         m_trackList.append(item);
     }
-    trackLoading.setFuture(QtConcurrent::mapped(m_trackList, loadTrack));
+    qDebug()<<entries.size()<<"tracks,"<<pending.size()<<"not in the index";
+    if(!pending.isEmpty()) {
+        trackLoading.setFuture(QtConcurrent::mapped(pending, loadTrack));
+    }
 }
@@ -24,11 +24,13 @@
 #include <QAbstractListModel>
 #include <QList>
 #include <QDateTime>
+#include <QFileInfo>
 #include <QtConcurrent>
 
 struct TrackItem {
     int id;
     QString filename;
+    QFileInfo info;
     bool ready;
     QString name;
     QDateTime time;
@@ -66,7 +68,9 @@ public slots:
 
 private:
     void readDirectory();
+    void updateSummaryCache();
     QList<TrackItem> m_trackList;
+    QList<TrackItem> m_newSummaries;    // Parsed tracks not yet in the index
     QFutureWatcher<TrackItem> trackLoading;
 
 };
@@ -0,0 +1,184 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "isotime.h"
+
+// Civil date conversions, see
+// http://howardhinnant.github.io/date_algorithms.html
+static qint64 daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (qint64)era * 146097 + doe - 719468;
+}
+
+static void civilFromDays(qint64 days, int &y, int &m, int &d) {
+    qint64 z = days + 719468;
+    qint64 era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+    int doy = doe - (365*yoe + yoe/4 - yoe/100);
+    int mp = (5*doy + 2) / 153;
+    d = doy - (153*mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = yoe + era * 400 + (m <= 2);
+}
+
+static bool digits(const char *p, int count, int &value) {
+    value = 0;
+    for(int i=0;i<count;i++) {
+        if(p[i] < '0' || p[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (p[i] - '0');
+    }
+    return true;
+}
+
+static inline void twoDigits(int value, char *out) {
+    out[0] = '0' + value / 10;
+    out[1] = '0' + value % 10;
+}
+
+IsoTime::IsoTime() :
+    m_formatDay(-1),
+    m_parseDay(0)
+{
+    // Matches no date, the first parse() fills it
+    memset(m_parsePrefix, 0, sizeof(m_parsePrefix));
+}
+
+int IsoTime::format(qint64 msecs, char *out) {
+    qint64 day = msecs >= 0 ? msecs / 86400000 : (msecs - 86399999) / 86400000;
+    int msOfDay = msecs - day * 86400000;
+    if(day != m_formatDay) {
+        int y, m, d;
+        civilFromDays(day, y, m, d);
+        snprintf(m_formatPrefix, sizeof(m_formatPrefix), "%04d-%02d-%02dT", y, m, d);
+        m_formatDay = day;
+    }
+    memcpy(out, m_formatPrefix, 11);
+    int secs = msOfDay / 1000;
+    twoDigits(secs / 3600, out + 11);
+    out[13] = ':';
+    twoDigits(secs / 60 % 60, out + 14);
+    out[16] = ':';
+    twoDigits(secs % 60, out + 17);
+    int len = 19;
+    int millis = msOfDay % 1000;
+    if(millis) {
+        out[19] = '.';
+        out[20] = '0' + millis / 100;
+        twoDigits(millis % 100, out + 21);
+        len = 23;
+    }
+    out[len++] = 'Z';
+    return len;
+}
+
+QString IsoTime::toString(qint64 msecs) {
+    char buffer[maxLength];
+    return QString::fromLatin1(buffer, format(msecs, buffer));
+}
+
+bool IsoTime::parse(const char *begin, const char *end, qint64 &msecs) {
+    const char *p = begin;
+    int hour, minute, second;
+    if(end - p < 20 || p[4] != '-' || p[7] != '-' || p[10] != 'T' || p[13] != ':' || p[16] != ':'
+            || !digits(p + 11, 2, hour) || !digits(p + 14, 2, minute) || !digits(p + 17, 2, second)
+            || hour > 23 || minute > 59 || second > 59) {
+        return false;
+    }
+    qint64 days;
+    if(memcmp(p, m_parsePrefix, sizeof(m_parsePrefix)) == 0) {
+        days = m_parseDay;
+    } else {
+        int year, month, day;
+        if(!digits(p, 4, year) || !digits(p + 5, 2, month) || !digits(p + 8, 2, day)
+                || month < 1 || month > 12 || day < 1 || day > 31) {
+            return false;
+        }
+        days = daysFromCivil(year, month, day);
+        memcpy(m_parsePrefix, p, sizeof(m_parsePrefix));
+        m_parseDay = days;
+    }
+    p += 19;
+
+    int millis = 0;
+    if(*p == '.') {
+        p++;
+        int scale = 100;
+        const char *fraction = p;
+        while(p < end && *p >= '0' && *p <= '9') {
+            millis += (*p - '0') * scale;
+            scale /= 10;
+            p++;
+        }
+        if(p == fraction) {
+            return false;
+        }
+    }
+
+    int offset = 0;
+    if(p < end && *p == 'Z') {
+        p++;
+    } else if(end - p >= 6 && (*p == '+' || *p == '-') && p[3] == ':') {
+        int offsetHours, offsetMinutes;
+        if(!digits(p + 1, 2, offsetHours) || !digits(p + 4, 2, offsetMinutes)) {
+            return false;
+        }
+        offset = (offsetHours * 60 + offsetMinutes) * 60;
+        if(*p == '-') {
+            offset = -offset;
+        }
+        p += 6;
+    } else {
+        // Local time
+        return false;
+    }
+    if(p != end) {
+        return false;
+    }
+
+    qint64 secs = days * 86400 + hour * 3600 + minute * 60 + second - offset;
+    msecs = secs * 1000 + millis;
+    return true;
+}
+
+bool IsoTime::parse(const QString &text, qint64 &msecs) {
+    char buffer[64];
+    int len = text.size();
+    if(len > (int)sizeof(buffer)) {
+        return false;
+    }
+    const QChar *data = text.constData();
+    for(int i=0;i<len;i++) {
+        ushort c = data[i].unicode();
+        if(c > 0x7f) {
+            return false;
+        }
+        buffer[i] = c;
+    }
+    return parse(buffer, buffer + len, msecs);
+}
@@ -0,0 +1,55 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ISOTIME_H
+#define ISOTIME_H
+
+#include <QString>
+
+/*
+ * Codec for the UTC timestamps Rena reads and writes, epoch milliseconds
+ * to and from YYYY-MM-DDTHH:MM:SS[.sss]Z. The date of the last timestamp
+ * is cached in both directions since a track rarely spans more than one
+ * day, so most timestamps only convert the time of day.
+ */
+class IsoTime
+{
+public:
+    // Longest output of format()
+    static const int maxLength = 24;
+
+    IsoTime();
+    // Writes msecs to out without a terminating zero and returns the
+    // length. Milliseconds are only written when they are not zero.
+    int format(qint64 msecs, char *out);
+    QString toString(qint64 msecs);
+    // Also accepts a numeric +HH:MM offset. Local times without a zone
+    // are rejected, those are left to QDateTime.
+    bool parse(const char *begin, const char *end, qint64 &msecs);
+    bool parse(const QString &text, qint64 &msecs);
+
+private:
+    qint64 m_formatDay;
+    char m_formatPrefix[16];    // YYYY-MM-DDT of m_formatDay
+    qint64 m_parseDay;
+    char m_parsePrefix[10];     // YYYY-MM-DD of m_parseDay
+};
+
+#endif // ISOTIME_H
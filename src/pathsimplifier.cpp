@@ -0,0 +1,151 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QGeoCoordinate>
+#include <qmath.h>
+#include <limits>
+#include <algorithm>
+#include "pathsimplifier.h"
+#include "TrackBounds.h"
+
+static const int chunkSize = 1024;
+// Allowed deviation from the full track on screen
+static const qreal pixelTolerance = 1.0;
+
+PathSimplifier::PathSimplifier() :
+    m_pointCount(0)
+{
+}
+
+void PathSimplifier::clear() {
+    m_index.clear();
+    m_lat.clear();
+    m_lon.clear();
+    m_x.clear();
+    m_y.clear();
+    m_importance.clear();
+    m_pointCount = 0;
+}
+
+int PathSimplifier::pointCount() const {
+    return m_pointCount;
+}
+
+void PathSimplifier::update(const TrackPoints &points, int from) {
+    if(from >= points.size() && m_pointCount == points.size()) {
+        return;
+    }
+    from = qMin(from, m_pointCount);
+
+    // Drop the chunk holding the first changed point and everything after
+    int vertex = std::lower_bound(m_index.constBegin(), m_index.constEnd(), from) - m_index.constBegin();
+    int chunkStart = vertex / chunkSize * chunkSize;
+    int first = chunkStart > 0 ? m_index.at(chunkStart - 1) + 1 : 0;
+    m_index.resize(chunkStart);
+    m_lat.resize(chunkStart);
+    m_lon.resize(chunkStart);
+    m_x.resize(chunkStart);
+    m_y.resize(chunkStart);
+    m_importance.resize(chunkStart);
+
+    for(int i=first;i<points.size();i++) {
+        if(!points.hasCoordinate(i)) {
+            continue;
+        }
+        qreal lat = points.latitude(i);
+        qreal lon = points.longitude(i);
+        m_index.append(i);
+        m_lat.append(lat);
+        m_lon.append(lon);
+        m_x.append(TrackBounds::mercatorX(lon));
+        m_y.append(TrackBounds::mercatorY(lat));
+    }
+    m_importance.resize(m_index.size());
+    m_pointCount = points.size();
+
+    for(int begin=chunkStart;begin<m_index.size();begin+=chunkSize) {
+        simplifyChunk(begin, qMin(begin + chunkSize, m_index.size()) - 1);
+    }
+}
+
+// Distance of (px, py) from the segment (ax, ay)-(bx, by)
+static qreal segmentDistance(qreal px, qreal py, qreal ax, qreal ay, qreal bx, qreal by) {
+    qreal dx = bx - ax;
+    qreal dy = by - ay;
+    qreal lengthSquared = dx*dx + dy*dy;
+    qreal t = 0;
+    if(lengthSquared > 0) {
+        t = qBound(0.0, ((px - ax)*dx + (py - ay)*dy) / lengthSquared, 1.0);
+    }
+    qreal ex = ax + t*dx - px;
+    qreal ey = ay + t*dy - py;
+    return qSqrt(ex*ex + ey*ey);
+}
+
+struct Segment {
+    int first;
+    int last;
+    float limit;    // A vertex is never more important than its parent
+};
+
+void PathSimplifier::simplifyChunk(int begin, int end) {
+    const float always = std::numeric_limits<float>::infinity();
+    m_importance[begin] = always;
+    m_importance[end] = always;
+
+    QVector<Segment> stack;
+    Segment whole = {begin, end, always};
+    stack.append(whole);
+    while(!stack.isEmpty()) {
+        Segment segment = stack.last();
+        stack.removeLast();
+        if(segment.last - segment.first < 2) {
+            continue;
+        }
+        int split = segment.first + 1;
+        qreal maxDistance = -1;
+        qreal ax = m_x.at(segment.first), ay = m_y.at(segment.first);
+        qreal bx = m_x.at(segment.last), by = m_y.at(segment.last);
+        for(int i=segment.first+1;i<segment.last;i++) {
+            qreal distance = segmentDistance(m_x.at(i), m_y.at(i), ax, ay, bx, by);
+            if(distance > maxDistance) {
+                maxDistance = distance;
+                split = i;
+            }
+        }
+        float importance = qMin((float)maxDistance, segment.limit);
+        m_importance[split] = importance;
+        Segment left = {segment.first, split, importance};
+        Segment right = {split, segment.last, importance};
+        stack.append(left);
+        stack.append(right);
+    }
+}
+
+QVariantList PathSimplifier::path(qreal zoomLevel) const {
+    float tolerance = pixelTolerance / (256.0 * qPow(2, zoomLevel));
+    QVariantList path;
+    for(int i=0;i<m_importance.size();i++) {
+        if(m_importance.at(i) >= tolerance) {
+            path.append(QVariant::fromValue(QGeoCoordinate(m_lat.at(i), m_lon.at(i))));
+        }
+    }
+    return path;
+}
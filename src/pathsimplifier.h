@@ -0,0 +1,60 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHSIMPLIFIER_H
+#define PATHSIMPLIFIER_H
+
+#include <QVector>
+#include <QVariantList>
+
+#include "TrackPoints.h"
+
+/*
+ * Level of detail for drawing a track on the map. Every vertex gets the
+ * Douglas-Peucker tolerance (in Web-Mercator units) below which it is
+ * needed, so the path for any zoom level is a single filter pass.
+ *
+ * Vertices are processed in fixed size chunks whose end points are always
+ * kept. Appending to a recording only recomputes the last chunk.
+ */
+class PathSimplifier
+{
+public:
+    PathSimplifier();
+    void clear();
+    // Brings the hierarchy up to date with points changed from index on
+    void update(const TrackPoints &points, int from);
+    int pointCount() const;
+    // Coordinates visible at the zoom level as QGeoCoordinates
+    QVariantList path(qreal zoomLevel) const;
+
+private:
+    void simplifyChunk(int begin, int end);
+
+    QVector<int> m_index;           // Point index of each vertex
+    QVector<qreal> m_lat;
+    QVector<qreal> m_lon;
+    QVector<qreal> m_x;
+    QVector<qreal> m_y;
+    QVector<float> m_importance;
+    int m_pointCount;
+};
+
+#endif // PATHSIMPLIFIER_H
@@ -7,7 +7,22 @@
 #include "trackrecorder.h"
 
 Plugins::Plugins(QObject *parent) : QObject(parent) {
+	dropped = 0;
 	loadPlugins();
+	if (!tiis.isEmpty()) {
+		sensorThread.start();
+	}
+}
+
+Plugins::~Plugins() {
+	if (sensorThread.isRunning()) {
+		// Let the plugins close their sockets in their own thread
+		foreach (TrackInfoInterface *tii, tiis) {
+			QMetaObject::invokeMethod(tii->getObject(), "setTracking", Qt::BlockingQueuedConnection, Q_ARG(bool, false));
+		}
+		sensorThread.quit();
+		sensorThread.wait();
+	}
 }
 
 void Plugins::loadPlugins() {
@@ -29,16 +44,16 @@ void Plugins::loadPlugins() {
 		if (tii) {
 			tiis.push_back(tii);
 			qDebug() << "TrackInfoInterface loaded" << track_infos[i];
-			connect(tii->getObject(), SIGNAL(infoAvailable(TrackPoint)), SIGNAL(infoAvailable(TrackPoint)));
+			tii->getObject()->moveToThread(&sensorThread);
 		} else {
 			qDebug() << "TrackInfoInterface load failed" << track_infos[i];
 		}
 	}
 }
 
-void Plugins::uploadTrack(QString name) {
+void Plugins::uploadTrack(QString name, const TrackPoints &points, QString description) {
 	foreach (UploadInterface *ui, uis) {
-		ui->uploadTrack(name);
+		ui->uploadRecordedTrack(name, points, description);
 	}
 }
 
@@ -61,13 +76,42 @@ void Plugins::openSettings(QString name) {
 	}
 }
 
+QVariantList Plugins::getUploadMetrics(QString name) {
+	foreach (UploadInterface *ui, uis) {
+		if (ui->getName() == name) {
+			return ui->getUploadMetrics();
+		}
+	}
+	return QVariantList();
+}
+
+bool Plugins::hasTrackInfo() const {
+	return !tiis.isEmpty();
+}
+
+void Plugins::takeSamples(QVector<TrackPoint> &points) {
+	int total_dropped = 0;
+	foreach (TrackInfoInterface *tii, tiis) {
+		SensorRing *ring = tii->samples();
+		SensorSample sample;
+		while (ring->pop(sample)) {
+			points.append(sample.toTrackPoint());
+		}
+		total_dropped += ring->dropped();
+	}
+	if (total_dropped != dropped) {
+		qDebug() << "sensor samples dropped" << total_dropped - dropped << "total" << total_dropped;
+		dropped = total_dropped;
+	}
+}
+
 void Plugins::changeTrackingStatus() {
 	QObject *trackrecorder_obj = parent()->findChild<QObject*>("recorder");
 	if (trackrecorder_obj) {
 		TrackRecorder *trackrecorder = qobject_cast<TrackRecorder *>(trackrecorder_obj);
 		if (trackrecorder) {
 			foreach (TrackInfoInterface *tii, tiis) {
-				tii->setTracking(trackrecorder->isTracking());
+				QMetaObject::invokeMethod(tii->getObject(), "setTracking", Q_ARG(bool, trackrecorder->isTracking()));
 			}
 		} else {
 			qDebug() << "didn't get trackrecorder";
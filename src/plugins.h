@@ -4,27 +4,36 @@
 #include <QObject>
 #include <QVariant>
 #include <QList>
+#include <QVector>
+#include <QThread>
 
 #include "../plugins/UploadInterface.h"
 #include "../plugins/TrackInfoInterface.h"
 #include "TrackPoint.h"
+#include "TrackPoints.h"
 
 class Plugins : public QObject
 {
     Q_OBJECT
 public:
     explicit Plugins(QObject *parent = 0);
+	~Plugins();
 	void loadPlugins();
-	void uploadTrack(QString name);
+	void uploadTrack(QString name, const TrackPoints &points, QString description);
 	Q_INVOKABLE QVariantList getNames();
 	Q_INVOKABLE void openSettings(QString name);
-signals:
-	void infoAvailable(TrackPoint info);
+	Q_INVOKABLE QVariantList getUploadMetrics(QString name);
+	bool hasTrackInfo() const;
+	// Moves queued sensor samples of all plugins to points
+	void takeSamples(QVector<TrackPoint> &points);
 public slots:
 	void changeTrackingStatus();
 private:
     QList<UploadInterface *> uis;
     QList<TrackInfoInterface *> tiis;
+    int dropped;
+    // Event loop shared by all sensor plugins
+    QThread sensorThread;
 };
 
 #endif
@@ -0,0 +1,347 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QGeoCoordinate>
+#include <QDebug>
+#include <limits>
+#include "replaypositionsource.h"
+#include "gpxparser.h"
+#include "autosavejournal.h"
+
+static const qint64 never = std::numeric_limits<qint64>::max();
+// Events emitted before yielding to the event loop at full speed
+static const int maxBatch = 256;
+
+ReplayPositionSource::ReplayPositionSource(QObject *parent) :
+    QGeoPositionInfoSource(parent)
+{
+    m_speed = 1;
+    m_sensorRate = 0;
+    m_sensorJitter = 0;
+    m_seed = 1;
+    m_running = false;
+    m_startTrackTime = 0;
+    m_timer.setSingleShot(true);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(step()));
+    rewind();
+}
+
+bool ReplayPositionSource::load(const QString &filename) {
+    AutoSaveJournal journal(filename);
+    if(journal.isJournal()) {
+        TrackPoints points;
+        if(!journal.load(points)) {
+            qDebug()<<"Replay: reading journal"<<filename<<"failed";
+            return false;
+        }
+        setPoints(points);
+        return true;
+    }
+    GpxTrack track;
+    if(GpxParser::parseFile(filename, track) != GpxParser::Ok) {
+        qDebug()<<"Replay:"<<filename<<"is not a GPX file or autosave journal";
+        return false;
+    }
+    setPoints(track.points);
+    return true;
+}
+
+void ReplayPositionSource::setPoints(const TrackPoints &points) {
+    m_points = points;
+    m_distances.resize(m_points.size());
+    qreal distance = 0;
+    int last = -1;
+    for(int i=0;i<m_points.size();i++) {
+        if(m_points.hasCoordinate(i)) {
+            if(last >= 0) {
+                QGeoCoordinate from(m_points.latitude(last), m_points.longitude(last));
+                distance += from.distanceTo(QGeoCoordinate(m_points.latitude(i), m_points.longitude(i)));
+            }
+            last = i;
+        }
+        m_distances[i] = distance;
+    }
+    rewind();
+}
+
+int ReplayPositionSource::pointCount() const {
+    return m_points.size();
+}
+
+bool ReplayPositionSource::atEnd() const {
+    return nextEventTime() == never;
+}
+
+void ReplayPositionSource::rewind() {
+    m_next = 0;
+    m_lastFixTime = 0;
+    m_sampleIndex = 0;
+    m_nextSampleTime = m_points.size() > 0 ? m_points.timeMs(0) : 0;
+    m_pending.clear();
+    m_lastPosition = QGeoPositionInfo();
+    m_startTrackTime = m_nextSampleTime;
+}
+
+void ReplayPositionSource::setSpeed(qreal speed) {
+    m_startTrackTime = trackNow();
+    m_speed = qMax((qreal)0, speed);
+    if(m_running) {
+        if(m_startTrackTime == never) {
+            m_startTrackTime = nextEventTime();
+        }
+        m_clock.restart();
+        schedule();
+    }
+}
+
+qreal ReplayPositionSource::speed() const {
+    return m_speed;
+}
+
+void ReplayPositionSource::setSensorRate(qreal rate) {
+    m_sensorRate = qMax((qreal)0, rate);
+}
+
+void ReplayPositionSource::setSensorJitter(int msecs) {
+    m_sensorJitter = qMax(0, msecs);
+}
+
+void ReplayPositionSource::setSeed(quint32 seed) {
+    m_seed = seed ? seed : 1;
+}
+
+ReplayPositionSource *ReplayPositionSource::fromEnvironment(QObject *parent) {
+    QString filename = QString::fromLocal8Bit(qgetenv("RENA_REPLAY"));
+    if(filename.isEmpty()) {
+        return 0;
+    }
+    ReplayPositionSource *source = new ReplayPositionSource(parent);
+    if(!source->load(filename)) {
+        delete source;
+        return 0;
+    }
+    QByteArray speed = qgetenv("RENA_REPLAY_SPEED");
+    if(!speed.isEmpty()) {
+        source->setSpeed(speed.toDouble());
+    }
+    source->setSensorRate(qgetenv("RENA_REPLAY_SENSOR_RATE").toDouble());
+    source->setSensorJitter(qgetenv("RENA_REPLAY_SENSOR_JITTER").toInt());
+    qDebug()<<"Replaying"<<source->pointCount()<<"points from"<<filename<<"at speed"<<source->speed();
+    return source;
+}
+
+void ReplayPositionSource::setUpdateInterval(int msec) {
+    QGeoPositionInfoSource::setUpdateInterval(qMax(0, msec));
+}
+
+QGeoPositionInfo ReplayPositionSource::lastKnownPosition(bool fromSatellitePositioningMethodsOnly) const {
+    Q_UNUSED(fromSatellitePositioningMethodsOnly);
+    return m_lastPosition;
+}
+
+QGeoPositionInfoSource::PositioningMethods ReplayPositionSource::supportedPositioningMethods() const {
+    return SatellitePositioningMethods;
+}
+
+int ReplayPositionSource::minimumUpdateInterval() const {
+    return 0;
+}
+
+QGeoPositionInfoSource::Error ReplayPositionSource::error() const {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 3, 0)
+    return NoError;
+#else
+    return UnknownSourceError;
+#endif
+}
+
+void ReplayPositionSource::startUpdates() {
+    if(m_running) {
+        return;
+    }
+    m_running = true;
+    m_startTrackTime = nextEventTime() == never ? 0 : nextEventTime();
+    m_clock.start();
+    m_timer.start(0);
+}
+
+void ReplayPositionSource::stopUpdates() {
+    m_startTrackTime = trackNow();
+    m_running = false;
+    m_timer.stop();
+}
+
+void ReplayPositionSource::requestUpdate(int timeout) {
+    Q_UNUSED(timeout);
+    QMetaObject::invokeMethod(this, "emitLastKnown", Qt::QueuedConnection);
+}
+
+void ReplayPositionSource::emitLastKnown() {
+    if(m_lastPosition.isValid()) {
+        emit positionUpdated(m_lastPosition);
+    } else {
+        emit updateTimeout();
+    }
+}
+
+QGeoPositionInfo ReplayPositionSource::positionInfo(const TrackPoint &point) {
+    QGeoCoordinate coordinate(point.getLatitude(), point.getLongitude());
+    if(point.hasElevation()) {
+        coordinate.setAltitude(point.getElevation());
+    }
+    QGeoPositionInfo info(coordinate, point.getTime());
+    if(point.hasDirection()) {
+        info.setAttribute(QGeoPositionInfo::Direction, point.getDirection());
+    }
+    if(point.hasGroundSpeed()) {
+        info.setAttribute(QGeoPositionInfo::GroundSpeed, point.getGroundSpeed());
+    }
+    if(point.hasVerticalSpeed()) {
+        info.setAttribute(QGeoPositionInfo::VerticalSpeed, point.getVerticalSpeed());
+    }
+    if(point.hasMagneticVariation()) {
+        info.setAttribute(QGeoPositionInfo::MagneticVariation, point.getMagneticVariation());
+    }
+    if(point.hasHorizontalAccuracy()) {
+        info.setAttribute(QGeoPositionInfo::HorizontalAccuracy, point.getHorizontalAccuracy());
+    }
+    if(point.hasVerticalAccuracy()) {
+        info.setAttribute(QGeoPositionInfo::VerticalAccuracy, point.getVerticalAccuracy());
+    }
+    return info;
+}
+
+qint64 ReplayPositionSource::trackNow() const {
+    if(!m_running) {
+        return m_startTrackTime;
+    }
+    if(m_speed <= 0) {
+        return never;
+    }
+    return m_startTrackTime + (qint64)(m_clock.elapsed() * m_speed);
+}
+
+qint64 ReplayPositionSource::nextEventTime() const {
+    qint64 next = never;
+    if(m_next < m_points.size()) {
+        next = m_points.timeMs(m_next);
+    }
+    if(m_sensorRate > 0 && m_points.size() > 1
+            && m_nextSampleTime <= m_points.timeMs(m_points.size() - 1)) {
+        next = qMin(next, m_nextSampleTime);
+    }
+    if(!m_pending.isEmpty()) {
+        next = qMin(next, m_pending.first().due);
+    }
+    return next;
+}
+
+// Emits the earliest event due by until, returns false if there is none
+bool ReplayPositionSource::emitNext(qint64 until) {
+    qint64 next = nextEventTime();
+    if(next == never || next > until) {
+        return false;
+    }
+    if(!m_pending.isEmpty() && m_pending.first().due == next) {
+        TrackPoint sample = m_pending.first().sample;
+        m_pending.remove(0);
+        emit sensorSample(sample);
+    } else if(m_sensorRate > 0 && m_nextSampleTime == next) {
+        PendingSample pending;
+        pending.sample = sampleAt(m_nextSampleTime);
+        pending.due = m_nextSampleTime;
+        if(m_sensorJitter > 0) {
+            pending.due += random() % (m_sensorJitter + 1);
+        }
+        m_nextSampleTime += qMax((qint64)1, (qint64)(1000 / m_sensorRate));
+        if(pending.due == next) {
+            emit sensorSample(pending.sample);
+        } else {
+            int index = m_pending.size();
+            while(index > 0 && m_pending.at(index - 1).due > pending.due) {
+                index--;
+            }
+            m_pending.insert(index, pending);
+        }
+    } else {
+        TrackPoint point = m_points.at(m_next++);
+        // Thin to the requested interval, allowing for fix time jitter
+        if(point.hasCoordinate() && point.hasTime()
+                && (m_lastFixTime == 0 || point.getTimeMs() - m_lastFixTime + 500 >= updateInterval())) {
+            m_lastFixTime = point.getTimeMs();
+            m_lastPosition = positionInfo(point);
+            emit positionUpdated(m_lastPosition);
+        }
+    }
+    return true;
+}
+
+// Wheel distance, speed and cadence at time, interpolated along the track
+TrackPoint ReplayPositionSource::sampleAt(qint64 time) {
+    while(m_sampleIndex + 2 < m_points.size() && m_points.timeMs(m_sampleIndex + 1) <= time) {
+        m_sampleIndex++;
+    }
+    int i = m_sampleIndex;
+    qint64 t0 = m_points.timeMs(i);
+    qint64 t1 = m_points.timeMs(i + 1);
+    qreal segment = m_distances.at(i + 1) - m_distances.at(i);
+    qreal f = t1 > t0 ? qBound((qreal)0, (qreal)(time - t0) / (t1 - t0), (qreal)1) : 1;
+
+    TrackPoint sample;
+    sample.setTimeMs(time);
+    sample.setDistance(m_distances.at(i) + f * segment);
+    sample.setGroundSpeed(t1 > t0 ? segment * 1000 / (t1 - t0) : 0);
+    if(m_points.has(i, TrackPoint::HasCadence)) {
+        sample.setCadence(m_points.cadence(i));
+    }
+    return sample;
+}
+
+// Deterministic for a given seed, xorshift32
+quint32 ReplayPositionSource::random() {
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
+
+void ReplayPositionSource::step() {
+    if(!m_running) {
+        return;
+    }
+    qint64 now = trackNow();
+    for(int i=0;i<maxBatch && emitNext(now);i++) {
+    }
+    if(atEnd()) {
+        m_running = false;
+        emit finished();
+        return;
+    }
+    schedule();
+}
+
+void ReplayPositionSource::schedule() {
+    if(m_speed <= 0) {
+        m_timer.start(0);
+        return;
+    }
+    qint64 wait = (qint64)((nextEventTime() - trackNow()) / m_speed);
+    m_timer.start((int)qBound((qint64)0, wait, (qint64)60000));
+}
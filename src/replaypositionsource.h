@@ -0,0 +1,126 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPLAYPOSITIONSOURCE_H
+#define REPLAYPOSITIONSOURCE_H
+
+#include <QGeoPositionInfoSource>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+
+#include "TrackPoint.h"
+#include "TrackPoints.h"
+
+/*
+ * Position source that plays back a recorded track, for testing the
+ * recorder without GPS.
+ *
+ * Fixes come out with their recorded timestamps, thinned to the requested
+ * update interval. Playback runs in real time, N times faster or as fast
+ * as the event loop allows (speed 0), in which case it yields to the event
+ * loop every few hundred fixes so timers still run.
+ *
+ * Optionally the track is also turned into sensor samples: wheel distance
+ * along the track, speed and cadence at a given rate. Their delivery can
+ * be delayed by a random jitter, so they reach the recorder late and out
+ * of order like plugin samples do. Connect sensorSample() to
+ * TrackRecorder::positionUpdated(TrackPoint).
+ *
+ * Setting RENA_REPLAY to a GPX or autosave file makes TrackRecorder use
+ * this source, see fromEnvironment().
+ */
+class ReplayPositionSource : public QGeoPositionInfoSource
+{
+    Q_OBJECT
+public:
+    explicit ReplayPositionSource(QObject *parent = 0);
+
+    // GPX file or autosave journal
+    bool load(const QString &filename);
+    void setPoints(const TrackPoints &points);
+    int pointCount() const;
+    bool atEnd() const;
+    void rewind();
+
+    // 1 is real time, 0 as fast as possible
+    void setSpeed(qreal speed);
+    qreal speed() const;
+    // Sensor samples per second, 0 disables them
+    void setSensorRate(qreal rate);
+    // Sensor samples are delivered 0..msecs late
+    void setSensorJitter(int msecs);
+    void setSeed(quint32 seed);
+
+    // From RENA_REPLAY, RENA_REPLAY_SPEED, RENA_REPLAY_SENSOR_RATE and
+    // RENA_REPLAY_SENSOR_JITTER, 0 when RENA_REPLAY is not set
+    static ReplayPositionSource *fromEnvironment(QObject *parent = 0);
+
+    void setUpdateInterval(int msec);
+    QGeoPositionInfo lastKnownPosition(bool fromSatellitePositioningMethodsOnly = false) const;
+    PositioningMethods supportedPositioningMethods() const;
+    int minimumUpdateInterval() const;
+    Error error() const;
+
+public slots:
+    void startUpdates();
+    void stopUpdates();
+    void requestUpdate(int timeout = 0);
+
+signals:
+    void sensorSample(const TrackPoint &sample);
+    void finished();
+
+private slots:
+    void step();
+    void emitLastKnown();
+
+private:
+    struct PendingSample {
+        qint64 due;         // Delivery time on the track clock
+        TrackPoint sample;
+    };
+    static QGeoPositionInfo positionInfo(const TrackPoint &point);
+    qint64 trackNow() const;
+    qint64 nextEventTime() const;
+    bool emitNext(qint64 until);
+    TrackPoint sampleAt(qint64 time);
+    quint32 random();
+    void schedule();
+
+    TrackPoints m_points;
+    QVector<qreal> m_distances;     // Along the track up to each point
+    int m_next;                     // Next fix to emit
+    qint64 m_lastFixTime;
+    qint64 m_nextSampleTime;
+    int m_sampleIndex;              // Segment of the last generated sample
+    QVector<PendingSample> m_pending;   // Sorted by due
+    qreal m_speed;
+    qreal m_sensorRate;
+    int m_sensorJitter;
+    quint32 m_seed;
+    bool m_running;
+    qint64 m_startTrackTime;        // Track clock when playback (re)started
+    QElapsedTimer m_clock;
+    QTimer m_timer;
+    QGeoPositionInfo m_lastPosition;
+};
+
+#endif // REPLAYPOSITIONSOURCE_H
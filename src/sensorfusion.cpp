@@ -0,0 +1,261 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QGeoCoordinate>
+#include <limits>
+#include "sensorfusion.h"
+
+static const qint64 noTime = std::numeric_limits<qint64>::min() / 2;
+// How long output waits for the other source to catch up
+static const qint64 latency = 2000;
+// Without a fix for this long sensor samples become points of their own
+static const qint64 fixGap = 3000;
+// Sensor values further than this from a fix are not interpolated
+static const qint64 maxSpan = 3000;
+// Expected errors used to pick the distance source of an interval
+static const qreal wheelRelativeError = 0.03;
+static const qreal wheelMinError = 0.5;
+static const qreal defaultAccuracy = 10;
+
+static const int sensorFields[] = {TrackPoint::Distance, TrackPoint::Cadence, TrackPoint::GroundSpeed};
+
+// Index where a point with the given time goes, after equal times
+static int insertIndex(const QVector<TrackPoint> &points, qint64 time) {
+    int index = points.size();
+    while(index > 0 && points.at(index - 1).getTimeMs() > time) {
+        index--;
+    }
+    return index;
+}
+
+SensorFusion::SensorFusion() {
+    clear();
+}
+
+void SensorFusion::clear() {
+    m_fixes.clear();
+    m_samples.clear();
+    m_nextSample = 0;
+    m_latestFix = noTime;
+    m_latestSample = noTime;
+    m_lastFixTime = noTime;
+    m_lastCoordinate = TrackPoint();
+    m_lastWheel = TrackPoint();
+    m_distance = 0;
+    m_reportedDistance = 0;
+}
+
+void SensorFusion::addPosition(const TrackPoint &fix) {
+    if(!fix.hasTime()) {
+        return;
+    }
+    m_fixes.insert(insertIndex(m_fixes, fix.getTimeMs()), fix);
+    m_latestFix = qMax(m_latestFix, fix.getTimeMs());
+}
+
+void SensorFusion::addSensor(const TrackPoint &sample) {
+    if(!sample.hasTime()) {
+        return;
+    }
+    int index = insertIndex(m_samples, sample.getTimeMs());
+    if(index < m_nextSample) {
+        // Older than what was already released, only good for interpolation
+        m_nextSample++;
+    }
+    m_samples.insert(index, sample);
+    m_latestSample = qMax(m_latestSample, sample.getTimeMs());
+}
+
+void SensorFusion::take(QVector<TrackPoint> &fused) {
+    qint64 latest = qMax(m_latestFix, m_latestSample);
+    if(latest == noTime) {
+        return;
+    }
+    if(m_latestSample == noTime || m_latestFix - m_latestSample > maxSpan) {
+        // No sensor to wait for, GPS alone goes out as it comes
+        release(latest, fused);
+        return;
+    }
+    release(latest - latency, fused);
+}
+
+void SensorFusion::flush(QVector<TrackPoint> &fused) {
+    release(std::numeric_limits<qint64>::max(), fused);
+}
+
+qreal SensorFusion::takeDistance() {
+    qreal distance = m_distance - m_reportedDistance;
+    m_reportedDistance = m_distance;
+    return distance;
+}
+
+void SensorFusion::restore(const TrackPoint &point) {
+    if(point.hasCoordinate()) {
+        m_lastFixTime = point.getTimeMs();
+    }
+    if(point.hasDistance()) {
+        // Released already, only there to interpolate the next fixes
+        m_samples.append(point);
+        m_nextSample = m_samples.size();
+        trimSamples(point.getTimeMs());
+    }
+    addDistance(point);
+}
+
+void SensorFusion::release(qint64 until, QVector<TrackPoint> &fused) {
+    for(;;) {
+        bool haveFix = !m_fixes.isEmpty() && m_fixes.first().getTimeMs() <= until;
+        bool haveSample = m_nextSample < m_samples.size() && m_samples.at(m_nextSample).getTimeMs() <= until;
+        if(!haveFix && !haveSample) {
+            break;
+        }
+        qint64 fixTime = m_fixes.isEmpty() ? std::numeric_limits<qint64>::max() : m_fixes.first().getTimeMs();
+        if(haveFix && (!haveSample || fixTime <= m_samples.at(m_nextSample).getTimeMs())) {
+            TrackPoint point = m_fixes.first();
+            m_fixes.remove(0);
+            interpolate(point);
+            m_lastFixTime = fixTime;
+            output(point, fused);
+        } else {
+            const TrackPoint &sample = m_samples.at(m_nextSample);
+            qint64 sampleTime = sample.getTimeMs();
+            m_nextSample++;
+            if(sampleTime - m_lastFixTime > fixGap && fixTime - sampleTime > fixGap) {
+                output(sample, fused);
+            }
+        }
+    }
+    trimSamples(m_fixes.isEmpty() ? until : qMin(until, m_fixes.first().getTimeMs()));
+}
+
+// Drops samples no longer needed to interpolate anything at or after before
+void SensorFusion::trimSamples(qint64 before) {
+    if(before == std::numeric_limits<qint64>::max()) {
+        before = m_latestSample;
+    }
+    int drop = 0;
+    while(drop < m_nextSample && drop + 1 < m_samples.size()
+          && m_samples.at(drop + 1).getTimeMs() < before - maxSpan) {
+        drop++;
+    }
+    if(drop > 0) {
+        m_samples.remove(0, drop);
+        m_nextSample -= drop;
+    }
+}
+
+void SensorFusion::interpolate(TrackPoint &point) const {
+    qint64 time = point.getTimeMs();
+    for(unsigned f=0;f<sizeof(sensorFields)/sizeof(sensorFields[0]);f++) {
+        int field = sensorFields[f];
+        if(point.has(field)) {
+            continue;   // GPS value wins
+        }
+        int before = -1;
+        int after = -1;
+        for(int i=m_samples.size()-1;i>=0;i--) {
+            const TrackPoint &sample = m_samples.at(i);
+            if(!sample.has(field)) {
+                continue;
+            }
+            if(sample.getTimeMs() >= time) {
+                after = i;
+            } else {
+                before = i;
+                break;
+            }
+        }
+        if(before >= 0 && time - m_samples.at(before).getTimeMs() > maxSpan) {
+            before = -1;
+        }
+        if(after >= 0 && m_samples.at(after).getTimeMs() - time > maxSpan) {
+            after = -1;
+        }
+        if(before >= 0 && after >= 0) {
+            const TrackPoint &a = m_samples.at(before);
+            const TrackPoint &b = m_samples.at(after);
+            qreal t = (qreal)(time - a.getTimeMs()) / (b.getTimeMs() - a.getTimeMs());
+            point.setValue(field, a.value(field) + t * (b.value(field) - a.value(field)));
+        } else if(after >= 0 && field != TrackPoint::Distance) {
+            point.setValue(field, m_samples.at(after).value(field));
+        } else if(before >= 0 && field != TrackPoint::Distance) {
+            point.setValue(field, m_samples.at(before).value(field));
+        }
+    }
+}
+
+void SensorFusion::output(const TrackPoint &point, QVector<TrackPoint> &fused) {
+    addDistance(point);
+    fused.append(point);
+}
+
+void SensorFusion::addDistance(const TrackPoint &point) {
+    bool gps = point.hasCoordinate() && m_lastCoordinate.hasCoordinate();
+    bool wheel = point.hasDistance() && m_lastWheel.hasDistance()
+            && point.getDistance() >= m_lastWheel.getDistance();
+    qreal gpsDistance = 0;
+    qreal wheelDistance = 0;
+    if(gps) {
+        QGeoCoordinate from(m_lastCoordinate.getLatitude(), m_lastCoordinate.getLongitude());
+        gpsDistance = from.distanceTo(QGeoCoordinate(point.getLatitude(), point.getLongitude()));
+    }
+    if(wheel) {
+        wheelDistance = point.getDistance() - m_lastWheel.getDistance();
+    }
+
+    if(gps && wheel) {
+        qint64 gpsFrom = m_lastCoordinate.getTimeMs();
+        qint64 wheelFrom = m_lastWheel.getTimeMs();
+        if(wheelFrom > gpsFrom) {
+            // Part of the interval was already counted from sensor only points
+            gps = false;
+        } else if(gpsFrom > wheelFrom) {
+            // and here from fixes without sensor data
+            wheel = false;
+        } else {
+            qreal accuracy = defaultAccuracy;
+            if(point.hasHorizontalAccuracy() && m_lastCoordinate.hasHorizontalAccuracy()) {
+                accuracy = (point.getHorizontalAccuracy() + m_lastCoordinate.getHorizontalAccuracy()) / 2;
+            }
+            qreal wheelError = wheelRelativeError * wheelDistance + wheelMinError;
+            if(qAbs(gpsDistance - wheelDistance) > 3 * accuracy) {
+                // Sensors disagree beyond GPS noise: wheel sensor stalled,
+                // lost or misconfigured
+                wheel = false;
+            } else if(wheelError <= accuracy) {
+                gps = false;
+            } else {
+                wheel = false;
+            }
+        }
+    }
+    if(wheel) {
+        m_distance += wheelDistance;
+    } else if(gps) {
+        m_distance += gpsDistance;
+    }
+
+    if(point.hasCoordinate()) {
+        m_lastCoordinate = point;
+    }
+    if(point.hasDistance()) {
+        m_lastWheel = point;
+    }
+}
@@ -0,0 +1,78 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SENSORFUSION_H
+#define SENSORFUSION_H
+
+#include <QVector>
+
+#include "TrackPoint.h"
+
+/*
+ * Merges GPS fixes and sensor plugin samples into one point stream.
+ *
+ * Both sources are queued in millisecond order. Each GPS fix gets wheel
+ * distance, cadence and speed interpolated from the sensor samples around
+ * it; while there is no GPS the sensor samples become points of their
+ * own. While sensor samples are arriving, output waits until both sources
+ * have moved on by a short latency so late samples can still be used;
+ * fixes alone are passed on right away.
+ *
+ * Travelled distance is accumulated here: for every interval the wheel or
+ * the GPS distance is taken, whichever has the smaller expected error, so
+ * the two are never added up.
+ */
+class SensorFusion
+{
+public:
+    SensorFusion();
+    void clear();
+    void addPosition(const TrackPoint &fix);
+    void addSensor(const TrackPoint &sample);
+    // Appends points that can no longer change to fused
+    void take(QVector<TrackPoint> &fused);
+    // Appends everything still queued, e.g. when recording stops
+    void flush(QVector<TrackPoint> &fused);
+    // Distance accumulated since the previous call in metres
+    qreal takeDistance();
+    // Counts an already fused point, e.g. from the autosave, as if it was
+    // output here so distance goes on from the same source
+    void restore(const TrackPoint &point);
+
+private:
+    void release(qint64 until, QVector<TrackPoint> &fused);
+    void interpolate(TrackPoint &point) const;
+    void output(const TrackPoint &point, QVector<TrackPoint> &fused);
+    void addDistance(const TrackPoint &point);
+    void trimSamples(qint64 before);
+
+    QVector<TrackPoint> m_fixes;        // Not yet released
+    QVector<TrackPoint> m_samples;      // Kept around for interpolation
+    int m_nextSample;                   // First sample not yet released
+    qint64 m_latestFix;
+    qint64 m_latestSample;
+    qint64 m_lastFixTime;               // Of the last released fix
+    TrackPoint m_lastCoordinate;        // Last output point with a coordinate
+    TrackPoint m_lastWheel;             // Last output point with wheel distance
+    qreal m_distance;
+    qreal m_reportedDistance;
+};
+
+#endif // SENSORFUSION_H
@@ -34,3 +34,21 @@ void Settings::setUpdateInterval(int updateInterval) {
     m_settings->setValue("positioning/updateInterval", updateInterval);
     emit updateIntervalChanged();
 }
+
+bool Settings::smoothTrack() const {
+    return m_settings->value("positioning/smoothTrack", false).toBool();
+}
+
+void Settings::setSmoothTrack(bool smoothTrack) {
+    m_settings->setValue("positioning/smoothTrack", smoothTrack);
+    emit smoothTrackChanged();
+}
+
+bool Settings::adaptiveSampling() const {
+    return m_settings->value("positioning/adaptiveSampling", false).toBool();
+}
+
+void Settings::setAdaptiveSampling(bool adaptiveSampling) {
+    m_settings->setValue("positioning/adaptiveSampling", adaptiveSampling);
+    emit adaptiveSamplingChanged();
+}
@@ -29,13 +29,23 @@ class Settings : public QObject
     Q_OBJECT
     Q_PROPERTY(int updateInterval READ updateInterval
                WRITE setUpdateInterval NOTIFY updateIntervalChanged)
+    Q_PROPERTY(bool smoothTrack READ smoothTrack
+               WRITE setSmoothTrack NOTIFY smoothTrackChanged)
+    Q_PROPERTY(bool adaptiveSampling READ adaptiveSampling
+               WRITE setAdaptiveSampling NOTIFY adaptiveSamplingChanged)
 public:
     explicit Settings(QObject *parent = 0);
     int updateInterval() const;
     void setUpdateInterval(int updateInterval);
+    bool smoothTrack() const;
+    void setSmoothTrack(bool smoothTrack);
+    bool adaptiveSampling() const;
+    void setAdaptiveSampling(bool adaptiveSampling);
 
 signals:
     void updateIntervalChanged();
+    void smoothTrackChanged();
+    void adaptiveSamplingChanged();
 
 public slots:
 
@@ -0,0 +1,116 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tcxwriter.h"
+#include "trackstatistics.h"
+
+TcxWriter::TcxWriter(QIODevice *device) :
+    TrackWriter(device)
+{
+}
+
+bool TcxWriter::write(TrackPointIterator &points, const QString &name, const QString &description) {
+    TrackStatistics statistics;
+    qint64 startMs = -1;
+    TrackPointIterator summary(points);
+    while(summary.next()) {
+        if(startMs < 0 && summary.has(TrackPoint::HasTime)) {
+            startMs = summary.timeMs();
+        }
+        statistics.add(summary.point());
+    }
+    if(startMs < 0) {
+        startMs = 0;
+    }
+
+    begin();
+    append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+           "<TrainingCenterDatabase xmlns=\"http://www.garmin.com/xmlschemas/TrainingCenterDatabase/v2\">\n"
+           "    <Activities>\n"
+           "        <Activity Sport=\"Other\">\n"
+           "            <Id>");
+    writeTime(startMs);
+    append("</Id>\n"
+           "            <Lap StartTime=\"");
+    writeTime(startMs);
+    append("\">\n"
+           "                <TotalTimeSeconds>");
+    writeNumber(statistics.elapsedMs() / 1000.0);
+    append("</TotalTimeSeconds>\n"
+           "                <DistanceMeters>");
+    writeNumber(statistics.distance());
+    append("</DistanceMeters>\n");
+    if(statistics.maxSpeed() > 0) {
+        append("                <MaximumSpeed>");
+        writeNumber(statistics.maxSpeed());
+        append("</MaximumSpeed>\n");
+    }
+    append("                <Calories>0</Calories>\n"
+           "                <Intensity>Active</Intensity>\n"
+           "                <TriggerMethod>Manual</TriggerMethod>\n"
+           "                <Track>\n");
+
+    while(!m_error && points.next()) {
+        quint16 flags = points.flags();
+        append("                    <Trackpoint>\n"
+               "                        <Time>");
+        writeTime(flags & TrackPoint::HasTime ? points.timeMs() : startMs);
+        append("</Time>\n");
+        if(flags & TrackPoint::HasCoordinate) {
+            append("                        <Position>\n"
+                   "                            <LatitudeDegrees>");
+            writeNumber(points.latitude());
+            append("</LatitudeDegrees>\n"
+                   "                            <LongitudeDegrees>");
+            writeNumber(points.longitude());
+            append("</LongitudeDegrees>\n"
+                   "                        </Position>\n");
+        }
+        if(flags & TrackPoint::HasElevation) {
+            append("                        <AltitudeMeters>");
+            writeNumber(points.elevation());
+            append("</AltitudeMeters>\n");
+        }
+        if(flags & TrackPoint::HasDistance) {
+            append("                        <DistanceMeters>");
+            writeNumber(points.distance());
+            append("</DistanceMeters>\n");
+        }
+        // TCX cadence is a whole number of rpm up to 254
+        if(flags & TrackPoint::HasCadence) {
+            append("                        <Cadence>");
+            writeInteger(qBound(0, qRound(points.cadence()), 254));
+            append("</Cadence>\n");
+        }
+        append("                    </Trackpoint>\n");
+    }
+
+    append("                </Track>\n"
+           "            </Lap>\n");
+    if(!name.isEmpty() || !description.isEmpty()) {
+        append("            <Notes>");
+        writeEscaped(description.isEmpty() ? name : name.isEmpty() ? description : name + "\n" + description);
+        append("</Notes>\n");
+    }
+    append("        </Activity>\n"
+           "    </Activities>\n"
+           "</TrainingCenterDatabase>\n");
+    return end();
+}
@@ -0,0 +1,39 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TCXWRITER_H
+#define TCXWRITER_H
+
+#include "trackwriter.h"
+
+/*
+ * Writes a track as a Garmin Training Center (TCX v2) activity with one
+ * lap. The lap totals come before the points in TCX, they are gathered
+ * with a first pass over a copy of the iterator.
+ */
+class TcxWriter : public TrackWriter
+{
+public:
+    explicit TcxWriter(QIODevice *device);
+    using TrackWriter::write;
+    bool write(TrackPointIterator &points, const QString &name, const QString &description);
+};
+
+#endif // TCXWRITER_H
@@ -19,23 +19,109 @@
  */
 
 #include <QStandardPaths>
-#include <QFile>
 #include <QGeoCoordinate>
 #include <QDebug>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QtConcurrent>
 #include <qmath.h>
 #include "trackloader.h"
+#include "gpxparser.h"
+
+// Shared by the GUI thread and the parsing thread. stopLoading() waits for
+// the parser before deleting it, so the loader always outlives it.
+class TrackLoadJob : public GpxProgress
+{
+public:
+    // Without a loader the points are only summarised, for synchronous loading
+    TrackLoadJob(TrackLoader *loader, const QString &filename) :
+        loader(loader), filename(filename), fastPath(false), counted(0),
+        published(0), fraction(0), notified(false)
+    {
+    }
+
+    // Parsing thread: summarise the new points while they are still in
+    // cache and queue the ones not handed over yet
+    bool update(const GpxTrack &track, qreal fraction) {
+        if(cancelled.loadAcquire()) {
+            return false;
+        }
+        if(track.points.size() < counted) {
+            // Fast path gave up, the reader started over
+            statistics.clear();
+            bounds.clear();
+            counted = 0;
+        }
+        for(int i=counted;i<track.points.size();i++) {
+            TrackPoint point = track.points.at(i);
+            statistics.add(point);
+            if(point.hasCoordinate()) {
+                bounds.add(point.getLatitude(), point.getLongitude());
+            }
+        }
+        counted = track.points.size();
+        if(!loader) {
+            return true;
+        }
+
+        QMutexLocker locker(&mutex);
+        for(int i=published;i<track.points.size();i++) {
+            pending.append(track.points.at(i));
+        }
+        published = qMax(published, track.points.size());
+        this->fraction = fraction;
+        if(!notified) {
+            notified = true;
+            QMetaObject::invokeMethod(loader, "takeChunk", Qt::QueuedConnection);
+        }
+        return true;
+    }
+
+    TrackLoader *loader;
+    QString filename;
+    QAtomicInt cancelled;
+    // Owned by the parsing thread until finished
+    GpxTrack track;
+    bool fastPath;
+    TrackStatistics statistics;
+    TrackBounds bounds;
+    int counted;
+    int published;
+    QMutex mutex;           // Guards the members below
+    TrackPoints pending;
+    qreal fraction;
+    bool notified;          // takeChunk() is queued
+};
+
+static GpxParser::Result parseTrack(TrackLoadJob *job) {
+    GpxParser::Result result = GpxParser::parseFile(job->filename, job->track, &job->fastPath, job);
+    if(result == GpxParser::Ok) {
+        // Points after the last full chunk
+        job->update(job->track, 1);
+    }
+    return result;
+}
 
 TrackLoader::TrackLoader(QObject *parent) :
     QObject(parent)
 {
     m_loaded = false;
     m_error = false;
+    m_cancelled = false;
     m_name = "";
     m_speed = 0;
     m_maxSpeed = 0;
     m_pace = 0;
     m_duration = 0;
     m_distance = 0;
+    m_asynchronous = false;
+    m_progress = 0;
+    m_job = 0;
+    connect(&m_loadWatcher, SIGNAL(finished()), SLOT(loadingFinished()));
+}
+
+TrackLoader::~TrackLoader() {
+    stopLoading();
 }
 
 void TrackLoader::load() {
@@ -46,127 +132,149 @@ void TrackLoader::load() {
     }
     QString dirName = QStandardPaths::writableLocation(QStandardPaths::HomeLocation) + "/Rena";
     QString fullFilename = dirName + "/" + m_filename;
-    QFile file(fullFilename);
 
-    if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qDebug()<<"Error opening"<<fullFilename;
-        m_error = true;
+    if(m_asynchronous) {
+        if(!m_job) {
+            startLoading(fullFilename);
+        }
         return;
     }
-    QXmlStreamReader xml(&file);
-    if(!xml.readNextStartElement()) {
-        qDebug()<<m_filename<<"is not xml file?";
+
+    TrackLoadJob job(0, fullFilename);
+    if(parseTrack(&job) != GpxParser::Ok) {
+        qDebug()<<m_filename<<"is not gpx 1.1 file";
         m_error = true;
         return;
     }
-    if( !(xml.name() == "gpx" && xml.attributes().value("version") == "1.1") ) {
+    qDebug()<<"Loaded"<<job.track.points.size()<<"points from"<<m_filename
+            <<(job.fastPath ? "(fast path)" : "(xml reader)");
+    m_simplifier.clear();
+    setTrack(job);
+}
+
+void TrackLoader::startLoading(const QString &fullFilename) {
+    m_points.clear();
+    m_bounds.clear();
+    m_simplifier.clear();
+    m_progress = 0;
+    emit progressChanged();
+
+    m_job = new TrackLoadJob(this, fullFilename);
+    m_loadWatcher.setFuture(QtConcurrent::run(parseTrack, m_job));
+    emit loadingChanged();
+}
+
+void TrackLoader::stopLoading() {
+    if(!m_job) {
+        return;
+    }
+    // The parser checks the flag every chunk, the wait is short
+    m_job->cancelled.storeRelease(1);
+    m_loadWatcher.waitForFinished();
+    delete m_job;
+    m_job = 0;
+    emit loadingChanged();
+}
+
+void TrackLoader::takeChunk() {
+    if(!m_job) {
+        return;
+    }
+    TrackPoints chunk;
+    {
+        QMutexLocker locker(&m_job->mutex);
+        chunk = m_job->pending;
+        m_job->pending.clear();
+        m_job->notified = false;
+        m_progress = m_job->fraction;
+    }
+    emit progressChanged();
+    if(chunk.isEmpty()) {
+        return;
+    }
+
+    int from = m_points.size();
+    for(int i=0;i<chunk.size();i++) {
+        m_points.append(chunk.at(i));
+    }
+    addBounds(from);
+    emit pointsAdded(from, chunk.size());
+}
+
+void TrackLoader::loadingFinished() {
+    // finished() of a stopped job can still be queued when the next starts
+    if(!m_job || !m_loadWatcher.isFinished()) {
+        return;
+    }
+    takeChunk();
+    TrackLoadJob *job = m_job;
+    m_job = 0;
+
+    if(m_loadWatcher.result() != GpxParser::Ok) {
         qDebug()<<m_filename<<"is not gpx 1.1 file";
         m_error = true;
-        return;
+    } else {
+        qDebug()<<"Loaded"<<job->track.points.size()<<"points from"<<m_filename
+                <<(job->fastPath ? "(fast path)" : "(xml reader)")<<"in the background";
+        // Same points as the chunks, taking the parser's copy frees the
+        // duplicate. Only a fast path retry can make them differ.
+        if(job->track.points.size() != m_points.size()) {
+            m_simplifier.clear();
+        }
+        setTrack(*job);
     }
+    delete job;
+    emit loadingChanged();
+}
 
+void TrackLoader::setTrack(const TrackLoadJob &job) {
     // Loading considered succeeded at this point
     m_loaded = true;
     emit loadedChanged();
 
-    while(xml.readNextStartElement()) {
-        if(xml.name() == "metadata") {
-            while(xml.readNextStartElement()) {
-                if(xml.name() == "name") {
-                    m_name = xml.readElementText();
-                    emit nameChanged();
-                } else if(xml.name() == "desc") {
-                    m_description = xml.readElementText();
-                    emit descriptionChanged();
-                } else {
-                    xml.skipCurrentElement();
-                }
-            }
-        } else if(xml.name() == "trk") {
-            while(xml.readNextStartElement()) {
-                if(xml.name() == "trkseg") {
-                    while(xml.readNextStartElement()) {
-                        if(xml.name() == "trkpt") {
-                            TrackPoint point;
-                            point.setLatitude(xml.attributes().value("lat").toDouble());
-                            point.setLongitude(xml.attributes().value("lon").toDouble());
-                            while(xml.readNextStartElement()) {
-                                if(xml.name() == "time") {
-                                    point.setTime(QDateTime::fromString(xml.readElementText(),Qt::ISODate));
-                                } else if(xml.name() == "ele") {
-                                    point.setElevation(xml.readElementText().toDouble());
-                                } else if(xml.name() == "extensions") {
-                                    while(xml.readNextStartElement()) {
-                                        if(xml.name() == "dir") {
-                                            point.setDirection(xml.readElementText().toDouble());
-                                        } else if(xml.name() == "g_spd") {
-                                            point.setGroundSpeed(xml.readElementText().toDouble());
-                                        } else if(xml.name() == "v_spd") {
-                                            point.setVerticalSpeed(xml.readElementText().toDouble());
-                                        } else if(xml.name() == "m_var") {
-                                            point.setMagneticVariation(xml.readElementText().toDouble());
-                                        } else if(xml.name() == "h_acc") {
-                                            point.setHorizontalAccuracy(xml.readElementText().toDouble());
-                                        } else if(xml.name() == "v_acc") {
-                                            point.setVerticalAccuracy(xml.readElementText().toDouble());
-                                        } else if(xml.name() == "distance") {
-                                            point.setDistance(xml.readElementText().toDouble());
-                                        } else if(xml.name() == "cadence") {
-                                            point.setCadence(xml.readElementText().toDouble());
-                                        }
-                                    }
-                                }
-                            }
-                            m_points.append(point);
-                        }
-                    }
-                }
-            }
-        } else {
-            xml.skipCurrentElement();
-        }
+    m_points = job.track.points;
+    m_statistics = job.statistics;
+    m_bounds = job.bounds;
+    m_name = job.track.name;
+    emit nameChanged();
+    m_description = job.track.description;
+    emit descriptionChanged();
+    m_progress = 1;
+    emit progressChanged();
+
+    if(m_points.size() > 0) {
+        m_time = m_points.time(0).toLocalTime();
+        emit timeChanged();
     }
-
     if(m_points.size() > 1) {
-        QDateTime firstTime(m_points.at(0).time);
-        QDateTime secondTime(m_points.at(m_points.size()-1).time);
-        m_duration = firstTime.secsTo(secondTime);
+        m_duration = m_statistics.elapsedMs() / 1000;
         emit durationChanged();
-        m_time = firstTime.toLocalTime();
-        emit timeChanged();
-        m_distance = 0;
-        for(int i=1;i<m_points.size();i++) {
-			TrackPoint *p1 = &m_points[i-1];
-			TrackPoint *p2 = &m_points[i];
-			if (p1->hasCoordinate() && p2->hasCoordinate()) {
-				QGeoCoordinate coord1(p1->getLatitude(), p1->getLongitude());
-				QGeoCoordinate coord2(p2->getLatitude(), p2->getLongitude());
-				m_distance += coord1.distanceTo(coord2);
-			} else if (p1->hasDistance() && p2->hasDistance()) {
-				m_distance += p2->getDistance() - p1->getDistance();
-			}
-            if(m_points.at(i).hasGroundSpeed() && m_points.at(i).getGroundSpeed() > m_maxSpeed) {
-                m_maxSpeed = m_points.at(i).getGroundSpeed();
-            }
-        }
+        m_distance = m_statistics.distance();
         emit distanceChanged();
+        m_maxSpeed = m_statistics.maxSpeed();
         emit maxSpeedChanged();
-        m_speed = m_distance / m_duration;
+        m_speed = m_statistics.averageSpeed();
         emit speedChanged();
-        m_pace = m_duration / m_distance * 1000 / 60;
+        m_pace = m_statistics.pace();
         emit paceChanged();
     } else {
         qDebug()<<"Not enough trackpoints to calculate duration, distance and speed";
-        if(m_points.size() > 0) {
-            QDateTime firstTime(m_points.at(0).time);
-            m_time = firstTime.toLocalTime();
-            emit timeChanged();
-        }
     }
-
+    emit statisticsChanged();
     emit trackChanged();
 }
 
+void TrackLoader::addBounds(int from) {
+    const qreal *lat = m_points.column(TrackPoint::Latitude);
+    const qreal *lon = m_points.column(TrackPoint::Longitude);
+    const quint16 *flags = m_points.flagsData();
+    for(int i=from;i<m_points.size();i++) {
+        if(flags[i] & TrackPoint::HasCoordinate) {
+            m_bounds.add(lat[i], lon[i]);
+        }
+    }
+}
+
 QString TrackLoader::filename() const {
     return m_filename;
 }
@@ -174,14 +282,23 @@ QString TrackLoader::filename() const {
 void TrackLoader::setFilename(QString filename) {
     if((m_filename == filename)) {
         qDebug()<<"No change in filename";
+        if(m_cancelled) {
+            // Same track shown again, parse it from the start
+            m_cancelled = false;
+            m_error = false;
+            load();
+        }
         return;
     }
     qDebug()<<"Setting filename"<<filename;
     m_filename = filename;
     emit filenameChanged();
+    stopLoading();
+    m_statistics.clear();
     // Trigger loading
     m_loaded = false;
     m_error = false;
+    m_cancelled = false;
     load();
 }
 
@@ -251,10 +368,13 @@ QString TrackLoader::durationStr() {
         // Nothing to load or error in loading
         return QString();
     }
+    return formatDuration(m_duration);
+}
 
-    uint hours = m_duration / (60*60);
-    uint minutes = (m_duration - hours*60*60) / 60;
-    uint seconds = m_duration - hours*60*60 - minutes*60;
+QString TrackLoader::formatDuration(int seconds) const {
+    int hours = seconds / (60*60);
+    int minutes = (seconds - hours*60*60) / 60;
+    seconds = seconds - hours*60*60 - minutes*60;
     if(hours == 0) {
         if(minutes == 0) {
             return QString("%3s").arg(seconds);
@@ -313,10 +433,126 @@ qreal TrackLoader::pace() {
     return m_pace;
 }
 
+// The statistics stay cleared until a load succeeds
+int TrackLoader::movingTime() {
+    if(!m_loaded && !m_error) {
+        load();
+    }
+    return m_statistics.movingMs() / 1000;
+}
+
+qreal TrackLoader::movingSpeed() {
+    if(!m_loaded && !m_error) {
+        load();
+    }
+    return m_statistics.movingSpeed();
+}
+
+qreal TrackLoader::ascent() {
+    if(!m_loaded && !m_error) {
+        load();
+    }
+    return m_statistics.ascent();
+}
+
+qreal TrackLoader::descent() {
+    if(!m_loaded && !m_error) {
+        load();
+    }
+    return m_statistics.descent();
+}
+
+qreal TrackLoader::averageCadence() {
+    if(!m_loaded && !m_error) {
+        load();
+    }
+    return m_statistics.averageCadence();
+}
+
+qreal TrackLoader::maxCadence() {
+    if(!m_loaded && !m_error) {
+        load();
+    }
+    return m_statistics.maxCadence();
+}
+
+static QVariantList splitSeconds(const QVector<qint64> &splits) {
+    QVariantList seconds;
+    for(int i=0;i<splits.size();i++) {
+        seconds.append(splits.at(i) / 1000.0);
+    }
+    return seconds;
+}
+
+QVariantList TrackLoader::kmSplits() {
+    if(!m_loaded && !m_error) {
+        load();
+    }
+    return splitSeconds(m_statistics.kmSplits());
+}
+
+QVariantList TrackLoader::mileSplits() {
+    if(!m_loaded && !m_error) {
+        load();
+    }
+    return splitSeconds(m_statistics.mileSplits());
+}
+
+int TrackLoader::best1km() {
+    if(!m_loaded && !m_error) {
+        load();
+    }
+    qint64 best = m_statistics.best1km();
+    return best < 0 ? -1 : best / 1000;
+}
+
+int TrackLoader::best5km() {
+    if(!m_loaded && !m_error) {
+        load();
+    }
+    qint64 best = m_statistics.best5km();
+    return best < 0 ? -1 : best / 1000;
+}
+
+const TrackStatistics &TrackLoader::statistics() const {
+    return m_statistics;
+}
+
 bool TrackLoader::loaded() {
     return m_loaded;
 }
 
+bool TrackLoader::asynchronous() const {
+    return m_asynchronous;
+}
+
+void TrackLoader::setAsynchronous(bool asynchronous) {
+    if(m_asynchronous == asynchronous) {
+        return;
+    }
+    m_asynchronous = asynchronous;
+    emit asynchronousChanged();
+}
+
+bool TrackLoader::loading() const {
+    return m_job != 0;
+}
+
+qreal TrackLoader::progress() const {
+    return m_progress;
+}
+
+void TrackLoader::cancel() {
+    if(!m_job) {
+        return;
+    }
+    qDebug()<<"Loading"<<m_filename<<"cancelled";
+    stopLoading();
+    // Not retried until the filename is set again
+    m_error = true;
+    m_cancelled = true;
+}
+
 int TrackLoader::trackPointCount() {
     if(!m_loaded && !m_error) {
         load();
@@ -330,14 +566,13 @@ int TrackLoader::trackPointCount() {
 
 QGeoCoordinate TrackLoader::trackPointAt(int index) {
     if(index < m_points.size()) {
-		TrackPoint p = m_points.at(index);
 		QGeoCoordinate coord;
-		if (p.hasCoordinate()) {
-			coord.setLatitude(p.getLatitude());
-			coord.setLongitude(p.getLongitude());
+		if (m_points.hasCoordinate(index)) {
+			coord.setLatitude(m_points.latitude(index));
+			coord.setLongitude(m_points.longitude(index));
 		}
-		if (p.hasElevation()) {
-			coord.setAltitude(p.getElevation());
+		if (m_points.has(index, TrackPoint::HasElevation)) {
+			coord.setAltitude(m_points.elevation(index));
 		}
         return coord;
     } else {
@@ -349,57 +584,39 @@ TrackPoint TrackLoader::trackPointAt2(int index) {
 	return m_points.at(index);
 }
 
+QVariantList TrackLoader::simplifiedPath(qreal zoomLevel) {
+    if(!m_loaded && !m_error) {
+        load();
+    }
+    // Built on first use, uploaders never draw the track
+    m_simplifier.update(m_points, m_simplifier.pointCount());
+    return m_simplifier.path(zoomLevel);
+}
+
 QDateTime TrackLoader::trackPointTimeAt(int index) {
-	return m_points.at(index).time;
+	return m_points.time(index);
+}
+
+const TrackPoints &TrackLoader::points() const {
+	return m_points;
 }
 
 int TrackLoader::fitZoomLevel(int width, int height) {
-    if(m_points.size() < 2 || width < 1 || height < 1) {
-        // One point track or zero size map
+    if(m_points.size() < 2) {
+        // One point track
         return 20;
     }
-    qreal minLat, maxLat, minLon, maxLon;
-    minLat = maxLat = minLon = maxLon = nanf(""); //nan
-    for(int i=1;i<m_points.size();i++) {
-		if (m_points.at(i).hasCoordinate()) {
-			if(minLat != minLat || m_points.at(i).getLatitude() < minLat) {
-				minLat = m_points.at(i).getLatitude();
-			} else if(maxLat != maxLat || m_points.at(i).getLatitude() > maxLat) {
-				maxLat = m_points.at(i).getLatitude();
-			}
-			if(minLon != minLon || m_points.at(i).getLongitude() < minLon) {
-				minLon = m_points.at(i).getLongitude();
-			} else if(maxLon != maxLon || m_points.at(i).getLongitude() > maxLon) {
-				maxLon = m_points.at(i).getLongitude();
-			}
-		}
-    }
-
-    m_center = QGeoCoordinate((minLat+maxLat)/2, (minLon+maxLon)/2);
-    qreal coord, pixel;
-    qreal trackMinX = (minLon + 180) / 360;
-    qreal trackMaxX = (maxLon + 180) / 360;
-    qreal trackMinY = sqrt(1-qLn(minLat*M_PI/180 + 1/qCos(minLat*M_PI/180))/M_PI);
-    qreal trackMaxY = sqrt(1-qLn(maxLat*M_PI/180 + 1/qCos(maxLat*M_PI/180))/M_PI);
+    return m_bounds.fitZoomLevel(width, height);
+}
 
-    qreal trackAR = qAbs((trackMaxX - trackMinX) / (trackMaxY - trackMinY));
-    qreal windowAR = (qreal)width/(qreal)height;
-    if(trackAR > windowAR ) {
-        // Width limits
-        coord = qAbs(trackMaxX - trackMinX);
-        pixel = width;
-    } else {
-        // height limits
-        coord = qAbs(trackMaxY - trackMinY);
-        pixel = height;
-    }
+const TrackBounds &TrackLoader::bounds() const {
+    return m_bounds;
+}
 
-    // log2(x) = ln(x)/ln(2)
-    int z = qFloor(qLn(pixel/256.0 * 1.0/coord * qCos(m_center.latitude()*M_PI/180))
-                   / qLn(2)) + 1;
-    return z;
+QGeoCoordinate TrackLoader::center() const {
+    return m_bounds.center();
 }
 
-QGeoCoordinate TrackLoader::center() {
-    return m_center;
+QGeoCoordinate TrackLoader::centroid() const {
+    return m_bounds.centroid();
 }
@@ -24,10 +24,29 @@
 #include <QObject>
 #include <QDateTime>
 #include <QGeoCoordinate>
-#include <QXmlStreamReader>
+#include <QVariantList>
+#include <QFutureWatcher>
+
+#include "gpxparser.h"
 
 #include "TrackPoint.h"
+#include "TrackPoints.h"
+#include "TrackBounds.h"
+#include "pathsimplifier.h"
+#include "trackstatistics.h"
+
+class TrackLoadJob;
 
+/*
+ * Loads a GPX track from $HOME/Rena and computes its summary.
+ *
+ * By default loading happens synchronously the first time anything is
+ * asked for. With asynchronous set, the file is parsed on a worker thread:
+ * points arrive in chunks through pointsAdded() while progress grows, and
+ * the summary properties and trackChanged() follow when the whole file is
+ * read. cancel() or a new filename stops a load in flight, setting the
+ * same filename again after cancel() starts the parse over.
+ */
 class TrackLoader : public QObject
 {
     Q_OBJECT
@@ -42,10 +61,26 @@ class TrackLoader : public QObject
     Q_PROPERTY(qreal speed READ speed NOTIFY speedChanged)
     Q_PROPERTY(qreal maxSpeed READ maxSpeed NOTIFY maxSpeedChanged)
     Q_PROPERTY(qreal pace READ pace NOTIFY paceChanged)
+    Q_PROPERTY(int movingTime READ movingTime NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal movingSpeed READ movingSpeed NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal ascent READ ascent NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal descent READ descent NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal averageCadence READ averageCadence NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal maxCadence READ maxCadence NOTIFY statisticsChanged)
+    Q_PROPERTY(QVariantList kmSplits READ kmSplits NOTIFY statisticsChanged)
+    Q_PROPERTY(QVariantList mileSplits READ mileSplits NOTIFY statisticsChanged)
+    Q_PROPERTY(int best1km READ best1km NOTIFY statisticsChanged)
+    Q_PROPERTY(int best5km READ best5km NOTIFY statisticsChanged)
     Q_PROPERTY(bool loaded READ loaded NOTIFY loadedChanged)
+    Q_PROPERTY(bool asynchronous READ asynchronous WRITE setAsynchronous NOTIFY asynchronousChanged)
+    Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
+    Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(QGeoCoordinate center READ center NOTIFY trackChanged)
+    Q_PROPERTY(QGeoCoordinate centroid READ centroid NOTIFY trackChanged)
 
 public:
     explicit TrackLoader(QObject *parent = 0);
+    ~TrackLoader();
     QString filename() const;
     void setFilename(QString filename);
     QString name();
@@ -58,15 +93,37 @@ public:
     qreal speed();
     qreal maxSpeed();
     qreal pace();
+    // Seconds, best efforts are -1 until the distance has been covered
+    int movingTime();
+    qreal movingSpeed();
+    qreal ascent();
+    qreal descent();
+    qreal averageCadence();
+    qreal maxCadence();
+    QVariantList kmSplits();
+    QVariantList mileSplits();
+    int best1km();
+    int best5km();
+    const TrackStatistics &statistics() const;
+    Q_INVOKABLE QString formatDuration(int seconds) const;
     bool loaded();
+    bool asynchronous() const;
+    void setAsynchronous(bool asynchronous);
+    bool loading() const;
+    qreal progress() const;
+    Q_INVOKABLE void cancel();
     Q_INVOKABLE int trackPointCount();
     Q_INVOKABLE QGeoCoordinate trackPointAt(int index);
     Q_INVOKABLE TrackPoint trackPointAt2(int index);
+    Q_INVOKABLE QVariantList simplifiedPath(qreal zoomLevel);
     QDateTime trackPointTimeAt(int index);
+    const TrackPoints &points() const;
+    const TrackBounds &bounds() const;
+    QGeoCoordinate center() const;
+    QGeoCoordinate centroid() const;
 
     // Temporary "hacks" to get around misbehaving Map.fitViewportToMapItems()
     Q_INVOKABLE int fitZoomLevel(int width, int height);
-    Q_INVOKABLE QGeoCoordinate center();
 
 signals:
     void filenameChanged();
@@ -78,18 +135,33 @@ signals:
     void speedChanged();
     void maxSpeedChanged();
     void paceChanged();
+    void statisticsChanged();
     void loadedChanged();
     void trackChanged();
+    void asynchronousChanged();
+    void loadingChanged();
+    void progressChanged();
+    // Asynchronous loading only: points [from, from+count) were parsed
+    void pointsAdded(int from, int count);
 
 public slots:
 
+private slots:
+    void takeChunk();
+    void loadingFinished();
+
 private:
 
     void load();
+    void startLoading(const QString &fullFilename);
+    void stopLoading();
+    void setTrack(const TrackLoadJob &job);
+    void addBounds(int from);
 
-    QList<TrackPoint> m_points;
+    TrackPoints m_points;
     bool m_loaded;
     bool m_error;
+    bool m_cancelled;   // m_error set by cancel(), not by the file
     QString m_filename;
     QString m_name;
     QString m_description;
@@ -99,7 +171,13 @@ private:
     qreal m_speed;
     qreal m_maxSpeed;
     qreal m_pace;
-    QGeoCoordinate m_center;
+    TrackBounds m_bounds;
+    TrackStatistics m_statistics;
+    PathSimplifier m_simplifier;
+    bool m_asynchronous;
+    qreal m_progress;
+    TrackLoadJob *m_job;
+    QFutureWatcher<GpxParser::Result> m_loadWatcher;
 };
 
 #endif // TRACKLOADER_H
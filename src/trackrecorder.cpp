@@ -21,11 +21,86 @@
 #include <QStandardPaths>
 #include <QDir>
 #include <QSaveFile>
-#include <QXmlStreamWriter>
 #include <QDebug>
+#include <QtConcurrent>
 #include <qmath.h>
 #include <iterator>
+#include <unistd.h>
 #include "trackrecorder.h"
+#include "autosavejournal.h"
+#include "tracksummarycache.h"
+#include "gpxwriter.h"
+#include "TrackPointIterator.h"
+#include "isotime.h"
+#include "replaypositionsource.h"
+
+// One track on its way to a GPX file
+class TrackExportJob
+{
+public:
+    TrackPoints points;     // Snapshot, shares the data with the recorder
+    QString name;
+    QString description;
+    QString filename;       // Relative to $HOME/Rena
+    QString path;
+    QString journal;        // Autosave of the track, kept until it is written
+    TrackSummary summary;   // For the index, filled in by the worker
+};
+
+static QString trackFilename(const TrackPoints &points, const QString &name) {
+    if(!name.isEmpty()) {
+        return points.time(0).toString(Qt::ISODate)
+                + " - " + name + ".gpx";
+    }
+    return points.time(0).toString(Qt::ISODate)
+            + ".gpx";
+}
+
+// Summary as TrackLoader computes it from the saved file, so the index
+// does not change when history rebuilds it
+static void summarizeTrack(TrackExportJob *job) {
+    TrackStatistics statistics;
+    TrackPointIterator it(job->points);
+    while(it.next()) {
+        statistics.add(it.point());
+    }
+    TrackSummary &summary = job->summary;
+    summary.name = job->name;
+    summary.time = job->points.time(0).toLocalTime();
+    summary.duration = 0;
+    summary.distance = 0;
+    summary.speed = 0;
+    if(job->points.size() > 1) {
+        summary.duration = statistics.elapsedMs() / 1000;
+        summary.distance = statistics.distance();
+        summary.speed = statistics.averageSpeed();
+    }
+}
+
+// Runs on a worker thread, touches nothing but the job
+static bool writeTrack(TrackExportJob *job) {
+    QSaveFile file(job->path);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qDebug()<<"File opening failed, aborting"<<file.errorString();
+        return false;
+    }
+
+    GpxWriter writer(&file);
+    if(!writer.write(job->points, job->name, job->description)) {
+        file.cancelWriting();
+    } else if(!file.flush() || ::fsync(file.handle()) != 0) {
+        qDebug()<<"Syncing"<<job->filename<<"failed";
+        file.cancelWriting();
+    }
+
+    if(!file.commit()) {
+        qDebug()<<"Error in writing to a file";
+        qDebug()<<file.errorString();
+        return false;
+    }
+    summarizeTrack(job);
+    return true;
+}
 
 TrackRecorder::TrackRecorder(QObject *parent) :
     QObject(parent)
@@ -36,28 +111,43 @@ TrackRecorder::TrackRecorder(QObject *parent) :
     m_tracking = false;
     m_isEmpty = true;
     m_applicationActive = true;
-    m_autoSavePosition = 0;
-    last_position_time = 0;
-    last_distance_time = 0;
+    m_autoSaveIndex = 0;
+    m_simplifiedIndex = 0;
+    m_smoothTrack = false;
+    m_updateInterval = 1000;
+    m_effectiveInterval = 1000;
+    m_adaptiveSampling = false;
+    m_changes = 0;
+
+    // Fixes and sensor packets arrive several times a second, QML gets
+    // one batch of change signals per frame or per second in background
+    m_notifyTimer.setSingleShot(true);
+    connect(&m_notifyTimer, SIGNAL(timeout()), this, SLOT(emitChanges()));
+
+    // Sensor plugins queue samples in their own threads, collect them
+    // a few times a second while tracking
+    m_sensorTimer.setInterval(500);
+    connect(&m_sensorTimer, SIGNAL(timeout()), this, SLOT(takeSensorSamples()));
+
+    connect(&m_exportWatcher, SIGNAL(finished()), this, SLOT(exportingFinished()));
 
     // Load autosaved track if left from previous session
     loadAutoSave();
+    loadFailedExports();
+    updateTimeString();
 
     // Setup periodic autosave
     m_autoSaveTimer.setInterval(60000);
     connect(&m_autoSaveTimer, SIGNAL(timeout()), this, SLOT(autoSave()));
     m_autoSaveTimer.start();
 
-    m_posSrc = QGeoPositionInfoSource::createDefaultSource(0);
-    if (m_posSrc) {
-        m_posSrc->setUpdateInterval(1000);
-        connect(m_posSrc, SIGNAL(positionUpdated(QGeoPositionInfo)),
-                this, SLOT(positionUpdated(QGeoPositionInfo)));
-        connect(m_posSrc, SIGNAL(error(QGeoPositionInfoSource::Error)),
-                this, SLOT(positioningError(QGeoPositionInfoSource::Error)));
-        // Position updates are started/stopped in setIsTracking(...)
+    m_posSrc = 0;
+    ReplayPositionSource *replay = ReplayPositionSource::fromEnvironment(this);
+    if(replay) {
+        connect(replay, SIGNAL(sensorSample(TrackPoint)), this, SLOT(positionUpdated(TrackPoint)));
+        setPositionSource(replay);
     } else {
-        qDebug()<<"Failed initializing PositionInfoSource!";
+        setPositionSource(QGeoPositionInfoSource::createDefaultSource(this));
     }
     QTimer::singleShot(1000, this, SLOT(connectPlugins()));
     qDebug()<<"tr end";
@@ -65,6 +155,8 @@ TrackRecorder::TrackRecorder(QObject *parent) :
 
 TrackRecorder::~TrackRecorder() {
     qDebug()<<"TrackRecorder destructor";
+    waitForExports();
+    qDeleteAll(m_failed);
     autoSave();
 }
 
@@ -75,8 +167,10 @@ void TrackRecorder::connectPlugins() {
 		plugins = qobject_cast<Plugins *>(plugins_obj);
 		if (plugins) {
 			qDebug() << "got plugins for setting signal";
-			connect(plugins, SIGNAL(infoAvailable(TrackPoint)), this, SLOT(positionUpdated(TrackPoint)));
 			connect(this, SIGNAL(isTrackingChanged()), plugins, SLOT(changeTrackingStatus()));
+			if (m_tracking && plugins->hasTrackInfo()) {
+				m_sensorTimer.start();
+			}
 		} else {
 			qDebug() << "didn't get plugins for setting signal";
 			QTimer::singleShot(1000, this, SLOT(connectPlugins()));
@@ -93,10 +187,8 @@ void TrackRecorder::positionUpdated(const QGeoPositionInfo &newPos) {
     } else {
         m_accuracy = -1;
     }
-    emit accuracyChanged();
-
     m_currentPosition = newPos.coordinate();
-    emit currentPositionChanged();
+    markChanged(AccuracyChange | PositionChange);
 
     if(newPos.hasAttribute(QGeoPositionInfo::HorizontalAccuracy) &&
             (newPos.attribute(QGeoPositionInfo::HorizontalAccuracy) > 30.0)) {
@@ -104,73 +196,73 @@ void TrackRecorder::positionUpdated(const QGeoPositionInfo &newPos) {
     }
 
     if(m_tracking) {
-		TrackPoint tp(newPos);
-		if (tp.hasCoordinate()) {
-			if (last_position_time != 0 && last_position_time < tp.getTime().toTime_t()) {
-				TrackPoint *last_position_point = &m_points[last_position_time];
-				QGeoCoordinate coord(last_position_point->getLatitude(), last_position_point->getLongitude());
-				m_distance += coord.distanceTo(newPos.coordinate());
-				last_distance_time = 0;
-			}
-			last_position_time = tp.getTime().toTime_t();
-		}
-		
-		m_points[newPos.timestamp().toTime_t()].combine(tp, true);
-        
-        emit pointsChanged();
-        emit timeChanged();
-        if(m_isEmpty) {
-            m_isEmpty = false;
-            m_minLat = m_maxLat = newPos.coordinate().latitude();
-            m_minLon = m_maxLon = newPos.coordinate().longitude();
-            emit isEmptyChanged();
+        TrackPoint tp(newPos);
+        if(m_adaptiveSampling && m_sampler.update(tp)) {
+            applyInterval();
         }
-
-        if(m_points.size() > 1) {
-            // Next line triggers following compiler warning?
-            // \usr\include\qt5\QtCore\qlist.h:452: warning: assuming signed overflow does not occur when assuming that (X - c) > X is always false [-Wstrict-overflow]
-            emit distanceChanged();
-            if(newPos.coordinate().latitude() < m_minLat) {
-                m_minLat = newPos.coordinate().latitude();
-            } else if(newPos.coordinate().latitude() > m_maxLat) {
-                m_maxLat = newPos.coordinate().latitude();
-            }
-            if(newPos.coordinate().longitude() < m_minLon) {
-                m_minLon = newPos.coordinate().longitude();
-            } else if(newPos.coordinate().longitude() > m_maxLon) {
-                m_maxLon = newPos.coordinate().longitude();
-            }
+        if(m_smoothTrack) {
+            m_kalman.filter(tp);
         }
-        emit newTrackPoint(newPos.coordinate());
+        m_fusion.addPosition(tp);
+        processFused();
     }
 }
 
-void TrackRecorder::positionUpdated(TrackPoint newPoint) {
+void TrackRecorder::takeSensorSamples() {
+	if (!plugins) {
+		return;
+	}
+	plugins->takeSamples(m_sensorSamples);
+	for (int i = 0; i < m_sensorSamples.size(); i++) {
+		positionUpdated(m_sensorSamples.at(i));
+	}
+	m_sensorSamples.clear();
+}
+
+void TrackRecorder::positionUpdated(const TrackPoint &newPoint) {
 	if (m_tracking) {
-		qDebug() << "check1" << &newPoint << newPoint.getDistance();
-		m_points[newPoint.getTime().toTime_t()].combine(newPoint, false);
-		qDebug() << "check2" << &m_points[newPoint.getTime().toTime_t()] << m_points[newPoint.getTime().toTime_t()].getDistance();
-		
-        emit pointsChanged();
-        emit timeChanged();
-        if(m_isEmpty) {
-            m_isEmpty = false;
-            emit isEmptyChanged();
-        }
-        
-        if (newPoint.hasDistance()) {
-			qDebug() << "new track distance" << newPoint.getDistance();
-			if ((last_position_time == 0 || last_position_time < newPoint.getTime().toTime_t() - 5) && last_distance_time != 0 && last_distance_time < newPoint.getTime().toTime_t()) {
-				TrackPoint *last_distance_point = &m_points[last_distance_time];
-				m_distance += newPoint.getDistance() - last_distance_point->getDistance();
-				last_position_time = 0;
-			}
-			last_distance_time = newPoint.getTime().toTime_t();
-		}
-        emit distanceChanged();
+		m_fusion.addSensor(newPoint);
+		processFused();
 	}
 }
 
+// Stores points the fusion no longer changes. With flush everything still
+// waiting for the other source is stored, used when tracking stops.
+void TrackRecorder::processFused(bool flush) {
+    m_fused.clear();
+    if(flush) {
+        m_fusion.flush(m_fused);
+    } else {
+        m_fusion.take(m_fused);
+    }
+    if(m_fused.isEmpty()) {
+        return;
+    }
+
+    for(int i=0;i<m_fused.size();i++) {
+        const TrackPoint &tp = m_fused.at(i);
+        int index = m_points.merge(tp, true);
+        m_statistics.add(tp);
+        m_autoSaveIndex = qMin(m_autoSaveIndex, index);
+        m_simplifiedIndex = qMin(m_simplifiedIndex, index);
+        if(tp.hasCoordinate()) {
+            m_bounds.add(tp.getLatitude(), tp.getLongitude());
+            m_newTrackPoints.append(QGeoCoordinate(tp.getLatitude(), tp.getLongitude()));
+        }
+    }
+    m_distance += m_fusion.takeDistance();
+
+    int changes = PointsChange | TimeChange | StatisticsChange;
+    if(m_isEmpty) {
+        m_isEmpty = false;
+        changes |= IsEmptyChange;
+    }
+    if(m_points.size() > 1) {
+        changes |= DistanceChange;
+    }
+    markChanged(changes);
+}
+
 void TrackRecorder::positioningError(QGeoPositionInfoSource::Error error) {
     qDebug()<<"Positioning error:"<<error;
 }
@@ -183,14 +275,7 @@ void TrackRecorder::exportGpx(QString name, QString desc) {
     }
     QString homeDir = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
     QString subDir = "Rena";
-    QString filename;
-    if(!name.isEmpty()) {
-        filename = m_points.begin().value().getTime().toUTC().toString(Qt::ISODate)
-                + " - " + name + ".gpx";
-    } else {
-        filename = m_points.begin().value().getTime().toUTC().toString(Qt::ISODate)
-                + ".gpx";
-    }
+    QString filename = trackFilename(m_points, name);
     qDebug()<<"File:"<<homeDir<<"/"<<subDir<<"/"<<filename;
 
     QDir home = QDir(homeDir);
@@ -204,103 +289,147 @@ void TrackRecorder::exportGpx(QString name, QString desc) {
         }
     }
 
-    QSaveFile file;
-    file.setFileName(homeDir + "/" + subDir + "/" + filename);
-    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qDebug()<<"File opening failed, aborting";
-        return;
-    }
+    TrackExportJob *job = new TrackExportJob;
+    job->points = m_points;
+    job->name = name;
+    job->description = desc;
+    job->filename = filename;
+    job->path = homeDir + "/" + subDir + "/" + filename;
 
-    QXmlStreamWriter xml;
-    xml.setDevice(&file);
-    xml.setAutoFormatting(true);    // Human readable output
-    xml.writeStartDocument();
-    xml.writeDefaultNamespace("http://www.topografix.com/GPX/1/1");
-    xml.writeStartElement("gpx");
-    xml.writeAttribute("version", "1.1");
-    xml.writeAttribute("Creator", "Rena for Sailfish");
+    // The autosave goes with the export, whatever is recorded next starts
+    // a new one
+    autoSave();
+    QDir renaDir = QDir(homeDir + "/" + subDir);
+    QString journal;
+    for(int i=1;journal.isEmpty() || renaDir.exists(journal);i++) {
+        journal = QString("Autosave.export-%1").arg(i);
+    }
+    if(renaDir.rename("Autosave", journal)) {
+        job->journal = journal;
+    } else {
+        qDebug()<<"No autosave to keep for the export";
+    }
+    m_autoSaveIndex = 0;
 
-    if(!name.isEmpty() || !desc.isEmpty()) {
-        xml.writeStartElement("metadata");
-        if(!name.isEmpty()) {
-            xml.writeTextElement("name", name);
-        }
-        if(!desc.isEmpty()) {
-            xml.writeTextElement("desc", desc);
-        }
-        xml.writeEndElement(); // metadata
+    m_exports.append(job);
+    if(m_exports.size() == 1) {
+        startExport();
+        emit exportingChanged();
     }
+}
 
-    xml.writeStartElement("trk");
-    xml.writeStartElement("trkseg");
+bool TrackRecorder::isExporting() const {
+    return !m_exports.isEmpty();
+}
 
-    for(QMap<uint, TrackPoint>::iterator i = m_points.begin(); i != m_points.end(); i++) {
-        xml.writeStartElement("trkpt");
-        xml.writeAttribute("lat", QString::number(i.value().hasCoordinate() ? i.value().getLatitude() : 0, 'g', 15));
-        xml.writeAttribute("lon", QString::number(i.value().hasCoordinate() ? i.value().getLongitude() : 0, 'g', 15));
+int TrackRecorder::failedExports() const {
+    return m_failed.size();
+}
 
-        xml.writeTextElement("time", i.value().getTime().toUTC().toString(Qt::ISODate));
-        if(i.value().hasElevation()) {
-            xml.writeTextElement("ele", QString::number(i.value().getElevation(), 'g', 15));
-        }
+void TrackRecorder::retryExports() {
+    if(m_failed.isEmpty()) {
+        return;
+    }
+    bool idle = m_exports.isEmpty();
+    m_exports.append(m_failed);
+    m_failed.clear();
+    emit failedExportsChanged();
+    if(idle) {
+        startExport();
+        emit exportingChanged();
+    }
+}
 
-        xml.writeStartElement("extensions");
-        if(i.value().hasDirection()) {
-            xml.writeTextElement("dir", QString::number(i.value().getDirection(), 'g', 15));
-        }
-        if(i.value().hasGroundSpeed()) {
-            xml.writeTextElement("g_spd", QString::number(i.value().getGroundSpeed(), 'g', 15));
-        }
-        if(i.value().hasVerticalSpeed()) {
-            xml.writeTextElement("v_spd", QString::number(i.value().getVerticalSpeed(), 'g', 15));
-        }
-        if(i.value().hasMagneticVariation()) {
-            xml.writeTextElement("m_var", QString::number(i.value().getMagneticVariation(), 'g', 15));
-        }
-        if(i.value().hasHorizontalAccuracy()) {
-            xml.writeTextElement("h_acc", QString::number(i.value().getHorizontalAccuracy(), 'g', 15));
-        }
-        if(i.value().hasVerticalAccuracy()) {
-            xml.writeTextElement("v_acc", QString::number(i.value().getVerticalAccuracy(), 'g', 15));
-        }
-        if(i.value().hasDistance()) {
-            xml.writeTextElement("distance", QString::number(i.value().getDistance(), 'g', 15));
-        }
-        if(i.value().hasCadence()) {
-            xml.writeTextElement("cadence", QString::number(i.value().getCadence(), 'g', 15));
+void TrackRecorder::discardFailedExports() {
+    if(m_failed.isEmpty()) {
+        return;
+    }
+    QString homeDir = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
+    QString subDir = "Rena";
+    QDir renaDir = QDir(homeDir + "/" + subDir);
+    foreach(TrackExportJob *job, m_failed) {
+        if(!job->journal.isEmpty()) {
+            renaDir.remove(job->journal);
         }
-        xml.writeEndElement(); // extensions
-
-        xml.writeEndElement(); // trkpt
     }
+    qDeleteAll(m_failed);
+    m_failed.clear();
+    emit failedExportsChanged();
+}
 
-    xml.writeEndElement(); // trkseg
-    xml.writeEndElement(); // trk
-
-    xml.writeEndElement(); // gpx
-    xml.writeEndDocument();
+// Exports are written one at a time in the order they were asked for
+void TrackRecorder::startExport() {
+    m_exportWatcher.setFuture(QtConcurrent::run(writeTrack, m_exports.first()));
+}
 
-    file.commit();
-    if(file.error()) {
-        qDebug()<<"Error in writing to a file";
-        qDebug()<<file.errorString();
+void TrackRecorder::exportingFinished() {
+    // finished() of an export already handled in waitForExports() can
+    // still be queued
+    if(m_exports.isEmpty() || !m_exportWatcher.isFinished()) {
+        return;
+    }
+    TrackExportJob *job = m_exports.takeFirst();
+    bool ok = m_exportWatcher.result();
+    if(!m_exports.isEmpty()) {
+        startExport();
+    }
+    finishExport(*job, ok);
+    if(ok) {
+        delete job;
     } else {
-        QDir renaDir = QDir(homeDir + "/" + subDir);
-        renaDir.remove("Autosave");
-		if (plugins) {
-			qDebug() << "got plugins for uploading ttrack";
-			plugins->uploadTrack(filename);
-		} else {
-			qDebug() << "didn't get plugins for uploading track";
-		}
+        m_failed.append(job);
+        emit failedExportsChanged();
+    }
+    if(m_exports.isEmpty()) {
+        emit exportingChanged();
+    }
+}
+
+void TrackRecorder::waitForExports() {
+    while(!m_exports.isEmpty()) {
+        m_exportWatcher.waitForFinished();
+        exportingFinished();
+    }
+}
+
+void TrackRecorder::finishExport(const TrackExportJob &job, bool ok) {
+    if(!ok) {
+        qDebug()<<"Export of"<<job.filename<<"failed, keeping"<<job.journal<<"for a retry";
+        emit exportFinished(job.filename, false);
+        return;
+    }
+    QString homeDir = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
+    QString subDir = "Rena";
+    QDir renaDir = QDir(homeDir + "/" + subDir);
+    if(!job.journal.isEmpty()) {
+        renaDir.remove(job.journal);
     }
+
+    // Index the new track so history does not have to parse it
+    TrackSummaryCache cache;
+    cache.load();
+    cache.insert(QFileInfo(job.path), job.summary);
+    cache.save();
+
+	if (plugins) {
+		qDebug() << "got plugins for uploading ttrack";
+		plugins->uploadTrack(job.filename, job.points, job.description);
+	} else {
+		qDebug() << "didn't get plugins for uploading track";
+	}
+    emit exportFinished(job.filename, true);
 }
 
 void TrackRecorder::clearTrack() {
     m_points.clear();
+    m_bounds.clear();
+    m_simplifier.clear();
+    m_autoSaveIndex = 0;
+    m_simplifiedIndex = 0;
+    m_fusion.clear();
+    m_kalman.reset();
+    m_statistics.clear();
     m_distance = 0;
-    last_position_time = 0;
-    last_distance_time = 0;
     m_isEmpty = true;
 
     QString homeDir = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
@@ -308,10 +437,9 @@ void TrackRecorder::clearTrack() {
     QDir renaDir = QDir(homeDir + "/" + subDir);
     renaDir.remove("Autosave");
 
-    emit distanceChanged();
-    emit timeChanged();
-    emit isEmptyChanged();
-    emit pointsChanged();
+    m_newTrackPoints.clear();
+    markChanged(DistanceChange | TimeChange | IsEmptyChange | PointsChange | StatisticsChange);
+    emitChanges();
 }
 
 qreal TrackRecorder::accuracy() const {
@@ -326,7 +454,31 @@ qreal TrackRecorder::distance() const {
     return m_distance;
 }
 
+int TrackRecorder::movingTime() const {
+    return m_statistics.movingMs() / 1000;
+}
+
+qreal TrackRecorder::ascent() const {
+    return m_statistics.ascent();
+}
+
+qreal TrackRecorder::descent() const {
+    return m_statistics.descent();
+}
+
+qreal TrackRecorder::averageCadence() const {
+    return m_statistics.averageCadence();
+}
+
+const TrackStatistics &TrackRecorder::statistics() const {
+    return m_statistics;
+}
+
 QString TrackRecorder::time() const {
+    return m_time;
+}
+
+void TrackRecorder::updateTimeString() {
     uint hours, minutes, seconds;
 
     if(m_points.size() < 2) {
@@ -334,20 +486,59 @@ QString TrackRecorder::time() const {
         minutes = 0;
         seconds = 0;
     } else {
-        QDateTime first = m_points.begin().value().getTime();
-        QDateTime last = (m_points.end()-1).value().getTime();
-        qint64 difference = first.secsTo(last);
+        qint64 difference = (m_points.timeMs(m_points.size()-1) - m_points.timeMs(0)) / 1000;
         hours = difference / (60*60);
         minutes = (difference - hours*60*60) / 60;
         seconds = difference - hours*60*60 - minutes*60;
     }
 
-    QString timeStr = QString("%1h %2m %3s")
+    m_time = QString("%1h %2m %3s")
             .arg(hours, 2, 10, QLatin1Char('0'))
             .arg(minutes, 2, 10, QLatin1Char('0'))
             .arg(seconds, 2, 10, QLatin1Char('0'));
+}
 
-    return timeStr;
+void TrackRecorder::markChanged(int changes) {
+    m_changes |= changes;
+    if(!m_notifyTimer.isActive()) {
+        m_notifyTimer.start(m_applicationActive ? 16 : 1000);
+    }
+}
+
+void TrackRecorder::emitChanges() {
+    m_notifyTimer.stop();
+    int changes = m_changes;
+    m_changes = 0;
+
+    if(changes & TimeChange) {
+        updateTimeString();
+    }
+    if(changes & AccuracyChange) {
+        emit accuracyChanged();
+    }
+    if(changes & PositionChange) {
+        emit currentPositionChanged();
+    }
+    if(changes & PointsChange) {
+        emit pointsChanged();
+    }
+    if(changes & TimeChange) {
+        emit timeChanged();
+    }
+    if(changes & DistanceChange) {
+        emit distanceChanged();
+    }
+    if(changes & IsEmptyChange) {
+        emit isEmptyChanged();
+    }
+    if(changes & StatisticsChange) {
+        emit statisticsChanged();
+    }
+    QList<QGeoCoordinate> newTrackPoints;
+    newTrackPoints.swap(m_newTrackPoints);
+    foreach(const QGeoCoordinate &coordinate, newTrackPoints) {
+        emit newTrackPoint(coordinate);
+    }
 }
 
 bool TrackRecorder::isTracking() const {
@@ -358,7 +549,20 @@ void TrackRecorder::setIsTracking(bool tracking) {
     if(m_tracking == tracking) {
         return; // No change
     }
+    if(!tracking) {
+        // Keep what arrived before stopping
+        takeSensorSamples();
+        m_sensorTimer.stop();
+        processFused(true);
+    }
     m_tracking = tracking;
+    if(m_tracking) {
+        m_sampler.reset();
+    }
+    applyInterval();
+    if(m_tracking && plugins && plugins->hasTrackInfo()) {
+        m_sensorTimer.start();
+    }
 
     if(m_posSrc) {  // If we have positioning
         if(m_tracking && !m_applicationActive) {
@@ -387,6 +591,10 @@ void TrackRecorder::setApplicationActive(bool active) {
         return; // No change
     }
     m_applicationActive = active;
+    if(m_applicationActive && m_notifyTimer.isActive()) {
+        // Don't hold a background batch back once visible again
+        m_notifyTimer.start(16);
+    }
 
     if(m_posSrc) {  // If we have positioning
         if(m_applicationActive && !m_tracking) {
@@ -406,8 +614,33 @@ QGeoCoordinate TrackRecorder::currentPosition() const {
     return m_currentPosition;
 }
 
+// Takes ownership of source, replacing the current one
+void TrackRecorder::setPositionSource(QGeoPositionInfoSource *source) {
+    bool running = m_posSrc && (m_tracking || m_applicationActive);
+    if(m_posSrc) {
+        m_posSrc->stopUpdates();
+        delete m_posSrc;
+    }
+    m_posSrc = source;
+    if(!m_posSrc) {
+        qDebug()<<"Failed initializing PositionInfoSource!";
+        return;
+    }
+    m_posSrc->setParent(this);
+    m_posSrc->setUpdateInterval(m_effectiveInterval);
+    connect(m_posSrc, SIGNAL(positionUpdated(QGeoPositionInfo)),
+            this, SLOT(positionUpdated(QGeoPositionInfo)));
+    connect(m_posSrc, SIGNAL(error(QGeoPositionInfoSource::Error)),
+            this, SLOT(positioningError(QGeoPositionInfoSource::Error)));
+    // Position updates are started/stopped in setIsTracking(...) and
+    // setApplicationActive(...), a replaced source carries on
+    if(running) {
+        m_posSrc->startUpdates();
+    }
+}
+
 int TrackRecorder::updateInterval() const {
-    return m_posSrc->updateInterval();
+    return m_updateInterval;
 }
 
 void TrackRecorder::setUpdateInterval(int updateInterval) {
@@ -415,21 +648,86 @@ void TrackRecorder::setUpdateInterval(int updateInterval) {
         qDebug()<<"Can't set update interval, position source not initialized!";
         return;
     }
-    m_posSrc->setUpdateInterval(updateInterval);
+    m_updateInterval = updateInterval;
+    m_sampler.setBaseInterval(updateInterval);
     qDebug()<<"Setting update interval to"<<updateInterval<<"msec";
+    applyInterval();
     emit updateIntervalChanged();
 }
 
+// Requests the configured interval, or the adaptive one while tracking
+void TrackRecorder::applyInterval() {
+    int interval = m_updateInterval;
+    if(m_adaptiveSampling && m_tracking) {
+        interval = m_sampler.interval();
+    }
+    if(!m_posSrc || interval == m_effectiveInterval) {
+        return;
+    }
+    m_effectiveInterval = interval;
+    m_posSrc->setUpdateInterval(interval);
+    if(m_adaptiveSampling && !m_sampler.decisions().isEmpty()) {
+        const AdaptiveSampler::Decision &decision = m_sampler.decisions().last();
+        qDebug()<<"Update interval"<<interval<<"msec,"<<AdaptiveSampler::modeName(decision.mode)<<decision.reason;
+    }
+    emit effectiveIntervalChanged();
+}
+
+bool TrackRecorder::adaptiveSampling() const {
+    return m_adaptiveSampling;
+}
+
+void TrackRecorder::setAdaptiveSampling(bool adaptive) {
+    if(m_adaptiveSampling == adaptive) {
+        return;
+    }
+    m_adaptiveSampling = adaptive;
+    m_sampler.reset();
+    applyInterval();
+    emit adaptiveSamplingChanged();
+}
+
+int TrackRecorder::effectiveInterval() const {
+    return m_effectiveInterval;
+}
+
+QStringList TrackRecorder::samplingLog() const {
+    QStringList log;
+    const QList<AdaptiveSampler::Decision> &decisions = m_sampler.decisions();
+    for(int i=0;i<decisions.size();i++) {
+        const AdaptiveSampler::Decision &decision = decisions.at(i);
+        log.append(QString("%1 %2 ms %3: %4")
+                   .arg(QDateTime::fromMSecsSinceEpoch(decision.time).toString("hh:mm:ss"))
+                   .arg(decision.interval)
+                   .arg(AdaptiveSampler::modeName(decision.mode))
+                   .arg(decision.reason));
+    }
+    return log;
+}
+
+bool TrackRecorder::smoothTrack() const {
+    return m_smoothTrack;
+}
+
+void TrackRecorder::setSmoothTrack(bool smooth) {
+    if(m_smoothTrack == smooth) {
+        return;
+    }
+    m_smoothTrack = smooth;
+    m_kalman.reset();
+    qDebug()<<"Track smoothing"<<(smooth ? "enabled" : "disabled");
+    emit smoothTrackChanged();
+}
+
 QGeoCoordinate TrackRecorder::trackPointAt(int index) {
     if(index < m_points.size()) {
-		TrackPoint p = (m_points.begin()+index).value();
 		QGeoCoordinate coord;
-		if (p.hasCoordinate()) {
-			coord.setLatitude(p.getLatitude());
-			coord.setLongitude(p.getLongitude());
+		if (m_points.hasCoordinate(index)) {
+			coord.setLatitude(m_points.latitude(index));
+			coord.setLongitude(m_points.longitude(index));
 		}
-		if (p.hasElevation()) {
-			coord.setAltitude(p.getElevation());
+		if (m_points.has(index, TrackPoint::HasElevation)) {
+			coord.setAltitude(m_points.elevation(index));
 		}
         return coord;
     } else {
@@ -437,50 +735,29 @@ QGeoCoordinate TrackRecorder::trackPointAt(int index) {
     }
 }
 
+QVariantList TrackRecorder::simplifiedPath(qreal zoomLevel) {
+    m_simplifier.update(m_points, m_simplifiedIndex);
+    m_simplifiedIndex = m_points.size();
+    return m_simplifier.path(zoomLevel);
+}
+
 int TrackRecorder::fitZoomLevel(int width, int height) {
-    if(m_points.size() < 2 || width < 1 || height < 1) {
-        // One point track or zero size map
+    if(m_points.size() < 2) {
+        // One point track
         return 20;
     }
 
     // Keep also current position in view
-    qreal minLon = qMin(m_minLon, (qreal)m_currentPosition.longitude());
-    qreal maxLon = qMax(m_maxLon, (qreal)m_currentPosition.longitude());
-    qreal minLat = qMin(m_minLat, (qreal)m_currentPosition.latitude());
-    qreal maxLat = qMax(m_maxLat, (qreal)m_currentPosition.latitude());
-
-    qreal trackMinX = (minLon + 180) / 360;
-    qreal trackMaxX = (maxLon + 180) / 360;
-    qreal trackMinY = sqrt(1-qLn(minLat*M_PI/180 + 1/qCos(minLat*M_PI/180))/M_PI);
-    qreal trackMaxY = sqrt(1-qLn(maxLat*M_PI/180 + 1/qCos(maxLat*M_PI/180))/M_PI);
-
-    qreal coord, pixel;
-    qreal trackAR = qAbs((trackMaxX - trackMinX) / (trackMaxY - trackMinY));
-    qreal windowAR = (qreal)width/(qreal)height;
-    if(trackAR > windowAR ) {
-        // Width limits
-        coord = qAbs(trackMaxX - trackMinX);
-        pixel = width;
-    } else {
-        // height limits
-        coord = qAbs(trackMaxY - trackMinY);
-        pixel = height;
-    }
-
-    // log2(x) = ln(x)/ln(2)
-    int z = qFloor(qLn(pixel/256.0 * 1.0/coord * qCos((m_minLat+m_maxLat)/2*M_PI/180))
-                   / qLn(2)) + 1;
-    return z;
+    TrackBounds view = m_bounds;
+    view.add(m_currentPosition);
+    return view.fitZoomLevel(width, height);
 }
 
 QGeoCoordinate TrackRecorder::trackCenter() {
     // Keep also current position in view
-    qreal minLon = qMin(m_minLon, (qreal)m_currentPosition.longitude());
-    qreal maxLon = qMax(m_maxLon, (qreal)m_currentPosition.longitude());
-    qreal minLat = qMin(m_minLat, (qreal)m_currentPosition.latitude());
-    qreal maxLat = qMax(m_maxLat, (qreal)m_currentPosition.latitude());
-
-    return QGeoCoordinate((minLat+maxLat)/2, (minLon+maxLon)/2);
+    TrackBounds view = m_bounds;
+    view.add(m_currentPosition);
+    return view.center();
 }
 
 void TrackRecorder::autoSave() {
@@ -489,12 +766,12 @@ void TrackRecorder::autoSave() {
     QString filename = "Autosave";
     QDir home = QDir(homeDir);
 
-    if(m_points.size() < 1) {
+    if(m_points.size() < 1 || m_autoSaveIndex >= m_points.size()) {
         // Nothing to save
         return;
     }
 
-    qDebug()<<"Autosaving";
+    qDebug()<<"Autosaving"<<m_points.size()-m_autoSaveIndex<<"points";
 
     if(!home.exists(subDir)) {
         qDebug()<<"Directory does not exist, creating";
@@ -505,96 +782,10 @@ void TrackRecorder::autoSave() {
             return;
         }
     }
-    QFile file;
-    file.setFileName(homeDir + "/" + subDir + "/" + filename);
-    if(!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Append)) {
-        qDebug()<<"File opening failed, aborting";
-        return;
+    AutoSaveJournal journal(homeDir + "/" + subDir + "/" + filename);
+    if(journal.append(m_points, m_autoSaveIndex)) {
+        m_autoSaveIndex = m_points.size();
     }
-    QTextStream stream(&file);
-    stream.setRealNumberPrecision(15);
-
-	QMap<uint, TrackPoint>::iterator i = m_points.find(m_autoSavePosition);
-	if (i == m_points.end() && m_points.size()) {
-		m_autoSavePosition = m_points.begin().key();
-		i = m_points.find(m_autoSavePosition);
-	} else {
-		i++;
-	}
-	while (i != m_points.end()) {
-		if (i.value().hasCoordinate()) {
-			stream<<i.value().getLatitude();
-			stream<<" ";
-			stream<<i.value().getLongitude();
-			stream<<" ";
-		} else {
-			stream<<"nan nan ";
-		}
-		if (i.value().hasTime()) {
-			stream<<i.value().getTime().toUTC().toString(Qt::ISODate);
-			stream<<" ";
-		} else {
-			stream<<"nan ";
-		}
-		if(i.value().hasElevation()) {
-			stream<<i.value().getElevation();
-			stream<<" ";
-		} else {
-			stream<<"nan ";
-		}
-		if (i.value().hasDirection()) {
-			stream<<i.value().getDirection();
-			stream<<" ";
-		} else {
-			stream<<"nan ";
-		}
-		if (i.value().hasGroundSpeed()) {
-			stream<<i.value().getGroundSpeed();
-			stream<<" ";
-		} else {
-			stream<<"nan ";
-		}
-		if (i.value().hasVerticalSpeed()) {
-			stream<<i.value().getVerticalSpeed();
-			stream<<" ";
-		} else {
-			stream<<"nan ";
-		}
-		if (i.value().hasMagneticVariation()) {
-			stream<<i.value().getMagneticVariation();
-			stream<<" ";
-		} else {
-			stream<<"nan ";
-		}
-		if (i.value().hasHorizontalAccuracy()) {
-			stream<<i.value().getHorizontalAccuracy();
-			stream<<" ";
-		} else {
-			stream<<"nan ";
-		}
-		if (i.value().hasVerticalAccuracy()) {
-			stream<<i.value().getVerticalAccuracy();
-			stream<<" ";
-		} else {
-			stream<<"nan ";
-		}
-		if (i.value().hasDistance()) {
-			stream<<i.value().getDistance();
-			stream<<" ";
-		} else {
-			stream<<"nan ";
-		}
-		if (i.value().hasCadence()) {
-			stream<<i.value().getCadence();
-		} else {
-			stream<<"nan";
-		}
-		stream<<'\n';
-		m_autoSavePosition = i.key();
-		i++;
-	}
-    stream.flush();
-    file.close();
 }
 
 void TrackRecorder::loadAutoSave() {
@@ -610,11 +801,66 @@ void TrackRecorder::loadAutoSave() {
 
     qDebug()<<"Loading autosave";
 
+    AutoSaveJournal journal(file.fileName());
+    if(journal.load(m_points)) {
+        m_autoSaveIndex = m_points.size();
+    } else {
+        // Text autosave from an older version, next autosave rewrites it
+        // as a journal
+        loadTextAutoSave(file);
+        m_autoSaveIndex = 0;
+    }
+
+    qDebug()<<m_points.size()<<"track points loaded";
+
+    for(int i=0;i<m_points.size();i++) {
+        TrackPoint point = m_points.at(i);
+        m_statistics.add(point);
+        m_fusion.restore(point);
+        if(point.hasCoordinate()) {
+            m_bounds.add(point.getLatitude(), point.getLongitude());
+        }
+    }
+    // Wheel or GPS per interval as while recording, not the statistics'
+    // coordinate only distance
+    m_distance = m_fusion.takeDistance();
+
+    if(!m_points.isEmpty()) {
+        m_isEmpty = false;
+    }
+    markChanged(PointsChange | TimeChange | DistanceChange | IsEmptyChange | StatisticsChange);
+}
+
+// Autosaves left by exports that failed or were cut short in the previous
+// session, name and description did not survive
+void TrackRecorder::loadFailedExports() {
+    QString homeDir = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
+    QString subDir = "Rena";
+    QDir renaDir = QDir(homeDir + "/" + subDir);
+    QStringList exports = renaDir.entryList(QStringList("Autosave.export-*"), QDir::Files, QDir::Name);
+    foreach(const QString &journalName, exports) {
+        TrackExportJob *job = new TrackExportJob;
+        AutoSaveJournal journal(renaDir.filePath(journalName));
+        if(!journal.load(job->points) || job->points.isEmpty()) {
+            qDebug()<<"Could not load unfinished export"<<journalName;
+            delete job;
+            continue;
+        }
+        qDebug()<<"Unfinished export"<<journalName<<"waits for a retry";
+        job->filename = trackFilename(job->points, QString());
+        job->path = renaDir.filePath(job->filename);
+        job->journal = journalName;
+        m_failed.append(job);
+    }
+}
+
+void TrackRecorder::loadTextAutoSave(QFile &file) {
     if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         qDebug()<<"File opening failed, aborting";
         return;
     }
     QTextStream stream(&file);
+    IsoTime times;
 
     while(!stream.atEnd()) {
         TrackPoint point;
@@ -626,7 +872,10 @@ void TrackRecorder::loadAutoSave() {
 			point.setLongitude(lon);
 		}
 		stream>>timeStr;
-		if (timeStr != "nan") {
+		qint64 msecs;
+		if (times.parse(timeStr, msecs)) {
+			point.setTimeMs(msecs);
+		} else if (timeStr != "nan") {
 			point.setTime(QDateTime::fromString(timeStr,Qt::ISODate));
 		}
 		stream>>temp;
@@ -666,56 +915,7 @@ void TrackRecorder::loadAutoSave() {
             point.setCadence(temp);
         }
         stream.readLine(); // Read rest of the line, if any
-        m_points[point.getTime().toTime_t()] = point;
-        if (point.hasCoordinate()) {
-			if(m_points.size() > 1) {
-				if(point.getLatitude() < m_minLat) {
-					m_minLat = point.getLatitude();
-				} else if(point.getLatitude() > m_maxLat) {
-					m_maxLat = point.getLatitude();
-				}
-				if(point.getLongitude() < m_minLon) {
-					m_minLon = point.getLongitude();
-				} else if(point.getLongitude() > m_maxLon) {
-					m_maxLon = point.getLongitude();
-				}
-			} else {
-				m_minLat = m_maxLat = point.getLatitude();
-				m_minLon = m_maxLon = point.getLongitude();
-			}
-			QGeoCoordinate coord(point.getLatitude(), point.getLongitude());
-			emit newTrackPoint(coord);
-		}
+        m_points.merge(point, true);
     }
-    if (m_points.size()) {
-		m_autoSavePosition = (--m_points.end()).key();
-	} else {
-		m_autoSavePosition = 0;
-	}
     file.close();
-
-    qDebug()<<m_points.size()<<"track points loaded";
-
-    emit pointsChanged();
-    emit timeChanged();
-
-    if(m_points.size() > 1) {
-        for(QMap<uint, TrackPoint>::iterator i = ++m_points.begin(); i != m_points.end(); i++) {
-			TrackPoint *p1 = &(i-1).value();
-			TrackPoint *p2 = &i.value();
-			if (p1->hasCoordinate() && p2->hasCoordinate()) {
-				QGeoCoordinate coord1(p1->getLatitude(), p1->getLongitude());
-				QGeoCoordinate coord2(p2->getLatitude(), p2->getLongitude());
-				m_distance += coord1.distanceTo(coord2);
-			} else if (p1->hasDistance() && p2->hasDistance()) {
-				m_distance += p2->getDistance() - p1->getDistance();
-			}
-        }
-        emit distanceChanged();
-    }
-
-    if(!m_points.isEmpty()) {
-        m_isEmpty = false;
-        emit isEmptyChanged();
-    }
 }
@@ -24,10 +24,32 @@
 #include <QObject>
 #include <QGeoPositionInfoSource>
 #include <QTimer>
+#include <QFile>
+#include <QStringList>
+#include <QList>
+#include <QPointer>
+#include <QFutureWatcher>
 
 #include "plugins.h"
 #include "TrackPoint.h"
+#include "TrackPoints.h"
+#include "TrackBounds.h"
+#include "pathsimplifier.h"
+#include "sensorfusion.h"
+#include "gpskalmanfilter.h"
+#include "adaptivesampler.h"
+#include "trackstatistics.h"
 
+class TrackExportJob;
+
+/*
+ * Records the track and saves it. exportGpx() takes a snapshot of the
+ * points and writes the file on a worker thread, exportFinished() reports
+ * the result. Until then the autosave of the exported track is kept under
+ * another name, so clearTrack() and a new recording can follow right away.
+ * Failed exports, and the ones cut short by the previous session, wait
+ * with their autosave in failedExports for retryExports().
+ */
 class TrackRecorder : public QObject
 {
     Q_OBJECT
@@ -37,15 +59,28 @@ class TrackRecorder : public QObject
     Q_PROPERTY(QString time READ time NOTIFY timeChanged)
     Q_PROPERTY(bool tracking READ isTracking WRITE setIsTracking NOTIFY isTrackingChanged)
     Q_PROPERTY(bool isEmpty READ isEmpty NOTIFY isEmptyChanged)
+    Q_PROPERTY(bool exporting READ isExporting NOTIFY exportingChanged)
+    Q_PROPERTY(int failedExports READ failedExports NOTIFY failedExportsChanged)
     Q_PROPERTY(bool applicationActive READ applicationActive WRITE setApplicationActive NOTIFY applicationActiveChanged)
     Q_PROPERTY(QGeoCoordinate currentPosition READ currentPosition NOTIFY currentPositionChanged)
     Q_PROPERTY(int updateInterval READ updateInterval WRITE setUpdateInterval NOTIFY updateIntervalChanged)
+    Q_PROPERTY(bool smoothTrack READ smoothTrack WRITE setSmoothTrack NOTIFY smoothTrackChanged)
+    Q_PROPERTY(bool adaptiveSampling READ adaptiveSampling WRITE setAdaptiveSampling NOTIFY adaptiveSamplingChanged)
+    Q_PROPERTY(int effectiveInterval READ effectiveInterval NOTIFY effectiveIntervalChanged)
+    Q_PROPERTY(int movingTime READ movingTime NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal ascent READ ascent NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal descent READ descent NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal averageCadence READ averageCadence NOTIFY statisticsChanged)
 
 public:
     explicit TrackRecorder(QObject *parent = 0);
     ~TrackRecorder();
     Q_INVOKABLE void exportGpx(QString name="", QString desc="");
     Q_INVOKABLE void clearTrack();
+    Q_INVOKABLE void retryExports();
+    Q_INVOKABLE void discardFailedExports();
+    // Blocks until every queued export is written
+    void waitForExports();
 
     qreal accuracy() const;
     int points() const;
@@ -54,12 +89,27 @@ public:
     bool isTracking() const;
     void setIsTracking(bool tracking);
     bool isEmpty() const;
+    bool isExporting() const;
+    int failedExports() const;
     bool applicationActive() const;
     void setApplicationActive(bool active);
     QGeoCoordinate currentPosition() const;
     int updateInterval() const;
     void setUpdateInterval(int updateInterval);
+    bool smoothTrack() const;
+    void setSmoothTrack(bool smooth);
+    bool adaptiveSampling() const;
+    void setAdaptiveSampling(bool adaptive);
+    int effectiveInterval() const;
+    Q_INVOKABLE QStringList samplingLog() const;
+    int movingTime() const;
+    qreal ascent() const;
+    qreal descent() const;
+    qreal averageCadence() const;
+    const TrackStatistics &statistics() const;
+    void setPositionSource(QGeoPositionInfoSource *source);
     Q_INVOKABLE QGeoCoordinate trackPointAt(int index);
+    Q_INVOKABLE QVariantList simplifiedPath(qreal zoomLevel);
 
     // Temporary "hacks" to get around misbehaving Map.fitViewportToMapItems()
     Q_INVOKABLE int fitZoomLevel(int width, int height);
@@ -72,38 +122,82 @@ signals:
     void timeChanged();
     void isTrackingChanged();
     void isEmptyChanged();
+    void exportingChanged();
+    void exportFinished(QString filename, bool ok);
+    void failedExportsChanged();
     void applicationActiveChanged();
     void currentPositionChanged();
     void updateIntervalChanged();
+    void smoothTrackChanged();
+    void adaptiveSamplingChanged();
+    void effectiveIntervalChanged();
+    void statisticsChanged();
     void newTrackPoint(QGeoCoordinate coordinate);
 
 public slots:
 	void connectPlugins();
     void positionUpdated(const QGeoPositionInfo &newPos);
-    void positionUpdated(TrackPoint newPoint);
+    void positionUpdated(const TrackPoint &newPoint);
     void positioningError(QGeoPositionInfoSource::Error error);
     void autoSave();
 
+private slots:
+    void emitChanges();
+    void takeSensorSamples();
+    void exportingFinished();
+
 private:
+    // Property changes waiting for the next emitChanges()
+    enum Change {
+        AccuracyChange = 1 << 0,
+        PositionChange = 1 << 1,
+        PointsChange = 1 << 2,
+        TimeChange = 1 << 3,
+        DistanceChange = 1 << 4,
+        IsEmptyChange = 1 << 5,
+        StatisticsChange = 1 << 6
+    };
+    void markChanged(int changes);
+    void updateTimeString();
+    void processFused(bool flush = false);
+    void applyInterval();
     void loadAutoSave();
+    void loadTextAutoSave(QFile &file);
+    void loadFailedExports();
+    void startExport();
+    void finishExport(const TrackExportJob &job, bool ok);
     QGeoPositionInfoSource *m_posSrc;
     qreal m_accuracy;
-    //QList<TrackPoint> m_points;
-    QMap<uint, TrackPoint> m_points;
-    uint last_position_time;
-    uint last_distance_time;
+    TrackPoints m_points;
     QGeoCoordinate m_currentPosition;
     qreal m_distance;
-    qreal m_minLat;
-    qreal m_maxLat;
-    qreal m_minLon;
-    qreal m_maxLon;
+    TrackStatistics m_statistics;   // Fed with the fused points
+    TrackBounds m_bounds;
+    PathSimplifier m_simplifier;
+    int m_simplifiedIndex;  // Points from this index on are not in m_simplifier
     bool m_tracking;
     bool m_isEmpty;
     bool m_applicationActive;
-    uint m_autoSavePosition;
+    int m_autoSaveIndex;    // Points from this index on are not autosaved
     QTimer m_autoSaveTimer;
-    Plugins *plugins;
+    int m_changes;
+    QList<QGeoCoordinate> m_newTrackPoints;
+    QString m_time;
+    QTimer m_notifyTimer;
+    QTimer m_sensorTimer;
+    QVector<TrackPoint> m_sensorSamples;
+    bool m_smoothTrack;
+    int m_updateInterval;       // Configured, fastest when adaptive
+    int m_effectiveInterval;    // Currently requested from m_posSrc
+    bool m_adaptiveSampling;
+    AdaptiveSampler m_sampler;
+    GpsKalmanFilter m_kalman;
+    SensorFusion m_fusion;      // Orders GPS and sensor data and picks the distance source
+    QVector<TrackPoint> m_fused;
+    QList<TrackExportJob *> m_exports;     // The first one is being written
+    QList<TrackExportJob *> m_failed;      // Waiting for retryExports()
+    QFutureWatcher<bool> m_exportWatcher;
+    QPointer<Plugins> plugins;  // Can go before the recorder on exit
     };
 
 #endif // TRACKRECORDER_H
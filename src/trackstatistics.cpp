@@ -0,0 +1,280 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QGeoCoordinate>
+#include <limits>
+#include "trackstatistics.h"
+
+static const qint64 noTime = std::numeric_limits<qint64>::min() / 2;
+// Slower steps are standing still, m/s
+static const qreal minMovingSpeed = 0.5;
+// Elevation change needed to turn from climbing to descending, m
+static const qreal elevationHysteresis = 5;
+static const qreal mile = 1609.344;
+// Entries behind the effort window are dropped in batches
+static const int effortCompactSize = 1024;
+
+TrackStatistics::Splits::Splits(qreal length) :
+    m_length(length)
+{
+    clear();
+}
+
+void TrackStatistics::Splits::clear() {
+    durations.clear();
+    m_next = m_length;
+    m_lastMs = 0;
+    m_started = false;
+}
+
+void TrackStatistics::Splits::add(qreal fromDistance, qint64 fromMs, qreal toDistance, qint64 toMs) {
+    if(!m_started) {
+        m_lastMs = fromMs;
+        m_started = true;
+    }
+    while(toDistance >= m_next) {
+        // Crossing time interpolated within the step
+        qint64 ms = fromMs;
+        if(toDistance > fromDistance) {
+            ms += qRound64((m_next - fromDistance) / (toDistance - fromDistance) * (toMs - fromMs));
+        }
+        durations.append(ms - m_lastMs);
+        m_lastMs = ms;
+        m_next += m_length;
+    }
+}
+
+TrackStatistics::Effort::Effort(qreal length) :
+    m_length(length)
+{
+    clear();
+}
+
+void TrackStatistics::Effort::clear() {
+    best = -1;
+    m_distance.clear();
+    m_ms.clear();
+    m_head = 0;
+}
+
+void TrackStatistics::Effort::add(qreal distance, qint64 ms) {
+    m_distance.append(distance);
+    m_ms.append(ms);
+
+    // Advance to the last entry at or before the start of the window, the
+    // newest entry is always after it
+    qreal start = distance - m_length;
+    while(m_head + 1 < m_distance.size() && m_distance.at(m_head + 1) <= start) {
+        m_head++;
+    }
+    if(m_distance.at(m_head) <= start) {
+        int next = m_head + 1;
+        qreal span = m_distance.at(next) - m_distance.at(m_head);
+        qint64 startMs = m_ms.at(m_head);
+        if(span > 0) {
+            startMs += qRound64((start - m_distance.at(m_head)) / span * (m_ms.at(next) - m_ms.at(m_head)));
+        }
+        if(best < 0 || ms - startMs < best) {
+            best = ms - startMs;
+        }
+    }
+
+    if(m_head >= effortCompactSize && m_head * 2 > m_distance.size()) {
+        m_distance.remove(0, m_head);
+        m_ms.remove(0, m_head);
+        m_head = 0;
+    }
+}
+
+TrackStatistics::TrackStatistics() :
+    m_kmSplits(1000),
+    m_mileSplits(mile),
+    m_best1km(1000),
+    m_best5km(5000)
+{
+    clear();
+}
+
+void TrackStatistics::clear() {
+    m_count = 0;
+    m_hasPrevious = false;
+    m_previous = TrackPoint();
+    m_firstMs = noTime;
+    m_lastMs = noTime;
+    m_lastMsDistance = 0;
+    m_movingMs = 0;
+    m_distance = 0;
+    m_maxSpeed = 0;
+    m_hasElevation = false;
+    m_trend = 0;
+    m_elevationRef = 0;
+    m_ascent = 0;
+    m_descent = 0;
+    m_cadenceSum = 0;
+    m_cadenceCount = 0;
+    m_maxCadence = 0;
+    m_kmSplits.clear();
+    m_mileSplits.clear();
+    m_best1km.clear();
+    m_best5km.clear();
+}
+
+void TrackStatistics::add(const TrackPoint &point) {
+    m_count++;
+
+    if(m_hasPrevious) {
+        quint16 both = m_previous.flags() & point.flags();
+        qreal step = 0;
+        if(both & TrackPoint::HasCoordinate) {
+            QGeoCoordinate coord1(m_previous.getLatitude(), m_previous.getLongitude());
+            QGeoCoordinate coord2(point.getLatitude(), point.getLongitude());
+            step = coord1.distanceTo(coord2);
+        } else if(both & TrackPoint::HasDistance) {
+            // A sensor restart makes the wheel distance jump back
+            step = qMax(point.getDistance() - m_previous.getDistance(), (qreal)0);
+        }
+        m_distance += step;
+    }
+    m_previous = point;
+    m_hasPrevious = true;
+
+    if(point.hasTime()) {
+        qint64 ms = point.getTimeMs();
+        if(m_firstMs == noTime) {
+            m_firstMs = ms;
+        } else {
+            qint64 elapsed = ms - m_lastMs;
+            qreal covered = m_distance - m_lastMsDistance;
+            if(elapsed > 0 && covered * 1000 >= minMovingSpeed * elapsed) {
+                m_movingMs += elapsed;
+            }
+            m_kmSplits.add(m_lastMsDistance, m_lastMs, m_distance, ms);
+            m_mileSplits.add(m_lastMsDistance, m_lastMs, m_distance, ms);
+        }
+        m_lastMs = ms;
+        m_lastMsDistance = m_distance;
+        m_best1km.add(m_distance, ms);
+        m_best5km.add(m_distance, ms);
+    }
+
+    if(point.hasGroundSpeed() && point.getGroundSpeed() > m_maxSpeed) {
+        m_maxSpeed = point.getGroundSpeed();
+    }
+    if(point.hasElevation()) {
+        addElevation(point.getElevation());
+    }
+    if(point.hasCadence() && point.getCadence() > 0) {
+        m_cadenceSum += point.getCadence();
+        m_cadenceCount++;
+        m_maxCadence = qMax(m_maxCadence, point.getCadence());
+    }
+}
+
+void TrackStatistics::addElevation(qreal elevation) {
+    if(!m_hasElevation) {
+        m_hasElevation = true;
+        m_elevationRef = elevation;
+        return;
+    }
+    qreal change = elevation - m_elevationRef;
+    if(m_trend > 0 && change > 0) {
+        m_ascent += change;
+        m_elevationRef = elevation;
+    } else if(m_trend < 0 && change < 0) {
+        m_descent -= change;
+        m_elevationRef = elevation;
+    } else if(change >= elevationHysteresis) {
+        m_trend = 1;
+        m_ascent += change;
+        m_elevationRef = elevation;
+    } else if(change <= -elevationHysteresis) {
+        m_trend = -1;
+        m_descent -= change;
+        m_elevationRef = elevation;
+    }
+}
+
+int TrackStatistics::pointCount() const {
+    return m_count;
+}
+
+qint64 TrackStatistics::elapsedMs() const {
+    if(m_firstMs == noTime) {
+        return 0;
+    }
+    return m_lastMs - m_firstMs;
+}
+
+qint64 TrackStatistics::movingMs() const {
+    return m_movingMs;
+}
+
+qreal TrackStatistics::distance() const {
+    return m_distance;
+}
+
+qreal TrackStatistics::averageSpeed() const {
+    qint64 elapsed = elapsedMs();
+    return elapsed > 0 ? m_distance * 1000 / elapsed : 0;
+}
+
+qreal TrackStatistics::movingSpeed() const {
+    return m_movingMs > 0 ? m_distance * 1000 / m_movingMs : 0;
+}
+
+qreal TrackStatistics::maxSpeed() const {
+    return m_maxSpeed;
+}
+
+qreal TrackStatistics::pace() const {
+    return m_distance > 0 ? elapsedMs() / m_distance / 60 : 0;
+}
+
+qreal TrackStatistics::ascent() const {
+    return m_ascent;
+}
+
+qreal TrackStatistics::descent() const {
+    return m_descent;
+}
+
+qreal TrackStatistics::averageCadence() const {
+    return m_cadenceCount > 0 ? m_cadenceSum / m_cadenceCount : 0;
+}
+
+qreal TrackStatistics::maxCadence() const {
+    return m_maxCadence;
+}
+
+const QVector<qint64> &TrackStatistics::kmSplits() const {
+    return m_kmSplits.durations;
+}
+
+const QVector<qint64> &TrackStatistics::mileSplits() const {
+    return m_mileSplits.durations;
+}
+
+qint64 TrackStatistics::best1km() const {
+    return m_best1km.best;
+}
+
+qint64 TrackStatistics::best5km() const {
+    return m_best5km.best;
+}
@@ -0,0 +1,122 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACKSTATISTICS_H
+#define TRACKSTATISTICS_H
+
+#include <QVector>
+
+#include "TrackPoint.h"
+
+/*
+ * Track summary kept up to date one point at a time. Every add() is O(1)
+ * amortised and the points are not kept, so the loader can feed it while
+ * parsing and the recorder while recording. Points must come in time
+ * order.
+ *
+ * The distance of a step is measured like elsewhere in Rena: between the
+ * coordinates when both points have one, otherwise from the distance
+ * field. Steps slower than walking pace do not count as moving time.
+ * Ascent and descent only change direction after the elevation has
+ * turned by a few metres, so GPS noise on flat ground adds nothing.
+ */
+class TrackStatistics
+{
+public:
+    TrackStatistics();
+    void clear();
+    void add(const TrackPoint &point);
+
+    int pointCount() const;
+    qint64 elapsedMs() const;
+    qint64 movingMs() const;
+    qreal distance() const;
+    // Speeds in m/s and pace in min/km are 0 while undefined
+    qreal averageSpeed() const;
+    qreal movingSpeed() const;
+    qreal maxSpeed() const;
+    qreal pace() const;
+    qreal ascent() const;
+    qreal descent() const;
+    // Over samples with a non-zero cadence
+    qreal averageCadence() const;
+    qreal maxCadence() const;
+    // Duration of every completed split in ms
+    const QVector<qint64> &kmSplits() const;
+    const QVector<qint64> &mileSplits() const;
+    // Fastest time over the distance in ms, -1 until it has been covered
+    qint64 best1km() const;
+    qint64 best5km() const;
+
+private:
+    void addElevation(qreal elevation);
+
+    // Times at which the distance crosses every multiple of length
+    class Splits {
+    public:
+        explicit Splits(qreal length);
+        void clear();
+        void add(qreal fromDistance, qint64 fromMs, qreal toDistance, qint64 toMs);
+        QVector<qint64> durations;
+    private:
+        qreal m_length;
+        qreal m_next;
+        qint64 m_lastMs;
+        bool m_started;
+    };
+
+    // Sliding window over the distance/time profile
+    class Effort {
+    public:
+        explicit Effort(qreal length);
+        void clear();
+        void add(qreal distance, qint64 ms);
+        qint64 best;
+    private:
+        qreal m_length;
+        QVector<qreal> m_distance;
+        QVector<qint64> m_ms;
+        int m_head;     // First entry still inside the window
+    };
+
+    int m_count;
+    bool m_hasPrevious;
+    TrackPoint m_previous;
+    qint64 m_firstMs;
+    qint64 m_lastMs;
+    qreal m_lastMsDistance; // Distance at m_lastMs
+    qint64 m_movingMs;
+    qreal m_distance;
+    qreal m_maxSpeed;
+    bool m_hasElevation;
+    int m_trend;            // 1 climbing, -1 descending, 0 not known yet
+    qreal m_elevationRef;   // Highest or lowest point of the current trend
+    qreal m_ascent;
+    qreal m_descent;
+    qreal m_cadenceSum;
+    int m_cadenceCount;
+    qreal m_maxCadence;
+    Splits m_kmSplits;
+    Splits m_mileSplits;
+    Effort m_best1km;
+    Effort m_best5km;
+};
+
+#endif // TRACKSTATISTICS_H
@@ -0,0 +1,143 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QStandardPaths>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QSet>
+#include <QDebug>
+#include "tracksummarycache.h"
+
+static const quint32 indexMagic = 0x52454e49;   // "RENI"
+static const quint32 indexVersion = 1;
+
+TrackSummaryCache::TrackSummaryCache() {
+    m_filename = QStandardPaths::writableLocation(QStandardPaths::HomeLocation) + "/Rena/.trackindex";
+}
+
+bool TrackSummaryCache::load() {
+    m_changed.clear();
+    return read(m_entries);
+}
+
+bool TrackSummaryCache::read(QHash<QString, Entry> &entries) const {
+    entries.clear();
+    QFile file(m_filename);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic, version, count;
+    stream>>magic>>version>>count;
+    if(magic != indexMagic || version != indexVersion) {
+        qDebug()<<"Ignoring track index with unknown format";
+        return false;
+    }
+    for(quint32 i=0;i<count && stream.status() == QDataStream::Ok;i++) {
+        QString filename;
+        Entry entry;
+        qint32 duration;
+        double distance, speed;
+        stream>>filename>>entry.size>>entry.modified
+              >>entry.summary.name>>entry.summary.time>>duration
+              >>distance>>speed;
+        entry.summary.duration = duration;
+        entry.summary.distance = distance;
+        entry.summary.speed = speed;
+        if(stream.status() == QDataStream::Ok) {
+            entries.insert(filename, entry);
+        }
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+bool TrackSummaryCache::save() {
+    // Someone else may have saved since load()
+    QHash<QString, Entry> current;
+    read(current);
+    foreach(const QString &filename, m_changed) {
+        QHash<QString, Entry>::const_iterator i = m_entries.constFind(filename);
+        if(i == m_entries.constEnd()) {
+            current.remove(filename);
+        } else {
+            current.insert(filename, i.value());
+        }
+    }
+    m_entries = current;
+    m_changed.clear();
+
+    QSaveFile file(m_filename);
+    if(!file.open(QIODevice::WriteOnly)) {
+        qDebug()<<"Opening track index failed:"<<file.errorString();
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream<<indexMagic<<indexVersion<<(quint32)m_entries.size();
+    for(QHash<QString, Entry>::const_iterator i = m_entries.constBegin(); i != m_entries.constEnd(); i++) {
+        stream<<i.key()<<i.value().size<<i.value().modified
+              <<i.value().summary.name<<i.value().summary.time<<(qint32)i.value().summary.duration
+              <<(double)i.value().summary.distance<<(double)i.value().summary.speed;
+    }
+    if(!file.commit()) {
+        qDebug()<<"Writing track index failed:"<<file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool TrackSummaryCache::lookup(const QFileInfo &info, TrackSummary &summary) const {
+    QHash<QString, Entry>::const_iterator i = m_entries.constFind(info.fileName());
+    if(i == m_entries.constEnd() || i.value().size != info.size()
+            || i.value().modified != info.lastModified().toMSecsSinceEpoch()) {
+        return false;
+    }
+    summary = i.value().summary;
+    return true;
+}
+
+void TrackSummaryCache::insert(const QFileInfo &info, const TrackSummary &summary) {
+    Entry entry;
+    entry.size = info.size();
+    entry.modified = info.lastModified().toMSecsSinceEpoch();
+    entry.summary = summary;
+    m_entries.insert(info.fileName(), entry);
+    m_changed.insert(info.fileName());
+}
+
+void TrackSummaryCache::remove(const QString &filename) {
+    m_entries.remove(filename);
+    m_changed.insert(filename);
+}
+
+void TrackSummaryCache::retain(const QStringList &filenames) {
+    QSet<QString> keep = filenames.toSet();
+    QHash<QString, Entry>::iterator i = m_entries.begin();
+    while(i != m_entries.end()) {
+        if(keep.contains(i.key())) {
+            i++;
+        } else {
+            m_changed.insert(i.key());
+            i = m_entries.erase(i);
+        }
+    }
+}
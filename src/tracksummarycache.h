@@ -0,0 +1,72 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACKSUMMARYCACHE_H
+#define TRACKSUMMARYCACHE_H
+
+#include <QString>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QStringList>
+#include <QSet>
+
+struct TrackSummary {
+    QString name;
+    QDateTime time;
+    int duration;
+    qreal distance;
+    qreal speed;
+};
+
+/*
+ * Summaries of saved tracks in ~/Rena/.trackindex so the history list can
+ * be filled without parsing every GPX file. An entry is only valid while
+ * the file still has the size and modification time it was indexed with.
+ * Writers load, modify and save the whole index; it is small. save()
+ * reads the file again and only applies the entries changed through this
+ * instance, so writers that loaded it at different times do not drop each
+ * other's changes.
+ */
+class TrackSummaryCache
+{
+public:
+    TrackSummaryCache();
+    bool load();
+    bool save();
+    bool lookup(const QFileInfo &info, TrackSummary &summary) const;
+    void insert(const QFileInfo &info, const TrackSummary &summary);
+    void remove(const QString &filename);
+    // Drops entries of files no longer in the directory
+    void retain(const QStringList &filenames);
+
+private:
+    struct Entry {
+        qint64 size;
+        qint64 modified;
+        TrackSummary summary;
+    };
+    bool read(QHash<QString, Entry> &entries) const;
+    QString m_filename;
+    QHash<QString, Entry> m_entries;
+    QSet<QString> m_changed;    // Inserted or removed since load()
+};
+
+#endif // TRACKSUMMARYCACHE_H
@@ -0,0 +1,207 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDebug>
+#include <qnumeric.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trackwriter.h"
+#include "gpxwriter.h"
+#include "tcxwriter.h"
+#include "geojsonwriter.h"
+#include "fitwriter.h"
+
+static const int bufferSize = 64 * 1024;
+static const int maxItemSize = 64;     // Longest number or time we format
+
+TrackWriter *TrackWriter::create(Format format, QIODevice *device) {
+    switch(format) {
+    case Gpx: return new GpxWriter(device);
+    case Tcx: return new TcxWriter(device);
+    case GeoJson: return new GeoJsonWriter(device);
+    case Fit: return new FitWriter(device);
+    }
+    return 0;
+}
+
+QString TrackWriter::suffix(Format format) {
+    switch(format) {
+    case Gpx: return ".gpx";
+    case Tcx: return ".tcx";
+    case GeoJson: return ".geojson";
+    case Fit: return ".fit";
+    }
+    return QString();
+}
+
+QByteArray TrackWriter::mimeType(Format format) {
+    switch(format) {
+    case Gpx: return "application/gpx+xml";
+    case Tcx: return "application/vnd.garmin.tcx+xml";
+    case GeoJson: return "application/geo+json";
+    case Fit: return "application/vnd.ant.fit";
+    }
+    return QByteArray();
+}
+
+TrackWriter::TrackWriter(QIODevice *device) :
+    m_device(device),
+    m_error(false),
+    m_buffer(bufferSize, 0),
+    m_used(0),
+    m_oldLocale((locale_t)0)
+{
+    m_cLocale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+}
+
+TrackWriter::~TrackWriter() {
+    if(m_cLocale) {
+        freelocale(m_cLocale);
+    }
+}
+
+bool TrackWriter::write(const TrackPoints &points, const QString &name, const QString &description) {
+    TrackPointIterator iterator(points);
+    return write(iterator, name, description);
+}
+
+void TrackWriter::begin() {
+    // printf family follows LC_NUMERIC, which Qt sets from the environment
+    m_oldLocale = m_cLocale ? uselocale(m_cLocale) : (locale_t)0;
+}
+
+bool TrackWriter::end() {
+    flush();
+    if(m_cLocale) {
+        uselocale(m_oldLocale);
+    }
+    if(m_error) {
+        qDebug()<<"Writing track failed:"<<m_device->errorString();
+    }
+    return !m_error;
+}
+
+void TrackWriter::flush() {
+    if(m_used > 0 && !m_error) {
+        if(m_device->write(m_buffer.constData(), m_used) != m_used) {
+            m_error = true;
+        }
+    }
+    m_used = 0;
+}
+
+void TrackWriter::append(const char *data, int len) {
+    if(m_used + len > bufferSize) {
+        flush();
+        if(len > bufferSize) {
+            if(!m_error && m_device->write(data, len) != len) {
+                m_error = true;
+            }
+            return;
+        }
+    }
+    memcpy(m_buffer.data() + m_used, data, len);
+    m_used += len;
+}
+
+char *TrackWriter::reserve() {
+    if(m_used + maxItemSize > bufferSize) {
+        flush();
+    }
+    return m_buffer.data() + m_used;
+}
+
+// Shortest of 15, 16 or 17 significant digits that reads back exactly
+void TrackWriter::writeNumber(qreal value) {
+    char *out = reserve();
+    int len = 0;
+    for(int precision=15;precision<=17;precision++) {
+        len = snprintf(out, maxItemSize, "%.*g", precision, value);
+        if(value != value || strtod(out, 0) == value) {
+            break;
+        }
+    }
+    m_used += len;
+}
+
+void TrackWriter::writeInteger(qint64 value) {
+    m_used += snprintf(reserve(), maxItemSize, "%lld", (long long)value);
+}
+
+void TrackWriter::writeTime(qint64 msecs) {
+    m_used += m_times.format(msecs, reserve());
+}
+
+void TrackWriter::writeEscaped(const QString &text) {
+    QByteArray utf8 = text.toUtf8();
+    const char *p = utf8.constData();
+    const char *end = p + utf8.size();
+    const char *run = p;
+    for(;p<end;p++) {
+        const char *entity;
+        switch(*p) {
+        case '<': entity = "&lt;"; break;
+        case '>': entity = "&gt;"; break;
+        case '&': entity = "&amp;"; break;
+        case '"': entity = "&quot;"; break;
+        default: continue;
+        }
+        append(run, p - run);
+        append(entity, strlen(entity));
+        run = p + 1;
+    }
+    append(run, p - run);
+}
+
+void TrackWriter::writeJsonString(const QString &text) {
+    QByteArray utf8 = text.toUtf8();
+    const char *p = utf8.constData();
+    const char *end = p + utf8.size();
+    const char *run = p;
+    append("\"");
+    for(;p<end;p++) {
+        unsigned char c = *p;
+        if(c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        append(run, p - run);
+        switch(c) {
+        case '"': append("\\\""); break;
+        case '\\': append("\\\\"); break;
+        case '\n': append("\\n"); break;
+        case '\r': append("\\r"); break;
+        case '\t': append("\\t"); break;
+        default:
+            m_used += snprintf(reserve(), maxItemSize, "\\u%04x", c);
+        }
+        run = p + 1;
+    }
+    append(run, p - run);
+    append("\"");
+}
+
+void TrackWriter::writeJsonNumber(qreal value) {
+    if(qIsFinite(value)) {
+        writeNumber(value);
+    } else {
+        append("null");
+    }
+}
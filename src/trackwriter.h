@@ -0,0 +1,97 @@
+/*
+    Copyright 2014 Simo Mattila
+    simo.h.mattila@gmail.com
+
+    This file is part of Rena.
+
+    Rena is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    Rena is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Rena.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACKWRITER_H
+#define TRACKWRITER_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QString>
+#include <locale.h>
+
+#include "TrackPoints.h"
+#include "TrackPointIterator.h"
+#include "isotime.h"
+
+/*
+ * Base of the track exporters. A writer streams the points of one
+ * TrackPointIterator to a device: text is formatted straight into a
+ * reusable byte buffer which is flushed in large chunks, so a track is
+ * never held a second time in any format.
+ *
+ * Writers are used once, create() picks one by format.
+ */
+class TrackWriter
+{
+public:
+    enum Format {
+        Gpx,
+        Tcx,
+        GeoJson,
+        Fit
+    };
+
+    static TrackWriter *create(Format format, QIODevice *device);
+    // File name extension with the dot, ".gpx"
+    static QString suffix(Format format);
+    static QByteArray mimeType(Format format);
+
+    explicit TrackWriter(QIODevice *device);
+    virtual ~TrackWriter();
+
+    // Writes the points the iterator has yet to visit
+    virtual bool write(TrackPointIterator &points, const QString &name, const QString &description) = 0;
+    bool write(const TrackPoints &points, const QString &name, const QString &description);
+
+protected:
+    // Brackets a write(): numbers are formatted in the C locale in between
+    void begin();
+    bool end();
+
+    template<int N> void append(const char (&literal)[N]) {
+        append(literal, N - 1);
+    }
+    void append(const char *data, int len);
+    void writeNumber(qreal value);
+    void writeInteger(qint64 value);
+    void writeTime(qint64 msecs);
+    // Escapes for XML text and attribute values
+    void writeEscaped(const QString &text);
+    // Quoted and escaped JSON string
+    void writeJsonString(const QString &text);
+    // Like writeNumber(), but null for NaN and infinities as JSON has none
+    void writeJsonNumber(qreal value);
+    void flush();
+
+    QIODevice *m_device;
+    bool m_error;
+
+private:
+    // Makes room for a formatted item and returns where it goes
+    char *reserve();
+
+    QByteArray m_buffer;
+    int m_used;
+    IsoTime m_times;
+    locale_t m_cLocale;
+    locale_t m_oldLocale;
+};
+
+#endif // TRACKWRITER_H